@@ -0,0 +1,358 @@
+/**
+ * @file make_dataset.c
+ * @brief Native generator of synthetic classification datasets, without Python.
+ *
+ * Every class gets a Gaussian cluster centred on a vertex of a hypercube in the space of
+ * the informative features (as sklearn's make_classification does); the remaining features
+ * are standard Gaussian noise. Class frequencies follow --weights, and --flip_y randomly
+ * reassigns a fraction of the labels.
+ *
+ * Rows are generated in blocks of BLOCK_ROWS, each with its own generator derived from the
+ * seed and the block index, so the output only depends on the options and the seed, not on
+ * the number of OpenMP threads. Blocks are generated in parallel and written in order.
+ *
+ * Output formats:
+ * - csv: header feature_0,...,feature_{n-1},target, then one row per sample;
+ * - bin: a DatasetHeader (magic "RFDS", rows, columns as 32-bit ints) followed by the
+ *   rows x columns matrix of 32-bit floats in row-major order, label in the last column.
+ *   This is the in-memory layout of the training code, so it is read with a single fread.
+ *
+ * Build with make in this directory, then e.g.
+ *   ./make_dataset --rows 100000000 --features 16 --classes 4 --format bin --output big.bin
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define DATASET_MAGIC 0x53444652  // "RFDS"
+#define BLOCK_ROWS 65536
+#define MAX_CSV_FIELD 32
+
+typedef struct DatasetHeader {
+    int32_t magic;
+    int32_t num_rows;
+    int32_t num_columns;
+} DatasetHeader;
+
+typedef struct Options {
+    long long rows;
+    int features;
+    int informative;
+    int classes;
+    double class_sep;
+    double flip_y;
+    double *weights;
+    unsigned long long seed;
+    int binary;
+    const char *output;
+} Options;
+
+typedef struct Rng {
+    uint64_t state;
+    int has_spare;
+    double spare;
+} Rng;
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void rng_seed(Rng *rng, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    rng->state = splitmix64(&x) | 1;
+    rng->has_spare = 0;
+}
+
+// xorshift64*: uniform in [0, 1)
+static double rng_uniform(Rng *rng) {
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return ((rng->state * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Box-Muller, keeping the second value for the next call
+static double rng_normal(Rng *rng) {
+    if (rng->has_spare) {
+        rng->has_spare = 0;
+        return rng->spare;
+    }
+    double u1 = rng_uniform(rng), u2 = rng_uniform(rng);
+    if (u1 < 1e-300) {
+        u1 = 1e-300;
+    }
+    double radius = sqrt(-2.0 * log(u1));
+    rng->spare = radius * sin(2.0 * M_PI * u2);
+    rng->has_spare = 1;
+    return radius * cos(2.0 * M_PI * u2);
+}
+
+// Fixed-point formatting with 6 decimals, much faster than printf for large files
+static int format_value(char *out, float value) {
+    char *p = out;
+    double v = value;
+    if (v < 0) {
+        *p++ = '-';
+        v = -v;
+    }
+    unsigned long long scaled = (unsigned long long)(v * 1e6 + 0.5);
+    unsigned long long integer = scaled / 1000000ULL, fraction = scaled % 1000000ULL;
+    char digits[24];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + integer % 10);
+        integer /= 10;
+    } while (integer > 0);
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    *p++ = '.';
+    for (int d = 5; d >= 0; d--) {
+        p[d] = (char)('0' + fraction % 10);
+        fraction /= 10;
+    }
+    return (int)(p + 6 - out);
+}
+
+// Fills the num_rows rows of block `block` into values
+static void generate_block(const Options *options, const double *cumulative_weights, long long block,
+                           int num_rows, float *values) {
+    int num_columns = options->features + 1;
+    Rng rng;
+    rng_seed(&rng, options->seed, (uint64_t)block);
+
+    for (int i = 0; i < num_rows; i++) {
+        float *row = values + (size_t)i * num_columns;
+
+        double u = rng_uniform(&rng);
+        int label = 0;
+        while (label < options->classes - 1 && u >= cumulative_weights[label]) {
+            label++;
+        }
+
+        // Informative features around the hypercube vertex of the class
+        for (int f = 0; f < options->informative; f++) {
+            double centre = ((label >> f) & 1) ? options->class_sep : -options->class_sep;
+            row[f] = (float)(centre + rng_normal(&rng));
+        }
+        for (int f = options->informative; f < options->features; f++) {
+            row[f] = (float)rng_normal(&rng);
+        }
+
+        if (rng_uniform(&rng) < options->flip_y) {
+            label = (int)(rng_uniform(&rng) * options->classes);
+        }
+        row[options->features] = (float)label;
+    }
+}
+
+// Formats a block as CSV lines, returns the number of bytes
+static size_t format_block(const float *values, int num_rows, int num_columns, char *text) {
+    char *p = text;
+    for (int i = 0; i < num_rows; i++) {
+        const float *row = values + (size_t)i * num_columns;
+        for (int f = 0; f < num_columns - 1; f++) {
+            p += format_value(p, row[f]);
+            *p++ = ',';
+        }
+        p += sprintf(p, "%d\n", (int)row[num_columns - 1]);
+    }
+    return (size_t)(p - text);
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s --rows <n> --features <n> [--informative <n>] [--classes <n>]\n"
+            "          [--weights w0,w1,...] [--class_sep <x>] [--flip_y <x>] [--seed <n>]\n"
+            "          [--format csv|bin] [--output <path>]\n", program);
+}
+
+static int parse_options(int argc, char *argv[], Options *options) {
+    const char *weights = NULL;
+    options->rows = 0;
+    options->features = 0;
+    options->informative = 3;
+    options->classes = 2;
+    options->class_sep = 1.0;
+    options->flip_y = 0.01;
+    options->weights = NULL;
+    options->seed = 42;
+    options->binary = 0;
+    options->output = "classification_dataset.csv";
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--rows") == 0) {
+            options->rows = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--features") == 0) {
+            options->features = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--informative") == 0) {
+            options->informative = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--classes") == 0) {
+            options->classes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--weights") == 0) {
+            weights = argv[++i];
+        } else if (strcmp(argv[i], "--class_sep") == 0) {
+            options->class_sep = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--flip_y") == 0) {
+            options->flip_y = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            options->seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--format") == 0) {
+            i++;
+            if (strcmp(argv[i], "csv") == 0) {
+                options->binary = 0;
+            } else if (strcmp(argv[i], "bin") == 0) {
+                options->binary = 1;
+            } else {
+                fprintf(stderr, "Format must be csv or bin, instead %s was provided.\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--output") == 0) {
+            options->output = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (options->rows <= 0 || options->rows > INT32_MAX || options->features <= 0) {
+        fprintf(stderr, "--rows must be in [1, %d] and --features must be positive.\n", INT32_MAX);
+        return 1;
+    }
+    if (options->classes < 2 || options->informative < 1 || options->informative > options->features ||
+        options->informative > 30 || options->classes > (1 << options->informative)) {
+        fprintf(stderr, "Need 2 <= classes <= 2^informative and 1 <= informative <= min(features, 30).\n");
+        return 1;
+    }
+
+    options->weights = (double *)malloc(options->classes * sizeof(double));
+    if (!options->weights) {
+        fprintf(stderr, "Failed to allocate memory for class weights\n");
+        return 1;
+    }
+    for (int c = 0; c < options->classes; c++) {
+        options->weights[c] = 1.0;
+    }
+    if (weights != NULL) {
+        // Comma-separated relative frequencies, e.g. 0.9,0.1 for a 9:1 imbalance
+        const char *p = weights;
+        for (int c = 0; c < options->classes; c++) {
+            char *end;
+            options->weights[c] = strtod(p, &end);
+            if (end == p || options->weights[c] < 0) {
+                fprintf(stderr, "--weights needs %d non-negative values.\n", options->classes);
+                return 1;
+            }
+            p = (*end == ',') ? end + 1 : end;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (argc < 2 || parse_options(argc, argv, &options) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int num_columns = options.features + 1;
+    double cumulative_weights[options.classes];
+    double total_weight = 0.0;
+    for (int c = 0; c < options.classes; c++) {
+        total_weight += options.weights[c];
+    }
+    if (total_weight <= 0) {
+        fprintf(stderr, "The class weights sum to zero.\n");
+        return 1;
+    }
+    for (int c = 0; c < options.classes; c++) {
+        cumulative_weights[c] = (c > 0 ? cumulative_weights[c - 1] : 0.0) + options.weights[c] / total_weight;
+    }
+
+    FILE *fp = fopen(options.output, "wb");
+    if (!fp) {
+        perror("Error opening output file");
+        return 1;
+    }
+    if (options.binary) {
+        DatasetHeader header = {DATASET_MAGIC, (int32_t)options.rows, (int32_t)num_columns};
+        fwrite(&header, sizeof(header), 1, fp);
+    } else {
+        for (int f = 0; f < options.features; f++) {
+            fprintf(fp, "feature_%d,", f);
+        }
+        fprintf(fp, "target\n");
+    }
+
+    int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = omp_get_max_threads();
+#endif
+    int blocks_per_batch = 2 * num_threads;
+    long long num_blocks = (options.rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    size_t block_values = (size_t)BLOCK_ROWS * num_columns;
+    float *values = (float *)malloc(blocks_per_batch * block_values * sizeof(float));
+    char *text = NULL;
+    size_t *block_bytes = (size_t *)malloc(blocks_per_batch * sizeof(size_t));
+    size_t text_capacity = block_values * MAX_CSV_FIELD;
+    if (!options.binary) {
+        text = (char *)malloc(blocks_per_batch * text_capacity);
+    }
+    if (!values || !block_bytes || (!options.binary && !text)) {
+        fprintf(stderr, "Failed to allocate memory for the generation buffers\n");
+        return 1;
+    }
+
+    for (long long first_block = 0; first_block < num_blocks; first_block += blocks_per_batch) {
+        int batch = (int)(num_blocks - first_block < blocks_per_batch ? num_blocks - first_block : blocks_per_batch);
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int b = 0; b < batch; b++) {
+            long long block = first_block + b;
+            long long remaining = options.rows - block * BLOCK_ROWS;
+            int block_rows = (int)(remaining < BLOCK_ROWS ? remaining : BLOCK_ROWS);
+            generate_block(&options, cumulative_weights, block, block_rows, values + b * block_values);
+            if (options.binary) {
+                block_bytes[b] = (size_t)block_rows * num_columns * sizeof(float);
+            } else {
+                block_bytes[b] = format_block(values + b * block_values, block_rows, num_columns, text + b * text_capacity);
+            }
+        }
+
+        for (int b = 0; b < batch; b++) {
+            const void *buffer = options.binary ? (const void *)(values + b * block_values) : (const void *)(text + b * text_capacity);
+            if (fwrite(buffer, 1, block_bytes[b], fp) != block_bytes[b]) {
+                perror("Error writing the dataset");
+                return 1;
+            }
+        }
+    }
+
+    fclose(fp);
+    printf("Dataset saved to %s (%lld rows, %d features, %d classes)\n", options.output, options.rows,
+           options.features, options.classes);
+
+    free(values);
+    free(text);
+    free(block_bytes);
+    free(options.weights);
+    return 0;
+}
@@ -0,0 +1,423 @@
+/**
+ * @file bench.c
+ * @brief Micro-benchmarks of the training and inference kernels on synthetic data.
+ *
+ * Every kernel runs on the same synthetic dataset, whose size, number of classes and
+ * thread count are set from the command line. Each kernel is run a few times untimed to
+ * warm the caches, then timed for the requested number of repetitions. The report gives
+ * the minimum, median, 90th and 99th percentiles, maximum and mean time per call, as CSV
+ * or JSON.
+ *
+ * Usage: ./bench/bench_kernels [--rows N] [--features N] [--classes N] [--threads N]
+ *                              [--trees N] [--max_depth N] [--warmup N] [--reps N]
+ *                              [--seed N] [--format csv|json] [--output path]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../headers/tree/tree.h"
+#include "../headers/tree/train_utils.h"
+#include "../headers/tree/utils.h"
+
+/**
+ * @brief Sizes and repetitions of a benchmark run.
+ */
+typedef struct BenchConfig {
+    int rows;           /**< Rows of the synthetic dataset. */
+    int features;       /**< Features of the synthetic dataset (the label is added). */
+    int classes;        /**< Number of classes. */
+    int threads;        /**< OpenMP threads given to the kernels that take them. */
+    int trees;          /**< Trees used by the forest vote aggregation. */
+    int max_depth;      /**< Depth of the trees used by the inference kernels. */
+    int warmup;         /**< Untimed runs before the repetitions. */
+    int reps;           /**< Timed repetitions. */
+    int seed;           /**< Seed of the synthetic data. */
+    int json;           /**< Report as JSON instead of CSV. */
+    const char *output; /**< Report path, NULL for stdout. */
+} BenchConfig;
+
+/**
+ * @brief State handed to every kernel.
+ */
+typedef struct BenchData {
+    const BenchConfig *config;
+    int num_columns;
+    float *data;            /**< rows x (features + 1) dataset. */
+    float *feature_values;  /**< First feature, unsorted. */
+    float *target_values;   /**< Labels, in the same order as feature_values. */
+    float *sorted_values;   /**< First feature, sorted. */
+    float *sorted_targets;  /**< Labels, in the order of sorted_values. */
+    float *work_values;     /**< Scratch copy sorted by merge_sort. */
+    float *work_targets;    /**< Scratch copy sorted by merge_sort. */
+    float *left_data;       /**< Output of split_data_1d_safe. */
+    float *right_data;      /**< Output of split_data_1d_safe. */
+    int *sample_rows;       /**< Rows of a bootstrap drawn with replacement. */
+    int *sample_weights;    /**< Number of draws of every entry of sample_rows. */
+    int num_sample_rows;    /**< Entries of sample_rows. */
+    float threshold;        /**< Median of the first feature. */
+    Tree *trees;            /**< Trees trained once, for the inference kernels. */
+    vote_t *votes;          /**< rows x classes vote matrix. */
+    int *predictions;       /**< Forest predictions. */
+} BenchData;
+
+typedef void (*KernelFn)(BenchData *bench);
+
+/**
+ * @brief One timed kernel; prepare (optional) runs before every call, outside the timing.
+ */
+typedef struct Kernel {
+    const char *name;
+    KernelFn prepare;
+    KernelFn run;
+} Kernel;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static float uniform(void) {
+    return (float)rand() / (float)RAND_MAX;
+}
+
+// Classes are separable on every feature, up to noise, so trees reach a realistic depth
+static void generate_data(BenchData *bench) {
+    const BenchConfig *config = bench->config;
+    srand(config->seed);
+    for (int i = 0; i < config->rows; i++) {
+        int label = rand() % config->classes;
+        float *row = bench->data + (size_t)i * bench->num_columns;
+        for (int f = 0; f < config->features; f++) {
+            row[f] = label * (1.0f + 0.1f * f) + 2.0f * uniform();
+        }
+        row[config->features] = (float)label;
+    }
+}
+
+static void *checked_malloc(size_t bytes) {
+    void *ptr = malloc(bytes > 0 ? bytes : 1);
+    if (ptr == NULL) {
+        fprintf(stderr, "Memory allocation failed in benchmark setup\n");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int count, double p) {
+    int index = (int)(p * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+/* ---- kernels ---- */
+
+static void prepare_merge_sort(BenchData *bench) {
+    size_t bytes = bench->config->rows * sizeof(float);
+    memcpy(bench->work_values, bench->feature_values, bytes);
+    memcpy(bench->work_targets, bench->target_values, bytes);
+}
+
+static void run_merge_sort(BenchData *bench) {
+    merge_sort(bench->work_values, bench->work_targets, bench->config->rows);
+}
+
+static void run_best_split_num_var(BenchData *bench) {
+    float *split = get_best_split_num_var(bench->sorted_values, bench->sorted_targets, bench->config->rows,
+                                          bench->config->classes, bench->config->threads);
+    free(split);
+}
+
+static void run_random_split_num_var(BenchData *bench) {
+    float *split = get_random_split_num_var(bench->data, NULL, NULL, bench->config->rows, bench->num_columns, 0,
+                                            bench->config->classes, 0.5f);
+    free(split);
+}
+
+static void run_approx_split_num_var(BenchData *bench) {
+    float *split = get_approx_split_num_var(bench->data, NULL, NULL, bench->config->rows, bench->num_columns, 0,
+                                            bench->config->classes, SKETCH_DEFAULT_K, bench->config->threads);
+    free(split);
+}
+
+static void run_find_best_split(BenchData *bench) {
+    int pred_left, pred_right, size_left, size_right;
+    unsigned int rng = (unsigned int)bench->config->seed;
+    find_best_split_1d(bench->data, NULL, NULL, bench->config->rows, bench->num_columns, bench->config->classes,
+                       &pred_left, &pred_right, &size_left, &size_right, "sqrt", SPLITTER_BEST,
+                       bench->config->threads, &rng);
+}
+
+static void run_find_random_split(BenchData *bench) {
+    int pred_left, pred_right, size_left, size_right;
+    unsigned int rng = (unsigned int)bench->config->seed;
+    find_best_split_1d(bench->data, NULL, NULL, bench->config->rows, bench->num_columns, bench->config->classes,
+                       &pred_left, &pred_right, &size_left, &size_right, "sqrt", SPLITTER_RANDOM,
+                       bench->config->threads, &rng);
+}
+
+static void run_find_approx_split(BenchData *bench) {
+    int pred_left, pred_right, size_left, size_right;
+    unsigned int rng = (unsigned int)bench->config->seed;
+    find_best_split_1d(bench->data, NULL, NULL, bench->config->rows, bench->num_columns, bench->config->classes,
+                       &pred_left, &pred_right, &size_left, &size_right, "sqrt", SPLITTER_APPROX,
+                       bench->config->threads, &rng);
+}
+
+static void run_find_weighted_split(BenchData *bench) {
+    int pred_left, pred_right, size_left, size_right;
+    unsigned int rng = (unsigned int)bench->config->seed;
+    find_best_split_1d(bench->data, bench->sample_rows, bench->sample_weights, bench->num_sample_rows,
+                       bench->num_columns, bench->config->classes, &pred_left, &pred_right, &size_left,
+                       &size_right, "sqrt", SPLITTER_BEST, bench->config->threads, &rng);
+}
+
+static void run_split_data(BenchData *bench) {
+    int left_size, right_size;
+    split_data_1d_safe(bench->data, bench->left_data, bench->right_data, bench->config->rows,
+                       bench->num_columns, 0, bench->threshold, &left_size, &right_size);
+}
+
+static void run_tree_inference(BenchData *bench) {
+    int *predictions = tree_inference_1d(&bench->trees[0], bench->data, bench->config->rows, bench->num_columns);
+    free(predictions);
+}
+
+static void prepare_forest_votes(BenchData *bench) {
+    memset(bench->votes, 0, (size_t)bench->config->rows * bench->config->classes * sizeof(vote_t));
+}
+
+// Votes of every tree tallied into the vote matrix, then the majority class of every row
+static void run_forest_votes(BenchData *bench) {
+    const BenchConfig *config = bench->config;
+    for (int t = 0; t < config->trees; t++) {
+        tree_inference_votes_1d(&bench->trees[t], bench->data, config->rows, bench->num_columns,
+                                config->classes, bench->votes);
+    }
+    for (int i = 0; i < config->rows; i++) {
+        const vote_t *row = bench->votes + (size_t)i * config->classes;
+        int best = 0;
+        for (int c = 1; c < config->classes; c++) {
+            if (row[c] > row[best]) {
+                best = c;
+            }
+        }
+        bench->predictions[i] = best;
+    }
+}
+
+static const Kernel KERNELS[] = {
+    {"merge_sort", prepare_merge_sort, run_merge_sort},
+    {"get_best_split_num_var", NULL, run_best_split_num_var},
+    {"get_random_split_num_var", NULL, run_random_split_num_var},
+    {"find_best_split_1d", NULL, run_find_best_split},
+    {"find_best_split_1d_random", NULL, run_find_random_split},
+    {"get_approx_split_num_var", NULL, run_approx_split_num_var},
+    {"find_best_split_1d_approx", NULL, run_find_approx_split},
+    {"find_best_split_1d_weighted", NULL, run_find_weighted_split},
+    {"split_data_1d_safe", NULL, run_split_data},
+    {"tree_inference_1d", NULL, run_tree_inference},
+    {"forest_votes", prepare_forest_votes, run_forest_votes},
+};
+
+/* ---- driver ---- */
+
+static int parse_bench_arguments(int argc, char *argv[], BenchConfig *config) {
+    config->rows = 2000;
+    config->features = 16;
+    config->classes = 3;
+    config->threads = 1;
+    config->trees = 8;
+    config->max_depth = 8;
+    config->warmup = 3;
+    config->reps = 10;
+    config->seed = 0;
+    config->json = 0;
+    config->output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printf("Missing value for %s.\n", argv[i]);
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (strcmp(argv[i - 1], "--rows") == 0) config->rows = atoi(value);
+        else if (strcmp(argv[i - 1], "--features") == 0) config->features = atoi(value);
+        else if (strcmp(argv[i - 1], "--classes") == 0) config->classes = atoi(value);
+        else if (strcmp(argv[i - 1], "--threads") == 0) config->threads = atoi(value);
+        else if (strcmp(argv[i - 1], "--trees") == 0) config->trees = atoi(value);
+        else if (strcmp(argv[i - 1], "--max_depth") == 0) config->max_depth = atoi(value);
+        else if (strcmp(argv[i - 1], "--warmup") == 0) config->warmup = atoi(value);
+        else if (strcmp(argv[i - 1], "--reps") == 0) config->reps = atoi(value);
+        else if (strcmp(argv[i - 1], "--seed") == 0) config->seed = atoi(value);
+        else if (strcmp(argv[i - 1], "--output") == 0) config->output = value;
+        else if (strcmp(argv[i - 1], "--format") == 0) {
+            if (strcmp(value, "csv") == 0) config->json = 0;
+            else if (strcmp(value, "json") == 0) config->json = 1;
+            else {
+                printf("Format must be csv or json, instead %s was provided.\n", value);
+                return 1;
+            }
+        }
+        else {
+            printf("Unknown option %s.\n", argv[i - 1]);
+            return 1;
+        }
+    }
+
+    if (config->rows < 2 || config->features < 1 || config->classes < 2 || config->threads < 1 ||
+        config->trees < 1 || config->trees > VOTE_MAX || config->max_depth < 1 || config->warmup < 0 ||
+        config->reps < 1) {
+        printf("Invalid benchmark sizes.\n");
+        return 1;
+    }
+    return 0;
+}
+
+static void setup(BenchData *bench) {
+    const BenchConfig *config = bench->config;
+    size_t rows = config->rows;
+
+    bench->num_columns = config->features + 1;
+    bench->data = checked_malloc(rows * bench->num_columns * sizeof(float));
+    bench->feature_values = checked_malloc(rows * sizeof(float));
+    bench->target_values = checked_malloc(rows * sizeof(float));
+    bench->sorted_values = checked_malloc(rows * sizeof(float));
+    bench->sorted_targets = checked_malloc(rows * sizeof(float));
+    bench->work_values = checked_malloc(rows * sizeof(float));
+    bench->work_targets = checked_malloc(rows * sizeof(float));
+    bench->left_data = checked_malloc(rows * bench->num_columns * sizeof(float));
+    bench->right_data = checked_malloc(rows * bench->num_columns * sizeof(float));
+    bench->votes = checked_malloc(rows * config->classes * sizeof(vote_t));
+    bench->predictions = checked_malloc(rows * sizeof(int));
+    bench->trees = checked_malloc(config->trees * sizeof(Tree));
+
+    generate_data(bench);
+    for (size_t i = 0; i < rows; i++) {
+        bench->feature_values[i] = bench->data[i * bench->num_columns];
+        bench->target_values[i] = bench->data[i * bench->num_columns + config->features];
+    }
+    memcpy(bench->sorted_values, bench->feature_values, rows * sizeof(float));
+    memcpy(bench->sorted_targets, bench->target_values, rows * sizeof(float));
+    merge_sort(bench->sorted_values, bench->sorted_targets, config->rows);
+    bench->threshold = bench->sorted_values[rows / 2];
+
+    // Bootstrap with replacement of every row, as trained by --bootstrap replacement
+    int *counts = checked_malloc(rows * sizeof(int));
+    bench->sample_rows = checked_malloc(rows * sizeof(int));
+    bench->sample_weights = checked_malloc(rows * sizeof(int));
+    unsigned int sample_rng = (unsigned int)config->seed;
+    bench->num_sample_rows = draw_bootstrap(config->rows, 1.0f, 1, counts, bench->sample_rows, &sample_rng);
+    for (int i = 0; i < bench->num_sample_rows; i++) {
+        bench->sample_weights[i] = counts[bench->sample_rows[i]];
+    }
+    free(counts);
+
+    // Trees are trained once on the whole dataset, they are only used for inference
+    for (int t = 0; t < config->trees; t++) {
+        unsigned int rng = (unsigned int)(config->seed + t);
+        train_tree_1d(&bench->trees[t], bench->data, config->rows, bench->num_columns, config->classes,
+                      config->max_depth, 20, "sqrt", SPLITTER_BEST, config->threads, &rng);
+    }
+}
+
+static void teardown(BenchData *bench) {
+    for (int t = 0; t < bench->config->trees; t++) {
+        free_tree(&bench->trees[t]);
+    }
+    free(bench->trees);
+    free(bench->data);
+    free(bench->feature_values);
+    free(bench->target_values);
+    free(bench->sorted_values);
+    free(bench->sorted_targets);
+    free(bench->work_values);
+    free(bench->work_targets);
+    free(bench->left_data);
+    free(bench->right_data);
+    free(bench->sample_rows);
+    free(bench->sample_weights);
+    free(bench->votes);
+    free(bench->predictions);
+}
+
+int main(int argc, char *argv[]) {
+    BenchConfig config;
+    if (parse_bench_arguments(argc, argv, &config) != 0) {
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (config.output != NULL && (out = fopen(config.output, "w")) == NULL) {
+        perror("Error opening benchmark output file");
+        return 1;
+    }
+
+    BenchData bench;
+    bench.config = &config;
+    setup(&bench);
+
+    int num_kernels = sizeof(KERNELS) / sizeof(KERNELS[0]);
+    double *samples = checked_malloc(config.reps * sizeof(double));
+
+    if (config.json) {
+        fprintf(out, "[\n");
+    } else {
+        fprintf(out, "kernel,rows,features,classes,threads,trees,warmup,reps,min_us,median_us,p90_us,p99_us,max_us,mean_us\n");
+    }
+
+    for (int k = 0; k < num_kernels; k++) {
+        const Kernel *kernel = &KERNELS[k];
+        for (int r = 0; r < config.warmup; r++) {
+            if (kernel->prepare) kernel->prepare(&bench);
+            kernel->run(&bench);
+        }
+
+        double total = 0.0;
+        for (int r = 0; r < config.reps; r++) {
+            if (kernel->prepare) kernel->prepare(&bench);
+            double start = now_us();
+            kernel->run(&bench);
+            samples[r] = now_us() - start;
+            total += samples[r];
+        }
+        qsort(samples, config.reps, sizeof(double), compare_doubles);
+
+        double median = percentile(samples, config.reps, 0.5);
+        double p90 = percentile(samples, config.reps, 0.9);
+        double p99 = percentile(samples, config.reps, 0.99);
+        double mean = total / config.reps;
+
+        if (config.json) {
+            fprintf(out, "  {\"kernel\": \"%s\", \"rows\": %d, \"features\": %d, \"classes\": %d, \"threads\": %d, "
+                         "\"trees\": %d, \"warmup\": %d, \"reps\": %d, \"min_us\": %.3f, \"median_us\": %.3f, "
+                         "\"p90_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f, \"mean_us\": %.3f}%s\n",
+                    kernel->name, config.rows, config.features, config.classes, config.threads, config.trees,
+                    config.warmup, config.reps, samples[0], median, p90, p99, samples[config.reps - 1], mean,
+                    (k + 1 < num_kernels) ? "," : "");
+        } else {
+            fprintf(out, "%s,%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+                    kernel->name, config.rows, config.features, config.classes, config.threads, config.trees,
+                    config.warmup, config.reps, samples[0], median, p90, p99, samples[config.reps - 1], mean);
+        }
+        fflush(out);
+    }
+
+    if (config.json) {
+        fprintf(out, "]\n");
+    }
+
+    free(samples);
+    teardown(&bench);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
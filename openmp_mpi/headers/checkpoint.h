@@ -0,0 +1,100 @@
+/**
+ * @file checkpoint.h
+ * @brief Incremental checkpointing of trained trees to a single file through MPI-IO.
+ *
+ * Every tree is appended to the checkpoint as soon as it is trained, as one record made of
+ * a small header (tree id, payload size, checksum) followed by the tree in the
+ * serialize_tree_to_buffer() format. Space in the file is reserved with MPI_Fetch_and_op on
+ * an offset counter held by process 0, and the record is written with MPI_File_iwrite_at,
+ * so a process keeps training while its last tree is being written.
+ *
+ * The file starts with a CheckpointHeader holding the seed and the parameters that determine
+ * the trees. Since the bootstrap of tree t only depends on seed + t, the set of finished tree
+ * ids is all the random and scheduling state needed to resume: a restarted job skips those
+ * ids and trains the remaining ones, possibly with a different number of processes.
+ *
+ * The file is written in the native binary layout and is meant to be resumed on the same
+ * kind of machine.
+ */
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <mpi.h>
+
+#include "tree/tree.h"
+
+#define CHECKPOINT_MAGIC 0x52464350  // "PCFR"
+#define CHECKPOINT_RECORD_MAGIC 0x54524545  // "TREE"
+
+/**
+ * @brief Parameters a checkpoint was written with, compared on resume.
+ *
+ * The number of trees is not part of it: a forest can be resumed with more trees.
+ */
+typedef struct CheckpointHeader {
+    int magic;
+    int seed;
+    int num_rows;
+    int num_columns;
+    int num_classes;
+    int max_depth;
+    int min_samples_split;
+    float train_proportion;
+    float train_tree_proportion;
+    char max_features[24];
+    int bootstrap; // Carved out of max_features, which was zero-padded: BOOTSTRAP_COPY is 0 in older files
+    int splitter;  // Carved out of max_features, which was zero-padded: SPLITTER_BEST is 0 in older files
+} CheckpointHeader;
+
+/**
+ * @brief Checkpoint file of one process.
+ */
+typedef struct Checkpoint {
+    MPI_File file;          /**< File opened by all processes. */
+    MPI_Win offset_win;     /**< Window holding the next free offset on process 0. */
+    long long *next_offset; /**< Base of offset_win. */
+    MPI_Request request;    /**< Outstanding write of this process. */
+    void *record;           /**< Buffer of the outstanding write. */
+    int pending;            /**< Whether a write is outstanding. */
+} Checkpoint;
+
+/**
+ * @brief Opens or creates the checkpoint file. Collective over MPI_COMM_WORLD.
+ *
+ * Without resume any previous content is discarded. With resume, process 0 checks the
+ * header against the current parameters (aborting on mismatch), reads the complete
+ * records and truncates the file after the last valid one, e.g. a record cut by a
+ * preempted job. The finished flags are then broadcast to every process.
+ *
+ * @param checkpoint Structure to initialize.
+ * @param path Path of the checkpoint file.
+ * @param resume Whether to keep the trees already in the file.
+ * @param header Parameters of the current run.
+ * @param num_trees Number of trees of the current run.
+ * @param finished Array of num_trees flags, set to 1 for the trees found in the checkpoint.
+ * @param finished_trees On process 0, pointer to store an array of num_trees trees indexed by tree id,
+ *                       where only the finished trees have a root (NULL if nothing was loaded).
+ * @param num_finished Pointer to store the number of trees found in the checkpoint.
+ */
+void checkpoint_open(Checkpoint *checkpoint, const char *path, int resume, const CheckpointHeader *header,
+                     int num_trees, int *finished, Tree **finished_trees, int *num_finished);
+
+/**
+ * @brief Appends a trained tree to the checkpoint without waiting for the write to complete.
+ *
+ * Waits for the previous write of this process, if any, before starting the new one.
+ *
+ * @param checkpoint Structure returned by checkpoint_open().
+ * @param tree The trained tree.
+ * @param tree_id Global id of the tree.
+ */
+void checkpoint_write_tree(Checkpoint *checkpoint, Tree *tree, int tree_id);
+
+/**
+ * @brief Waits for the outstanding write and closes the file. Collective over MPI_COMM_WORLD.
+ *
+ * @param checkpoint Structure returned by checkpoint_open().
+ */
+void checkpoint_close(Checkpoint *checkpoint);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,66 @@
+/**
+ * @file data_parallel.h
+ * @brief Data-parallel construction of a single decision tree across MPI processes.
+ *
+ * In this mode the training rows are partitioned across processes instead of the trees.
+ * Every process only holds its block of rows; at each node the processes build per-feature
+ * class histograms over their local rows, combine them with MPI_Allreduce and then all
+ * apply the same split. A tree can therefore use the memory and cores of every node.
+ *
+ * Features are discretized in num_bins uniform bins between the global minimum and maximum
+ * of the tree sample, so the candidate thresholds are the bin edges rather than every
+ * midpoint between sorted values as in find_best_split_1d(). With SPLITTER_RANDOM the
+ * histograms are replaced by one random threshold per selected feature between its global
+ * min and max at the node, and the processes only reduce those ranges and the class counts
+ * left of each threshold. With SPLITTER_APPROX the bin edges are num_bins - 1 quantiles of
+ * the node rows instead, read from quantile sketches built by every process and merged.
+ */
+#ifndef DATA_PARALLEL_H
+#define DATA_PARALLEL_H
+
+#include "tree/tree.h"
+#include "tree/numa.h"
+
+/**
+ * @brief Scatters contiguous blocks of rows from process 0 to all processes.
+ *
+ * Blocks are sized as in distribute_trees(). Collective over MPI_COMM_WORLD.
+ *
+ * @param data The full matrix, only meaningful on process 0.
+ * @param num_rows Total number of rows of the matrix.
+ * @param num_columns Number of columns of the matrix.
+ * @param local_data Pointer to store the allocated block of this process.
+ * @param local_rows Pointer to store the number of rows of the block.
+ * @param first_row Pointer to store the index of the first row of the block in the full matrix.
+ */
+void scatter_rows(float *data, int num_rows, int num_columns, float **local_data, int *local_rows, int *first_row);
+
+/**
+ * @brief Trains one tree cooperatively on the rows partitioned across all processes.
+ *
+ * Must be called by every process of MPI_COMM_WORLD with the same parameters, except for
+ * local_data and local_rows. Each process draws sample_proportion of its local rows without
+ * replacement; the feature subsets are drawn from tree_seed and are therefore identical on
+ * every process, so all processes end up with the same tree.
+ *
+ * @param tree Pointer to the tree structure to be trained.
+ * @param local_data Block of training rows owned by this process.
+ * @param local_rows Number of rows in local_data.
+ * @param num_columns Number of features in the dataset (including the label).
+ * @param num_classes Number of unique classes in the dataset.
+ * @param max_depth Maximum allowed depth for the tree.
+ * @param min_samples_split Minimum number of samples (over all processes) required to split a node.
+ * @param max_features Strategy for selecting features to consider for splitting.
+ * @param splitter SPLITTER_BEST (uniform histograms), SPLITTER_RANDOM or SPLITTER_APPROX (quantile histograms).
+ * @param sample_proportion Proportion of the local rows drawn for this tree.
+ * @param num_bins Number of histogram bins per feature.
+ * @param tree_seed Seed of this tree, e.g. seed + tree id.
+ * @param num_threads Number of OpenMP threads used to build the local histograms.
+ * @param replicas Copies of local_data per NUMA node (see numa_replicas_create()), NULL to read local_data.
+ */
+void train_tree_data_parallel(Tree *tree, float *local_data, int local_rows, int num_columns, int num_classes,
+                              int max_depth, int min_samples_split, char *max_features, int splitter,
+                              float sample_proportion, int num_bins, int tree_seed, int num_threads,
+                              const NumaReplicas *replicas);
+
+#endif // DATA_PARALLEL_H
@@ -0,0 +1,63 @@
+/**
+ * @file feature_parallel.h
+ * @brief Feature-parallel (vertical) construction of a single decision tree across MPI processes.
+ *
+ * In this mode each process owns a contiguous block of feature columns for all the
+ * training rows. At every node all processes draw the same feature subset, each one runs
+ * the split search of find_best_split_1d() (sort + sweep, one random threshold with
+ * SPLITTER_RANDOM, or sketch cut points with SPLITTER_APPROX) on the selected features it
+ * owns, and an MPI_Allreduce with MPI_MINLOC picks the winner. The owner of
+ * the winning feature broadcasts a left/right bitmap of the node rows so that every
+ * process partitions its columns identically.
+ *
+ * Ties are resolved by the position of the feature in the random draw, as in the
+ * sequential search, so the trees are identical to the ones of the tree-parallel mode.
+ */
+#ifndef FEATURE_PARALLEL_H
+#define FEATURE_PARALLEL_H
+
+#include "tree/tree.h"
+
+/**
+ * @brief Extracts the block of feature columns owned by this process.
+ *
+ * Features are split in contiguous blocks as in distribute_trees(). The returned matrix is
+ * row-major with num_local_features + 1 columns, the last one being the label.
+ *
+ * @param data The full matrix (features + label).
+ * @param num_rows Number of rows of the matrix.
+ * @param num_columns Number of columns of the matrix (features + label).
+ * @param first_feature Pointer to store the global index of the first owned feature.
+ * @param num_local_features Pointer to store the number of owned features.
+ * @return A dynamically allocated matrix with the owned columns and the label.
+ */
+float *extract_feature_block(float *data, int num_rows, int num_columns, int *first_feature, int *num_local_features);
+
+/**
+ * @brief Trains one tree cooperatively, each process searching splits on its own features.
+ *
+ * Must be called by every process of MPI_COMM_WORLD with the same parameters, except for
+ * the local block of columns. The bootstrap is drawn from tree_seed, identically on every
+ * process, and all processes end up with the same tree.
+ *
+ * @param tree Pointer to the tree structure to be trained.
+ * @param local_columns Block returned by extract_feature_block().
+ * @param num_rows Number of training rows.
+ * @param first_feature Global index of the first owned feature.
+ * @param num_local_features Number of owned features.
+ * @param num_columns Number of columns of the full dataset (features + label).
+ * @param num_classes Number of unique classes in the dataset.
+ * @param max_depth Maximum allowed depth for the tree.
+ * @param min_samples_split Minimum number of samples required to consider a split.
+ * @param max_features Strategy for selecting features to consider for splitting.
+ * @param splitter One of the SPLITTER_* values (see find_best_split_1d()).
+ * @param sample_proportion Proportion of the training rows drawn for this tree.
+ * @param tree_seed Seed of this tree, e.g. seed + tree id.
+ * @param num_threads Number of OpenMP threads used by the split search.
+ */
+void train_tree_feature_parallel(Tree *tree, float *local_columns, int num_rows, int first_feature,
+                                 int num_local_features, int num_columns, int num_classes,
+                                 int max_depth, int min_samples_split, char *max_features, int splitter,
+                                 float sample_proportion, int tree_seed, int num_threads);
+
+#endif // FEATURE_PARALLEL_H
@@ -26,7 +26,7 @@ typedef struct Forest {
     int num_trees;          /**< Number of trees in the forest. */
     int max_depth;          /**< Maximum depth for each tree. */
     int min_samples_split;  /**< Minimum number of samples required to split a node. */
-    char* max_features;     /**< Number of features to consider when looking for the best split. Possible values: {“sqrt”, “log2”, "int"} */
+    char max_features[32];  /**< Number of features to consider when looking for the best split. Possible values: {“sqrt”, “log2”, "int"} */
     Tree* trees;            /**< Array of decision trees in the forest. */
 } Forest;
 
@@ -37,9 +37,10 @@ typedef struct Forest {
  * @param num_trees Number of trees in the forest.
  * @param max_depth Maximum depth for each tree.
  * @param min_samples_split Minimum number of samples required to split a node.
- * @param max_features Number of features to consider when looking for the best split.
+ * @param max_features Number of features to consider when looking for the best split, copied
+ *                     into the forest (truncated to its max_features array).
  */
-void create_forest(Forest *forest, int num_trees, int max_depth, int min_samples_split, char* max_features);
+void create_forest(Forest *forest, int num_trees, int max_depth, int min_samples_split, const char* max_features);
 
 /**
  * @brief Trains the random forest on the provided dataset.
@@ -70,21 +71,59 @@ int* forest_inference(Forest *forest, float **data, int num_rows, int num_classe
  */
 void free_forest(Forest *forest);
 
+#define FOREST_MODEL_FILE "forest.bin"  // Single model file inside the forest directory
+#define FOREST_MODEL_MAGIC 0x4C444D46     // "FMDL"
+
 /**
- * @brief Serializes the random forest to a binary file.
+ * @brief Serializes the random forest to a directory.
+ *
+ * Writes the same forest_config.txt as the sequential and openmp builds, followed by a single
+ * FOREST_MODEL_FILE holding a header (magic, number of trees) and, for every tree in order,
+ * its size and its serialize_tree_to_buffer() image without the training statistics.
  *
  * @param forest Pointer to the Forest structure to be serialized.
- * @param filename Path to the output file where the forest will be saved.
+ * @param filename Path to the output directory where the forest will be saved.
  */
 void serialize_forest(Forest *forest, const char *filename);
 
 /**
- * @brief Deserializes a random forest from a binary file.
+ * @brief Deserializes a random forest from a directory.
+ *
+ * Reads forest_config.txt and then the trees, either from the FOREST_MODEL_FILE written by
+ * serialize_forest() or, when it is missing, from the random_tree_<i>.bin files produced by
+ * the sequential and openmp builds. Allocates forest->trees. On failure nothing stays
+ * allocated and forest->num_trees is left to 0.
  *
  * @param forest Pointer to the Forest structure to be deserialized.
- * @param filename Path to the input file from which the forest will be loaded.
+ * @param filename Path to the directory from which the forest will be loaded.
+ * @return 0 on success, -1 if the config file, the model file or a tree file is missing or
+ *         malformed.
+ */
+int deserialize_forest(Forest *forest, const char *filename);
+
+#include <stdio.h>
+
+/**
+ * @brief Writes the FOREST_MODEL_FILE image of a forest (header, then size and payload of every tree).
+ *
+ * @param forest The forest to write.
+ * @param model_file File opened for binary writing, positioned where the image starts.
+ * @return 0 on success, 1 on a write error.
+ */
+int write_forest_model(const Forest *forest, FILE *model_file);
+
+/**
+ * @brief Reads a FOREST_MODEL_FILE image into forest->trees.
+ *
+ * The forest must have been created with create_forest() with the number of trees of the image.
+ * On failure the trees read so far are destroyed.
+ *
+ * @param forest The forest to fill.
+ * @param model_file File opened for binary reading, positioned where the image starts.
+ * @return 0 on success, 1 if the image is malformed, holds an empty tree or does not match
+ *         forest->num_trees.
  */
-void deserialize_forest(Forest *forest, const char *filename);
+int read_forest_model(Forest *forest, FILE *model_file);
 
 int* forest_inference_1d(Forest *forest, float *data, int num_rows, int num_columns, int num_classes);
 #endif
@@ -30,26 +30,44 @@ void deserialize_forest_from_buffer(const void* buffer, Forest* forest);
 Forest* deserialize_forest_from_buffer_new(const void* buffer);
 
 /**
- * @brief Receives forest data from other processes in a distributed environment.
+ * @brief Receives this process' share of a forest scattered by distribute_forest().
  * 
- * This function collects serialized tree data from multiple processes and 
- * deserializes them into a complete forest structure.
+ * Called by every process except the root, in the same collective as distribute_forest().
+ * The serialized trees are received with MPI_Scatterv and rebuilt with
+ * deserialize_tree_from_buffer().
  * 
- * @param num_trees_received Pointer to store the total number of trees received.
- * @return A dynamically allocated array of Tree pointers forming the complete forest.
+ * @param num_trees_received Pointer to store the number of trees received.
+ * @return A dynamically allocated array of the received trees (NULL if none).
  */
-Tree **receive_forest(int *num_trees_received);
+Tree *receive_forest(int *num_trees_received);
 
 /**
- * @brief Distributes forest data across multiple processes.
+ * @brief Scatters a forest from the root across all processes of MPI_COMM_WORLD.
  * 
- * This function splits a forest among multiple processes for distributed 
- * inference or evaluation. Each process receives a portion of the forest 
- * appropriate to its computational resources.
+ * Called by process 0 only. Trees are split in contiguous blocks as in distribute_trees(),
+ * serialized with serialize_tree_to_buffer() and sent with MPI_Scatterv (tree sizes first,
+ * then the packed payload). The forest given as input is left untouched.
  * 
- * @param forest Array of Tree pointers representing the complete random forest.
+ * @param forest Array of trees representing the complete random forest.
  * @param num_trees Total number of trees in the forest to distribute.
- * @param process_number Number of processes to distribute the forest across.
+ * @param num_trees_received Pointer to store the number of trees kept by the root.
+ * @return A dynamically allocated array with the root's own share of trees (NULL if none).
  */
-void distribute_forest(Tree **forest, int num_trees, int process_number);
+Tree *distribute_forest(Tree *forest, int num_trees, int *num_trees_received);
+
+/**
+ * @brief Collects the trees trained by every process on process 0.
+ *
+ * Collective over MPI_COMM_WORLD. Every process serializes its trees with
+ * serialize_tree_to_buffer(); process 0 gathers the tree counts, then the tree ids and
+ * sizes, then the packed payload with MPI_Gatherv and rebuilds every tree in the slot
+ * given by its id. The local trees are left untouched.
+ *
+ * @param trees Trees trained by this process.
+ * @param tree_ids Global id of each local tree.
+ * @param num_local_trees Number of local trees.
+ * @param forest_trees On process 0, array indexed by tree id receiving the gathered trees
+ *                     (ignored on the other processes).
+ */
+void gather_forest(Tree *trees, const int *tree_ids, int num_local_trees, Tree *forest_trees);
 #endif /* FOREST_BUFFER_SERIALIZATION_H */
@@ -15,6 +15,8 @@
 #ifndef METRICS_H  
 #define METRICS_H 
 
+#include "tree/tree.h"
+
 /**
  * @brief Computes accuracy for each class.
  * 
@@ -64,23 +66,21 @@ float** precision_recall(int *predictions, int *targets, int size, int num_class
 void compute_metrics(int *predictions, int *targets, int size, int num_classes, const char* metrics_path, int rank);
 
 /**
- * @brief Aggregates predictions from multiple processes and computes/saves performance metrics.
+ * @brief Turns a reduced vote matrix into predictions and computes/saves performance metrics.
  * 
- * This function collects predictions from all processes in a distributed environment,
- * aggregates them, computes the performance metrics (accuracy, precision, recall),
- * and saves both the predictions and metrics to specified files.
+ * Each sample is assigned the class with the most votes (lowest class index on ties),
+ * then the predictions and the metrics (accuracy, precision, recall) are saved to the
+ * specified files.
  * 
- * @param process_number The total number of processes in the distributed environment.
  * @param test_size The number of samples in the test dataset.
  * @param num_classes The number of unique classes in the dataset.
- * @param all_predictions A 2D array containing predictions from all processes.
+ * @param votes test_size x num_classes matrix with the votes of every tree in the forest.
  * @param targets Array of true class labels.
  * @param store_predictions_path The path to the file where predictions will be saved.
  * @param store_metrics_path The path to the file where metrics will be saved.
  * @param rank The rank of the current process in the distributed environment.
  */
-void aggregate_and_save_predictions(int process_number, int test_size, int num_classes,
-                                     int **all_predictions, int *tree_count, int *targets,
-                                     const char *store_predictions_path, const char *store_metrics_path, int rank);
+void aggregate_and_save_predictions(int test_size, int num_classes, const vote_t *votes, int *targets,
+                                    const char *store_predictions_path, const char *store_metrics_path, int rank);
 
 #endif
@@ -0,0 +1,96 @@
+/**
+ * @file oob.h
+ * @brief Online out-of-bag evaluation of a forest while it grows, with early stopping.
+ *
+ * The rows a tree's bootstrap leaves out are a free validation set for that tree. As every
+ * tree finishes, its out-of-bag rows are scored into a train_size x num_classes vote matrix,
+ * and the out-of-bag accuracy of the forest so far is the accuracy of the majority vote on
+ * the rows that received at least one vote.
+ *
+ * Training proceeds in rounds: in every round each process trains at most one tree, and the
+ * votes of the round are summed over all processes with MPI_Allreduce. Every process then
+ * holds the same matrix and takes the same decision. Once OOB_MIN_COVERAGE of the rows
+ * have votes, growth stops when the best accuracy has not improved by more than the
+ * tolerance over the last OOB_PATIENCE_TREES trees. It also stops once a round is empty.
+ *
+ * The out-of-bag rows of tree t are recomputed from seed + t (see draw_bootstrap()), so the
+ * bootstrap buffers of the training loop are not needed, and trees loaded from a checkpoint
+ * can be evaluated as well.
+ */
+#ifndef OOB_H
+#define OOB_H
+
+#include <mpi.h>
+
+#include "tree/tree.h"
+
+#define OOB_PATIENCE_TREES 10  // Trees without improvement after which the forest stops growing
+#define OOB_MIN_COVERAGE 0.95  // Fraction of the rows with out-of-bag votes before the patience starts
+
+/**
+ * @brief Out-of-bag state of one process; the vote matrix is the same on every process.
+ */
+typedef struct OobTracker {
+    const float *train_data;   /**< Training matrix (features + label). */
+    int train_size;            /**< Number of rows of train_data. */
+    int num_columns;           /**< Number of columns of train_data, label included. */
+    int num_classes;           /**< Number of target classes. */
+    float sample_proportion;   /**< Proportion of the rows drawn for each tree. */
+    int replacement;           /**< Whether the bootstraps are drawn with replacement. */
+    float tolerance;           /**< Smallest accuracy gain that counts as an improvement. */
+    int num_threads;           /**< OpenMP threads scoring the out-of-bag rows. */
+    vote_t *votes;             /**< train_size x num_classes votes of all the trees so far. */
+    vote_t *round_votes;       /**< Votes of the trees of this process in the current round. */
+    int *counts;               /**< Scratch bootstrap counts, train_size entries. */
+    int *rows;                 /**< Scratch bootstrap rows. */
+    int round_trees;           /**< Trees added by this process in the current round. */
+    int num_trees;             /**< Trees of all processes folded into votes. */
+    double accuracy;           /**< Out-of-bag accuracy after the last round. */
+    int num_scored_rows;       /**< Rows with at least one out-of-bag vote. */
+    double best_accuracy;      /**< Best accuracy so far. */
+    int best_trees;            /**< Number of trees when best_accuracy was reached. */
+} OobTracker;
+
+/**
+ * @brief Allocates the tracker; aborts the job if memory runs out.
+ *
+ * @param oob Tracker to initialize.
+ * @param train_data Training matrix (features + label), read until oob_tracker_free().
+ * @param train_size Number of training rows.
+ * @param num_columns Number of columns, label included.
+ * @param num_classes Number of target classes.
+ * @param sample_proportion Proportion of the rows drawn for each tree.
+ * @param replacement Whether the bootstraps are drawn with replacement.
+ * @param tolerance Smallest accuracy gain that counts as an improvement.
+ * @param num_threads OpenMP threads scoring the out-of-bag rows.
+ */
+void oob_tracker_create(OobTracker *oob, const float *train_data, int train_size, int num_columns,
+                        int num_classes, float sample_proportion, int replacement, float tolerance,
+                        int num_threads);
+
+/**
+ * @brief Scores the out-of-bag rows of a tree into the votes of the current round.
+ *
+ * @param oob Tracker.
+ * @param tree Trained tree.
+ * @param tree_seed Seed its bootstrap was drawn with, i.e. seed + tree id.
+ */
+void oob_tracker_add_tree(OobTracker *oob, const Tree *tree, int tree_seed);
+
+/**
+ * @brief Ends a round: sums its votes over all processes and updates the accuracy.
+ *
+ * Collective over comm, every process must call it once per round even without a tree.
+ *
+ * @param oob Tracker.
+ * @param comm Communicator of the processes growing the forest.
+ * @return 1 if the forest should stop growing, 0 otherwise; the same on every process.
+ */
+int oob_tracker_end_round(OobTracker *oob, MPI_Comm comm);
+
+/**
+ * @brief Releases the buffers of the tracker.
+ */
+void oob_tracker_free(OobTracker *oob);
+
+#endif // OOB_H
@@ -0,0 +1,68 @@
+/**
+ * @file pipeline.h
+ * @brief Pipelined forest training, where each tree is scored and its votes reduced while the next one trains.
+ *
+ * Training proceeds in rounds: in every round each process takes at most one tree id from
+ * the scheduler, trains it, scores the test set into the vote buffer of the round and starts
+ * an MPI_Ireduce of that buffer towards process 0. Process 0 adds each completed round to
+ * the global vote matrix, so when the last tree finishes only the final rounds are still in
+ * flight instead of the whole scoring and reduction.
+ *
+ * PIPELINE_DEPTH rounds may be in flight at the same time, which bounds how far a process
+ * can run ahead of the slowest one. Every round also carries an MPI_Iallreduce of a "trained
+ * a tree" flag: once a whole round is empty all processes stop together.
+ *
+ * Note: the reductions only progress while processes are inside MPI calls unless the MPI
+ * library provides asynchronous progress (e.g. MPICH_ASYNC_PROGRESS=1).
+ */
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "scheduler.h"
+#include "checkpoint.h"
+#include "tree/tree.h"
+
+#define PIPELINE_DEPTH 2  // Rounds whose reductions may be in flight at the same time
+
+/**
+ * @brief Trains the trees handed out by the scheduler, scoring and reducing each one as it finishes.
+ *
+ * Collective over MPI_COMM_WORLD. The bootstrap of tree t is drawn with seed + t as in the
+ * non-pipelined training, so the resulting forest and votes are the same.
+ *
+ * @param scheduler Scheduler created over MPI_COMM_WORLD, handing out positions in tree_ids.
+ * @param tree_ids Global ids of the trees to train.
+ * @param num_scheduled Number of entries of tree_ids.
+ * @param trees Array with room for num_trees trees, filled with the trees of this process.
+ * @param local_tree_ids Array with room for num_trees ids, filled with the global id of each local tree.
+ * @param num_trees Total number of trees in the forest.
+ * @param checkpoint Checkpoint receiving every trained tree, or NULL.
+ * @param train_data Training matrix (features + label).
+ * @param train_size Number of training rows.
+ * @param test_data Test matrix (features + label).
+ * @param test_size Number of test rows.
+ * @param num_columns Number of columns (features + label).
+ * @param num_classes Number of unique classes in the dataset.
+ * @param max_depth Maximum allowed depth for the trees.
+ * @param min_samples_split Minimum number of samples required to consider a split.
+ * @param max_features Strategy for selecting features to consider for splitting.
+ * @param splitter One of the SPLITTER_* values (see find_best_split_1d()).
+ * @param bootstrap One of the BOOTSTRAP_* values (see draw_bootstrap()).
+ * @param sample_proportion Proportion of the training rows drawn for each tree.
+ * @param seed Base seed, tree t uses seed + t.
+ * @param num_threads Number of OpenMP threads used by the split search.
+ * @param global_votes test_size x num_classes vote matrix receiving the sum over all trees,
+ *                     only used on process 0 and expected to be zeroed.
+ * @param train_time Pointer to store the time spent training.
+ * @param inference_time Pointer to store the time spent scoring and waiting for reductions.
+ * @return The number of trees trained by this process.
+ */
+int train_and_score_pipelined(TreeScheduler *scheduler, const int *tree_ids, int num_scheduled,
+                              Tree *trees, int *local_tree_ids, int num_trees, Checkpoint *checkpoint,
+                              float *train_data, int train_size, float *test_data, int test_size,
+                              int num_columns, int num_classes, int max_depth, int min_samples_split,
+                              char *max_features, int splitter, int bootstrap, float sample_proportion,
+                              int seed, int num_threads, vote_t *global_votes, double *train_time,
+                              double *inference_time);
+
+#endif // PIPELINE_H
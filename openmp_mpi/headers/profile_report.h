@@ -0,0 +1,21 @@
+/**
+ * @file profile_report.h
+ * @brief Collection of the per-process profiles (see tree/profile.h) into a JSON report.
+ *
+ * Process 0 gathers the Profile of every process and writes one JSON document holding the
+ * maximum time of every phase across processes, then, for every process, its phase times,
+ * the per-depth node counts, size histograms and sort/search/partition times, and the split
+ * sweep time of every thread.
+ */
+#ifndef PROFILE_REPORT_H
+#define PROFILE_REPORT_H
+
+/**
+ * @brief Gathers the profiles on process 0 and writes the report. Collective over MPI_COMM_WORLD.
+ *
+ * @param path Path of the JSON file written by process 0.
+ * @param num_threads Number of OpenMP threads used by every process.
+ */
+void profile_write_report(const char *path, int num_threads);
+
+#endif // PROFILE_REPORT_H
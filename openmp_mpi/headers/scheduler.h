@@ -0,0 +1,58 @@
+/**
+ * @file scheduler.h
+ * @brief Assignment of tree ids to MPI processes during forest training.
+ *
+ * Trees are identified by a global id in [0, num_trees). With the static schedule each
+ * process trains the contiguous block computed by distribute_trees(). With the dynamic
+ * schedule processes pull the next id from a counter stored on process 0 through MPI
+ * one-sided MPI_Fetch_and_op, so fast processes keep training while slow ones are still
+ * busy with deep trees.
+ *
+ * Note: the counter lives in process 0's memory. If the MPI library has no hardware or
+ * shared-memory atomics, the fetches only progress when process 0 enters MPI, in which
+ * case asynchronous progress should be enabled (e.g. MPICH_ASYNC_PROGRESS=1).
+ */
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <mpi.h>
+
+/**
+ * @brief State of the tree scheduler of one process.
+ */
+typedef struct TreeScheduler {
+    int dynamic;      /**< 1 to pull ids from the shared counter, 0 for the static assignment. */
+    int next_tree;    /**< Next id of the static assignment. */
+    int end_tree;     /**< One past the last id of the static assignment. */
+    int *counter;     /**< Shared counter (only allocated on process 0 in dynamic mode). */
+    MPI_Win win;      /**< Window exposing the counter (dynamic mode only). */
+} TreeScheduler;
+
+/**
+ * @brief Initializes the scheduler. Collective over comm.
+ *
+ * @param scheduler Scheduler to initialize.
+ * @param dynamic 1 for the dynamic schedule, 0 for the static one.
+ * @param first_tree First id of the static assignment of this process.
+ * @param num_trees_assigned Number of ids of the static assignment of this process.
+ * @param comm Communicator of the processes sharing the forest.
+ */
+void tree_scheduler_create(TreeScheduler *scheduler, int dynamic, int first_tree, int num_trees_assigned, MPI_Comm comm);
+
+/**
+ * @brief Returns the next tree id to train, or -1 once the forest is complete.
+ *
+ * @param scheduler Scheduler returned by tree_scheduler_create().
+ * @param num_trees Total number of trees in the forest.
+ * @return A tree id in [0, num_trees), or -1 if no tree is left.
+ */
+int tree_scheduler_next(TreeScheduler *scheduler, int num_trees);
+
+/**
+ * @brief Releases the scheduler. Collective over the communicator given at creation.
+ *
+ * @param scheduler Scheduler returned by tree_scheduler_create().
+ */
+void tree_scheduler_free(TreeScheduler *scheduler);
+
+#endif // SCHEDULER_H
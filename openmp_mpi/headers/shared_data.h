@@ -0,0 +1,67 @@
+/**
+ * @file shared_data.h
+ * @brief Node-level sharing of the train/test matrices through MPI-3 shared-memory windows.
+ *
+ * When many ranks run on the same physical node, every rank normally holds its own
+ * copy of the dataset and of the train/test split. The functions declared here keep a
+ * single copy of the training and test matrices per node: only one rank per node (the
+ * node leader) receives the dataset through an inter-node broadcast and performs the
+ * stratified split, while all the other local ranks read the matrices directly from
+ * the leader's shared window.
+ */
+#ifndef SHARED_DATA_H
+#define SHARED_DATA_H
+
+#include <mpi.h>
+
+/**
+ * @brief Communicators and windows backing a node-shared dataset.
+ */
+typedef struct SharedDataset {
+    MPI_Comm node_comm;    /**< Ranks sharing the same physical node. */
+    MPI_Comm leader_comm;  /**< One rank per node (node_rank == 0), MPI_COMM_NULL elsewhere. */
+    int node_rank;         /**< Rank inside node_comm. */
+    MPI_Win train_win;     /**< Shared window holding the training matrix. */
+    MPI_Win test_win;      /**< Shared window holding the test matrix. */
+} SharedDataset;
+
+/**
+ * @brief Broadcasts the dataset once per node and splits it into node-shared train/test matrices.
+ *
+ * Must be called by all ranks of MPI_COMM_WORLD. The dataset is only broadcast among node
+ * leaders, each leader runs the same stratified split as the non-shared path and stores
+ * the result in shared windows which are then mapped by every local rank. The returned
+ * matrices are read-only for all ranks and must be released with shared_dataset_free_train()
+ * and shared_dataset_free_test() instead of free().
+ *
+ * @param shared Structure to initialize with communicators and windows.
+ * @param data The full dataset, only meaningful on rank 0. It is freed by this function.
+ * @param num_rows Total number of rows in the dataset.
+ * @param num_columns Number of columns in the dataset (including the class label).
+ * @param num_classes Number of different classes in the dataset.
+ * @param train_proportion Proportion of data to be used for training (between 0 and 1).
+ * @param seed Random seed for reproducible splitting.
+ * @param train_data Pointer to store the node-shared training matrix.
+ * @param train_size Pointer to store the number of samples in the training set.
+ * @param test_data Pointer to store the node-shared test matrix.
+ * @param test_size Pointer to store the number of samples in the test set.
+ */
+void shared_dataset_split(SharedDataset *shared, float *data, int num_rows, int num_columns,
+                          int num_classes, float train_proportion, int seed,
+                          float **train_data, int *train_size, float **test_data, int *test_size);
+
+/**
+ * @brief Releases the node-shared training matrix. Collective over the node.
+ *
+ * @param shared Structure returned by shared_dataset_split().
+ */
+void shared_dataset_free_train(SharedDataset *shared);
+
+/**
+ * @brief Releases the node-shared test matrix and the communicators. Collective over the node.
+ *
+ * @param shared Structure returned by shared_dataset_split().
+ */
+void shared_dataset_free_test(SharedDataset *shared);
+
+#endif // SHARED_DATA_H
@@ -0,0 +1,86 @@
+/**
+ * @file counters.h
+ * @brief Work counters of tree construction, compiled in with -DWORK_COUNTERS (make COUNTERS=1).
+ *
+ * The counters measure how much work training does, independently of how fast it runs:
+ * candidate thresholds, entropy evaluations, bytes copied when partitioning, nodes, leaves
+ * by stop reason and malloc calls. Every OpenMP thread increments its own cache-line padded
+ * slot, and the slots are merged into the process totals at the end of every tree.
+ *
+ * Without WORK_COUNTERS the macros expand to nothing, so the hot paths are unchanged.
+ */
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+/**
+ * @brief Quantities counted during tree construction.
+ */
+typedef enum WorkCounter {
+    COUNTER_CANDIDATES,           /**< Candidate thresholds considered by the split sweeps. */
+    COUNTER_ENTROPY_EVALS,        /**< Weighted entropies computed by the split sweeps. */
+    COUNTER_BYTES_COPIED,         /**< Bytes copied by split_data_1d_safe(). */
+    COUNTER_NODES,                /**< Nodes created. */
+    COUNTER_LEAVES_MIN_SAMPLES,   /**< Leaves with fewer than min_samples_split samples. */
+    COUNTER_LEAVES_MAX_DEPTH,     /**< Leaves at the maximum depth. */
+    COUNTER_LEAVES_NO_GAIN,       /**< Leaves whose best split does not lower the entropy. */
+    COUNTER_MALLOCS,              /**< malloc() calls made while growing the trees. */
+    COUNTER_COUNT
+} WorkCounter;
+
+#define COUNTER_MAX_THREADS 256  // Threads beyond this share the last slot
+
+#ifdef WORK_COUNTERS
+
+#include <omp.h>
+
+/**
+ * @brief Counters of one thread, padded to two cache lines to avoid false sharing.
+ */
+typedef union CounterSlot {
+    long long value[COUNTER_COUNT];
+    char padding[128];
+} CounterSlot;
+
+extern CounterSlot counter_slots[COUNTER_MAX_THREADS];
+
+#define COUNTER_SLOT() \
+    (&counter_slots[omp_get_thread_num() < COUNTER_MAX_THREADS ? omp_get_thread_num() : COUNTER_MAX_THREADS - 1])
+
+/** @brief Adds n to a counter of the calling thread. */
+#define COUNTER_ADD(counter, n) (COUNTER_SLOT()->value[counter] += (long long)(n))
+
+/** @brief Declares a local accumulator, for loops that add to a counter once at the end. */
+#define COUNTER_LOCAL(name) long long name = 0
+#define COUNTER_LOCAL_ADD(name, n) ((name) += (n))
+
+#else
+
+#define COUNTER_ADD(counter, n) ((void)0)
+#define COUNTER_LOCAL(name) ((void)0)
+#define COUNTER_LOCAL_ADD(name, n) ((void)0)
+
+#endif // WORK_COUNTERS
+
+/**
+ * @brief Adds the slots of all threads to the process totals and clears them.
+ *
+ * Called at the end of every tree, outside of parallel regions.
+ */
+void counters_merge(void);
+
+/**
+ * @brief Copies the process totals into totals (COUNTER_COUNT values, all 0 without WORK_COUNTERS).
+ */
+void counters_get(long long *totals);
+
+/**
+ * @brief Returns the name of a counter, e.g. for reports.
+ */
+const char *counter_name(WorkCounter counter);
+
+/**
+ * @brief Returns 1 if the counters are compiled in, 0 otherwise.
+ */
+int counters_enabled(void);
+
+#endif // COUNTERS_H
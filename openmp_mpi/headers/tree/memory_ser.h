@@ -8,52 +8,61 @@
 #include <string.h>
 
 #include "tree.h"
-#include <mpi.h>
 #include <stdint.h>
 
 /**
- * @brief Recursively counts the number of nodes in a tree
- * 
- * @param node The root node to start counting from
- * @return int The total number of nodes in the tree
+ * @brief First int of a tree serialized in the flat layout.
+ *
+ * Buffers without it hold the recursive node format written by older versions, which
+ * deserialize_tree_from_buffer() still reads.
  */
-int count_nodes(const Node* node);
+#define TREE_FORMAT_MAGIC 0x32545246
 
 /**
- * @brief Recursively serializes a node and its children into a buffer
- * 
- * @param node The node to serialize
- * @param buffer The buffer to write serialized data into
- * @param offset Pointer to the current offset in the buffer (will be updated)
+ * @brief First int of a tree serialized in the flat layout without its NodeStats array.
+ *
+ * Inference never reads the training statistics, so saved models leave them out; such a
+ * tree loads with stats == NULL.
  */
-void flatten_node(const Node* node, uint8_t* buffer, int* offset);
+#define TREE_FORMAT_MAGIC_HOT 0x48545246
 
 /**
  * @brief Serializes an entire tree structure into a buffer
  * 
+ * The buffer holds TREE_FORMAT_MAGIC and the node count, then the HotNode array
+ * and the NodeStats array as they are in memory. Without the statistics the magic is
+ * TREE_FORMAT_MAGIC_HOT and only the HotNode array follows.
+ * 
  * @param tree The tree to serialize
+ * @param with_stats Whether to write the NodeStats array; ignored when the tree has none
  * @param out_buffer Pointer to where the allocated buffer should be stored
  * @param out_size Pointer to where the size of the buffer should be stored
  * 
  * @note The caller is responsible for freeing the allocated buffer
  */
-void serialize_tree_to_buffer(const struct Tree* tree, void** out_buffer, int* out_size);
+void serialize_tree_to_buffer(const struct Tree* tree, int with_stats, void** out_buffer, int* out_size);
 
 /**
- * @brief Recursively rebuilds a node from a serialized buffer
+ * @brief Recursively rebuilds a node from a buffer in the legacy recursive format
  * 
  * @param buffer The buffer containing serialized data
+ * @param size Size of the buffer in bytes; no field is read past it
  * @param offset Pointer to the current offset in the buffer (will be updated)
- * @return Node* The reconstructed node
+ * @return Node* The reconstructed node, or NULL if the buffer ends early or memory runs out
  */
-Node* rebuild_node(const uint8_t* buffer, int* offset);
+Node* rebuild_node(const uint8_t* buffer, int size, int* offset);
 
 /**
  * @brief Deserializes a buffer into a tree structure
  * 
+ * Reads both the flat layouts of serialize_tree_to_buffer() and the legacy recursive format.
+ * A tree written without its statistics gets stats == NULL.
+ * 
  * @param buffer The buffer containing serialized tree data
+ * @param size Size of the buffer in bytes
  * @param tree Pointer to the tree structure to populate
+ * @return 0 on success, -1 if the buffer is malformed or memory runs out
  */
-void deserialize_tree_from_buffer(const void* buffer, struct Tree* tree);
+int deserialize_tree_from_buffer(const void* buffer, int size, struct Tree* tree);
 
 #endif /* TREE_SERIALIZATION_H */
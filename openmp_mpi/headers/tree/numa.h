@@ -0,0 +1,97 @@
+/**
+ * @file numa.h
+ * @brief NUMA-aware placement of the large buffers read by the OpenMP threads.
+ *
+ * Linux places a page on the NUMA node of the thread that first writes it. A buffer
+ * allocated and filled by one thread therefore lives on a single socket, and the threads
+ * of the other sockets read it remotely for the whole run. Two remedies are provided:
+ * - first touch: numa_alloc() writes the pages of large buffers from all the threads with a
+ *   static schedule, spreading them over the sockets the threads run on;
+ * - replicas: numa_replicas_create() gives every NUMA node its own copy of a read-only
+ *   matrix, and numa_replica_local() returns the copy of the calling thread's node.
+ *
+ * Both only pay off when the OpenMP threads are bound (OMP_PROC_BIND, OMP_PLACES), so that
+ * a thread keeps running on the node its pages were placed on. Without /sys topology (or
+ * outside Linux) the machine is treated as a single node and replicas are not made.
+ */
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stddef.h>
+
+#define NUMA_TOUCH_MIN_BYTES (1 << 20)  // Smaller buffers are left to malloc
+
+/**
+ * @brief Copies of a read-only matrix, one per NUMA node running a thread.
+ */
+typedef struct NumaReplicas {
+    const float *source;  /**< Original matrix, used by the threads of nodes without a copy. */
+    float **copies;       /**< copies[node], NULL for the nodes without a copy. */
+    int num_nodes;        /**< Entries of copies, 0 when no replica was made. */
+} NumaReplicas;
+
+/**
+ * @brief Enables parallel first touch in numa_alloc().
+ *
+ * @param num_threads Threads writing the pages, 1 or less to disable it (the default).
+ */
+void numa_set_first_touch(int num_threads);
+
+/**
+ * @brief Allocates a buffer whose pages are first written by all the first-touch threads.
+ *
+ * Behaves as malloc() when first touch is disabled or the buffer is smaller than
+ * NUMA_TOUCH_MIN_BYTES. The contents are undefined, as with malloc().
+ *
+ * @param bytes Size of the buffer.
+ * @return The buffer, to release with free(), or NULL if memory runs out.
+ */
+void *numa_alloc(size_t bytes);
+
+/**
+ * @brief Returns the number of NUMA nodes of the machine (1 if unknown).
+ */
+int numa_num_nodes(void);
+
+/**
+ * @brief Returns the NUMA node of the CPU the calling thread runs on (0 if unknown).
+ */
+int numa_current_node(void);
+
+/**
+ * @brief Describes the OpenMP thread binding, e.g. "close over 8 places" or "unbound".
+ *
+ * @param buffer Buffer receiving the description.
+ * @param size Size of the buffer.
+ */
+void numa_describe_binding(char *buffer, size_t size);
+
+/**
+ * @brief Copies a read-only matrix once per NUMA node that runs one of num_threads threads.
+ *
+ * Each copy is allocated and written by a thread of its node, so it is placed there.
+ * On a single-node machine no copy is made and every thread reads the source.
+ *
+ * @param replicas Replicas to fill.
+ * @param source Matrix to copy; must outlive the replicas.
+ * @param count Number of floats of the matrix.
+ * @param num_threads Threads of the parallel region the replicas are read from.
+ * @return Number of copies made, or -1 if memory runs out (then no copy is kept).
+ */
+int numa_replicas_create(NumaReplicas *replicas, const float *source, size_t count, int num_threads);
+
+/**
+ * @brief Returns the copy of the calling thread's NUMA node, or the source without one.
+ *
+ * @param replicas Replicas made by numa_replicas_create().
+ */
+const float *numa_replica_local(const NumaReplicas *replicas);
+
+/**
+ * @brief Frees the copies; the source is left alone.
+ *
+ * @param replicas Replicas made by numa_replicas_create().
+ */
+void numa_replicas_free(NumaReplicas *replicas);
+
+#endif // NUMA_H
@@ -0,0 +1,123 @@
+/**
+ * @file profile.h
+ * @brief Lightweight instrumentation of the run phases and of tree construction by depth.
+ *
+ * When enabled with profile_init(), the functions below accumulate, for the calling process:
+ * - the wall time of every ProfilePhase (parse, broadcast, split, ...);
+ * - for every tree depth, the number of nodes, a histogram of their sizes (power of two
+ *   buckets) and the time spent sorting, searching the split and partitioning the rows;
+ * - for every OpenMP thread, the time spent in the parallel split sweep, the number of sweeps
+ *   (one per node and drawn feature) it took part in, a histogram of their node sizes and the
+ *   candidates it evaluated.
+ *
+ * All functions are cheap no-ops when profiling is disabled. Nodes are grown by a single
+ * thread per process, so only profile_thread_end() is called from parallel regions, and
+ * each thread only writes its own slot.
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#define PROFILE_MAX_DEPTH 64      // Deeper nodes are accounted to the last depth
+#define PROFILE_SIZE_BUCKETS 32   // Bucket b holds node sizes in [2^b, 2^(b+1))
+#define PROFILE_MAX_THREADS 256   // Threads beyond this are not profiled
+
+/**
+ * @brief Top-level phases of a run.
+ */
+typedef enum ProfilePhase {
+    PHASE_PARSE,        /**< CSV reading and label scan. */
+    PHASE_BROADCAST,    /**< Dataset distribution across processes. */
+    PHASE_SPLIT,        /**< Train/test split. */
+    PHASE_SAMPLE,       /**< Bootstrap sampling of the trees. */
+    PHASE_TRAIN,        /**< Tree construction (including the per-depth times). */
+    PHASE_INFERENCE,    /**< Scoring of the test set. */
+    PHASE_AGGREGATION,  /**< Vote reduction, majority vote and metrics. */
+    PHASE_SAVE,         /**< Collection and serialization of the model. */
+    PHASE_COUNT
+} ProfilePhase;
+
+/**
+ * @brief Steps of the construction of one node.
+ */
+typedef enum ProfileStep {
+    STEP_SORT,       /**< Sorting the feature values (exact split search). */
+    STEP_SEARCH,     /**< Sweeping the candidate thresholds (including histograms and reductions). */
+    STEP_PARTITION,  /**< Moving the rows to the children. */
+    STEP_COUNT
+} ProfileStep;
+
+/**
+ * @brief Accumulated profile of one depth.
+ */
+typedef struct DepthProfile {
+    double step_time[STEP_COUNT];            /**< Seconds spent in every step. */
+    double nodes;                            /**< Nodes grown at this depth. */
+    double size_hist[PROFILE_SIZE_BUCKETS];  /**< Nodes by size bucket. */
+} DepthProfile;
+
+/**
+ * @brief Accumulated profile of one OpenMP thread in the parallel split sweep.
+ */
+typedef struct ThreadProfile {
+    double sweep_time;                       /**< Seconds spent in the sweep. */
+    double sweeps;                           /**< Sweeps that evaluated candidates on this thread. */
+    double candidates;                       /**< Candidate thresholds evaluated by this thread. */
+    double size_hist[PROFILE_SIZE_BUCKETS];  /**< Those sweeps by node size bucket. */
+} ThreadProfile;
+
+/**
+ * @brief Profile of the calling process.
+ */
+typedef struct Profile {
+    int enabled;
+    double phase_time[PHASE_COUNT];
+    DepthProfile depths[PROFILE_MAX_DEPTH];
+    ThreadProfile threads[PROFILE_MAX_THREADS];
+    int current_depth;  /**< Depth of the node being grown, set by the grow functions. */
+} Profile;
+
+extern Profile profile;
+
+/**
+ * @brief Resets the profile and enables or disables it.
+ *
+ * @param enabled Non-zero to record.
+ */
+void profile_init(int enabled);
+
+/**
+ * @brief Returns a timestamp to pass to the *_end() functions, or 0 when disabled.
+ */
+double profile_start(void);
+
+/**
+ * @brief Adds the time elapsed since start to a phase.
+ */
+void profile_phase_end(ProfilePhase phase, double start);
+
+/**
+ * @brief Records a node of the given depth and size and makes depth the current one.
+ */
+void profile_node(int depth, int num_samples);
+
+/**
+ * @brief Adds the time elapsed since start to a step of the current depth.
+ */
+void profile_step_end(ProfileStep step, double start);
+
+/**
+ * @brief Adds the time elapsed since start to the split sweep time of the calling thread.
+ *
+ * @param start Timestamp from profile_start().
+ * @param num_samples Size of the node being swept.
+ * @param candidates Candidate thresholds the calling thread evaluated; the sweep is only
+ *                   counted for the thread when it is positive.
+ */
+void profile_thread_end(double start, int num_samples, int candidates);
+
+/**
+ * @brief Returns the lower bound of a size bucket, e.g. for labels.
+ */
+int profile_bucket_min(int bucket);
+
+#endif // PROFILE_H
@@ -0,0 +1,117 @@
+/**
+ * @file sketch.h
+ * @brief Mergeable quantile sketch used to pick approximate split candidates.
+ *
+ * The sketch is a KLL-style hierarchy of levels holding up to 2k values each. An item of
+ * level h stands for 2^h input values. When a level fills up it is sorted and every other
+ * value is promoted to the next level, alternating the kept half from one compaction to the
+ * next. The alternation replaces the random coin of KLL, so the same input always gives the
+ * same sketch. The rank error is O(log(n / k) / k), and the memory is at most 2k values per
+ * level, i.e. O(k log(n / k)) values.
+ *
+ * Two sketches are merged by pushing the items of one into the levels of the other, so the
+ * values of a feature can be sketched in blocks by several threads, or on several MPI
+ * processes, and combined afterwards. The combined sketch only depends on the merge order.
+ */
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stddef.h>
+
+#define SKETCH_DEFAULT_K 256   // Values kept per level after a compaction
+#define SKETCH_MAX_LEVELS 32   // Enough for 2k * 2^31 values
+#define SKETCH_BLOCK_ROWS 8192 // Rows sketched by one thread before the block sketches are merged
+
+/**
+ * @brief Quantile sketch of a stream of floats.
+ */
+typedef struct QuantileSketch {
+    int k;                          /**< Values kept per level after a compaction. */
+    int num_levels;                 /**< Levels allocated in items. */
+    int count[SKETCH_MAX_LEVELS];   /**< Values currently held by each level. */
+    unsigned int parity;            /**< Bit h: half kept by the next compaction of level h. */
+    float *items;                   /**< num_levels x 2k values, level h at items + h * 2k. */
+} QuantileSketch;
+
+/**
+ * @brief Initializes an empty sketch; no memory is allocated until the first value.
+ *
+ * @param sketch Sketch to initialize.
+ * @param k Values kept per level after a compaction, at least 2.
+ */
+void sketch_init(QuantileSketch *sketch, int k);
+
+/**
+ * @brief Empties a sketch, keeping its memory for the next stream.
+ */
+void sketch_reset(QuantileSketch *sketch);
+
+/**
+ * @brief Releases the memory of a sketch.
+ */
+void sketch_free(QuantileSketch *sketch);
+
+/**
+ * @brief Adds one value to the sketch.
+ *
+ * @return 0 on success, -1 if memory runs out.
+ */
+int sketch_add(QuantileSketch *sketch, float value);
+
+/**
+ * @brief Adds the content of src to dst; src is left unchanged.
+ *
+ * @return 0 on success, -1 if memory runs out.
+ */
+int sketch_merge(QuantileSketch *dst, const QuantileSketch *src);
+
+/**
+ * @brief Number of bytes written by sketch_pack().
+ */
+size_t sketch_packed_size(const QuantileSketch *sketch);
+
+/**
+ * @brief Writes the sketch to a flat buffer of sketch_packed_size() bytes, e.g. to send it over MPI.
+ */
+void sketch_pack(const QuantileSketch *sketch, void *buffer);
+
+/**
+ * @brief Merges a sketch written by sketch_pack() into dst.
+ *
+ * @param dst Sketch receiving the values, with the same k as the packed one.
+ * @param buffer Packed sketch.
+ * @return The number of bytes read, or 0 if the buffer does not match dst or memory runs out.
+ */
+size_t sketch_merge_packed(QuantileSketch *dst, const void *buffer);
+
+/**
+ * @brief Candidate cut points at evenly spaced ranks of the sketched values.
+ *
+ * The cuts are strictly increasing and exclude the largest sketched value, so splitting
+ * with value <= cut leaves values on both sides. When the sketch holds at most max_cuts + 1
+ * distinct values, every one of them but the largest is returned.
+ *
+ * @param sketch Sketch of the values.
+ * @param max_cuts Maximum number of cuts.
+ * @param cuts Buffer of max_cuts floats receiving the cuts.
+ * @return The number of cuts, or -1 if memory runs out.
+ */
+int sketch_cuts(const QuantileSketch *sketch, int max_cuts, float *cuts);
+
+/**
+ * @brief Index of the first cut >= value, i.e. the bin of value among num_cuts + 1 bins.
+ */
+static inline int sketch_cut_bin(const float *cuts, int num_cuts, float value) {
+    int low = 0, high = num_cuts;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (cuts[mid] < value) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+#endif // SKETCH_H
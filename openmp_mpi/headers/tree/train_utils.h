@@ -13,7 +13,19 @@
 
 #define EPSILON 1e-9
 
+#define SPLITTER_BEST 0    // Sort each feature and sweep every threshold
+#define SPLITTER_RANDOM 1  // One random threshold per feature (extremely randomized trees)
+#define SPLITTER_APPROX 2  // Only the cut points of a quantile sketch, on nodes larger than APPROX_MIN_ROWS
+
+// Nodes up to this size keep the exact search with SPLITTER_APPROX: the sketch would hold all their values
+#define APPROX_MIN_ROWS (2 * SKETCH_DEFAULT_K)
+
+#define BOOTSTRAP_COPY 0         // Rows drawn without replacement and copied into a sample buffer
+#define BOOTSTRAP_WEIGHTS 1      // Same rows, kept as per-row counts over the shared training matrix
+#define BOOTSTRAP_REPLACEMENT 2  // Rows drawn with replacement, kept as per-row counts
+
 #include "tree.h"
+#include "sketch.h"
 
 /**
  * @brief Finds the index of the maximum value in an array.
@@ -109,6 +121,86 @@ float get_entropy(int *left_class_counts, int *right_class_counts, int left_size
  */
 float* get_best_split_num_var(float *sorted_array, float *target_array, int size, int num_classes, int thread_count);
 
+/**
+ * @brief Weighted version of get_best_split_num_var(): every row counts weight_array[i] times.
+ *
+ * The class counts are accumulated in one pass over the sorted rows, so the sweep is linear.
+ * With unit weights it picks the same split as get_best_split_num_var().
+ *
+ * @param sorted_array Sorted values of a single feature.
+ * @param target_array Classes of the rows, in the order of sorted_array.
+ * @param weight_array Weights of the rows, in the order of sorted_array.
+ * @param size The number of rows.
+ * @param num_classes The number of target classes.
+ * @return A float array laid out as the one of get_best_split_num_var(), with weighted sizes.
+ */
+float* get_best_split_weighted(const float *sorted_array, const int *target_array, const int *weight_array,
+                               int size, int num_classes);
+
+/**
+ * @brief Evaluates a single random threshold of a feature, as in extremely randomized trees.
+ *
+ * The threshold is min + unit * (max - min) over the rows of the node, so the feature is
+ * read twice (min/max, then class counts) and never sorted. A constant feature cannot be
+ * split and gets an infinite entropy.
+ *
+ * @param data The node's rows, with the label in the last column, or the whole matrix with rows.
+ * @param rows Rows of data forming the node, NULL for the first num_rows rows.
+ * @param weights Weight of every node row, NULL for unit weights.
+ * @param num_rows Number of rows.
+ * @param num_columns Number of columns per row (features + label).
+ * @param column The feature to split on.
+ * @param num_classes The number of target classes.
+ * @param unit Position of the threshold in [0, 1) between the feature's min and max.
+ * @return A float array laid out as the one of get_best_split_num_var().
+ */
+float* get_random_split_num_var(const float *data, const int *rows, const int *weights, int num_rows,
+                                int num_columns, int column, int num_classes, float unit);
+
+/**
+ * @brief Position in [0, 1) of the random threshold of a feature at a node.
+ *
+ * The position only depends on one draw per node and on the feature, not on the order
+ * or the process the features are evaluated in, so the feature-parallel mode grows the
+ * same random trees as the tree-parallel one.
+ *
+ * @param split_seed Draw taken from the tree's random stream for the node.
+ * @param feature Index of the feature in the dataset.
+ */
+float random_split_unit(unsigned int split_seed, int feature);
+
+/**
+ * @brief Finds the best split of a feature among the cut points of a quantile sketch.
+ *
+ * The rows are sketched in blocks of SKETCH_BLOCK_ROWS by the threads and the block sketches
+ * are merged in row order, so the result does not depend on the number of threads. A second
+ * pass counts the classes between consecutive cuts, and the sweep only visits the cuts:
+ * the search costs O(num_rows log max_cuts) instead of a sort and a sweep over every row.
+ *
+ * @param data The node's rows, with the label in the last column, or the whole matrix with rows.
+ * @param rows Rows of data forming the node, NULL for the first num_rows rows.
+ * @param weights Weight of every node row, NULL for unit weights.
+ * @param num_rows Number of rows.
+ * @param num_columns Number of columns per row (features + label).
+ * @param column The feature to split on.
+ * @param num_classes The number of target classes.
+ * @param max_cuts Number of candidate cuts, also the k of the sketch.
+ * @param thread_count Threads sketching and counting the rows.
+ * @return A float array laid out as the one of get_best_split_num_var().
+ */
+float* get_approx_split_num_var(const float *data, const int *rows, const int *weights, int num_rows,
+                                int num_columns, int column, int num_classes, int max_cuts, int thread_count);
+
+/**
+ * @brief Returns the next value in [0, INT_MAX] of a random stream, like rand_r().
+ *
+ * All the training randomness goes through an explicit state owned by the caller, so
+ * trees can be trained concurrently and the result only depends on the seed of each tree.
+ *
+ * @param state State of the stream, initialized with the seed and updated at every call.
+ */
+int rng_next(unsigned int *state);
+
 /**
  * @brief Fisher-Yates shuffle algorithm to randomize an array.
  * 
@@ -116,8 +208,51 @@ float* get_best_split_num_var(float *sorted_array, float *target_array, int size
  * 
  * @param array The array to shuffle.
  * @param size The number of elements in the array.
+ * @param rng State of the random stream (see rng_next()).
+ */
+void shuffle(int *array, int size, unsigned int *rng);
+
+/**
+ * @brief Draws a bootstrap sample of the rows without replacement.
+ *
+ * @param train_data The full training dataset.
+ * @param train_size Number of samples in the training dataset.
+ * @param num_columns Number of columns per sample (features + label).
+ * @param sample_proportion Proportion of data to sample (e.g., 0.75 for 75%).
+ * @param sampled_data Output buffer for the sampled data (must be pre-allocated).
+ * @param rng State of the random stream (see rng_next()), usually seeded with seed + tree id.
+ * @return The number of sampled rows, or -1 on failure.
+ */
+int sample_data_without_replacement(float *train_data, int train_size, int num_columns,
+                                    float sample_proportion, float *sampled_data, unsigned int *rng);
+
+/**
+ * @brief Draws a bootstrap sample as per-row counts, without copying any row.
+ *
+ * Without replacement, the rows and the random draws are those of
+ * sample_data_without_replacement(), so the stream continues identically afterwards.
+ * With replacement, sample_proportion * train_size rows are drawn independently and a row
+ * drawn several times gets a count above 1.
+ *
+ * @param train_size Number of samples in the training dataset.
+ * @param sample_proportion Proportion of data to sample (e.g., 0.75 for 75%).
+ * @param replacement Whether rows are drawn with replacement.
+ * @param counts Buffer of train_size counts, filled with the number of draws of every row.
+ * @param rows Buffer of sample_proportion * train_size rows, filled with the drawn rows in draw order.
+ * @param rng State of the random stream (see rng_next()), usually seeded with seed + tree id.
+ * @return The number of distinct rows written to rows, or -1 on failure.
+ */
+int draw_bootstrap(int train_size, float sample_proportion, int replacement, int *counts, int *rows,
+                   unsigned int *rng);
+
+/**
+ * @brief Number of features to evaluate at each split for a max_features strategy.
+ * 
+ * @param max_features Strategy for selecting features: "sqrt", "log2" or an integer.
+ * @param num_features Number of features in the dataset (label excluded).
+ * @return The number of features to evaluate.
  */
-void shuffle(int *array, int size);
+int get_num_selected_features(char *max_features, int num_features);
 
 /**
  * @brief Finds the best split across all features of the dataset.
@@ -165,6 +300,8 @@ void split_data(float **data, float **left_data, float **right_data, int num_row
  * the split that minimizes entropy in the resulting subsets.
  * 
  * @param data The input dataset as a float array.
+ * @param rows Rows of data forming the node, NULL for the first num_rows rows.
+ * @param weights Weight of every node row, NULL for unit weights (then the sizes are row counts).
  * @param num_rows Number of samples in the dataset.
  * @param num_columns Number of features in the dataset (including the label).
  * @param num_classes Number of unique classes in the dataset.
@@ -173,11 +310,16 @@ void split_data(float **data, float **left_data, float **right_data, int num_row
  * @param best_size_left Pointer to store the number of samples in the left split.
  * @param best_size_right Pointer to store the number of samples in the right split.
  * @param max_features Strategy for selecting features to consider for splitting.
+ * @param splitter SPLITTER_BEST, SPLITTER_RANDOM (one random threshold per feature) or
+ *                 SPLITTER_APPROX (cut points of a quantile sketch on large nodes).
+ * @param num_threads Threads used by the split sweep.
+ * @param rng State of the random stream used to draw the features (see rng_next()).
  * @return A BestSplit structure containing information about the best split found.
  */
-BestSplit find_best_split_1d(float *data, int num_rows, int num_columns, int num_classes, 
-                            int *class_pred_left, int *class_pred_right, 
-                            int *best_size_left, int *best_size_right, char *max_features, int num_threads);
+BestSplit find_best_split_1d(float *data, const int *rows, const int *weights, int num_rows, int num_columns,
+                            int num_classes, int *class_pred_left, int *class_pred_right, 
+                            int *best_size_left, int *best_size_right, char *max_features, int splitter,
+                            int num_threads, unsigned int *rng);
 
 #endif // TRAIN_UTILS_H
 
@@ -10,14 +10,18 @@
 #ifndef TREE_H
 #define TREE_H
 
+#include <limits.h>
+#include <stdint.h>
+
 // Forward declaration of Tree struct
 typedef struct Tree Tree;
 
 /**
- * @brief Node structure representing a decision point in a tree.
+ * @brief Node structure representing a decision point in a tree being grown.
  * 
  * Each node contains either a decision rule (for internal nodes) or
- * a prediction value (for leaf nodes).
+ * a prediction value (for leaf nodes). Nodes are only used while training:
+ * tree_from_nodes() turns a grown tree into the flat layout of Tree.
  */
 typedef struct Node {
     int feature;         /**< Index of the feature used for splitting at this node */
@@ -43,14 +47,85 @@ typedef struct {
 } BestSplit;
 
 /**
- * @brief Tree structure representing a decision tree.
+ * @brief Counter type for the votes received by each class.
+ *
+ * Votes are accumulated in a num_rows x num_classes matrix, so a small integer keeps
+ * the matrix (and its MPI reduction, done with MPI_UNSIGNED_SHORT) compact. A forest
+ * can therefore have at most VOTE_MAX trees.
+ */
+typedef unsigned short vote_t;
+#define VOTE_MAX USHRT_MAX
+
+/** @brief Value of HotNode::feature for a leaf. */
+#define TREE_LEAF (-1)
+/** @brief Largest feature index a trained tree can test (HotNode::feature is 16 bits). */
+#define TREE_MAX_FEATURE INT16_MAX
+
+/**
+ * @brief Node of a trained tree, holding only what a traversal reads (12 bytes).
+ *
+ * The two children of a node are stored next to each other, so one index locates both.
+ */
+typedef struct HotNode {
+    float threshold;     /**< Samples with feature value <= threshold go left */
+    int32_t child;       /**< Index of the left child (the right one follows it), or the class of a leaf */
+    int16_t feature;     /**< Index of the feature tested by the node, TREE_LEAF for a leaf */
+    uint16_t reserved;   /**< Padding, always 0 */
+} HotNode;
+
+/**
+ * @brief Training statistics of a trained node, kept apart from the HotNode for diagnostics.
+ */
+typedef struct NodeStats {
+    float entropy;       /**< Entropy value at this node */
+    int32_t depth;       /**< Depth of this node in the tree */
+    int32_t num_samples; /**< Number of training samples that reached this node */
+} NodeStats;
+
+/**
+ * @brief Tree structure representing a trained decision tree.
  * 
- * The tree consists of a root node which connects to all other nodes.
+ * The nodes are stored in an array starting with the root, and their training
+ * statistics in a parallel array with the same indices. Inference only touches
+ * the nodes array. An empty tree has num_nodes 0 and NULL arrays.
  */
 struct Tree {
-    Node *root;          /**< Pointer to the root node of the tree */
+    HotNode *nodes;      /**< Nodes of the tree, root first */
+    NodeStats *stats;    /**< Training statistics of nodes[i] at stats[i] */
+    int num_nodes;       /**< Number of entries of both arrays */
 };
 
+/**
+ * @brief Returns the class a trained tree predicts for a row.
+ *
+ * @param tree Pointer to a trained, non-empty tree.
+ * @param row Features of the row.
+ */
+static inline int tree_predict_row(const Tree *tree, const float *row) {
+    const HotNode *nodes = tree->nodes;
+    const HotNode *node = nodes;
+    while (node->feature != TREE_LEAF) {
+        if (row[node->feature] <= node->threshold) {
+            node = nodes + node->child;
+        } else {
+            node = nodes + node->child + 1;
+        }
+    }
+    return node->child;
+}
+
+/**
+ * @brief Converts a grown tree to the flat layout and frees its nodes.
+ *
+ * Siblings are stored next to each other, in depth-first order. Returns -1 without
+ * freeing anything if a feature index exceeds TREE_MAX_FEATURE or memory runs out.
+ *
+ * @param tree Tree to fill; its previous arrays are not freed.
+ * @param root Root of the grown tree, NULL for an empty tree.
+ * @return 0 on success, -1 on failure.
+ */
+int tree_from_nodes(Tree *tree, Node *root);
+
 /**
  * @brief Creates a new tree node.
  * 
@@ -97,9 +172,13 @@ void split_data_1d(float *data, float *left_data, float *right_data,
  * @param max_depth Maximum allowed depth for the tree.
  * @param min_samples_split Minimum number of samples required to consider a split.
  * @param max_features Strategy for selecting features to consider for splitting.
+ * @param splitter One of the SPLITTER_* values (see find_best_split_1d()).
+ * @param num_threads Threads used by the split sweep.
+ * @param rng State of the random stream used to draw the features (see rng_next()).
  */
 void grow_tree_1d(Node *parent, float *data, int num_columns, int num_classes, 
-                 int max_depth, int min_samples_split, char* max_features, int num_threads);
+                 int max_depth, int min_samples_split, char* max_features, int splitter, int num_threads,
+                 unsigned int *rng);
 
 /**
  * @brief Trains a decision tree on the provided dataset.
@@ -115,9 +194,39 @@ void grow_tree_1d(Node *parent, float *data, int num_columns, int num_classes,
  * @param max_depth Maximum allowed depth for the tree.
  * @param min_samples_split Minimum number of samples required to consider a split.
  * @param max_features Strategy for selecting features to consider for splitting.
+ * @param splitter One of the SPLITTER_* values (see find_best_split_1d()).
+ * @param num_threads Threads used by the split sweep.
+ * @param rng State of the random stream, usually the one the bootstrap sample was drawn with.
  */
 void train_tree_1d(Tree *tree, float *data, int num_rows, int num_columns, 
-                  int num_classes, int max_depth, int min_samples_split, char* max_features, int num_threads);
+                  int num_classes, int max_depth, int min_samples_split, char* max_features, int splitter,
+                  int num_threads, unsigned int *rng);
+
+/**
+ * @brief Trains a decision tree on a bootstrap sample kept as row counts.
+ *
+ * The rows are read in place from the training matrix: nodes hold row indices and the
+ * weight of every row, i.e. the number of times the bootstrap drew it, so no row is
+ * ever copied. Node sizes and the min_samples_split test use the weighted counts. When
+ * every count is 1 the tree is the one train_tree_1d() grows on the copied rows.
+ *
+ * @param tree Pointer to the tree structure to be trained.
+ * @param data The whole training matrix, with the label in the last column.
+ * @param num_columns Number of features in the dataset (including the label).
+ * @param rows The drawn rows (see draw_bootstrap()).
+ * @param counts Number of draws of every row of data.
+ * @param num_rows Number of entries of rows.
+ * @param num_classes Number of unique classes in the dataset.
+ * @param max_depth Maximum allowed depth for the tree.
+ * @param min_samples_split Minimum weighted number of samples required to consider a split.
+ * @param max_features Strategy for selecting features to consider for splitting.
+ * @param splitter One of the SPLITTER_* values (see find_best_split_1d()).
+ * @param num_threads Threads used by the split sweep.
+ * @param rng State of the random stream, usually the one the bootstrap sample was drawn with.
+ */
+void train_tree_weighted(Tree *tree, const float *data, int num_columns, const int *rows, const int *counts,
+                         int num_rows, int num_classes, int max_depth, int min_samples_split, char *max_features,
+                         int splitter, int num_threads, unsigned int *rng);
 
 /**
  * @brief Uses a trained tree to make predictions on a dataset.
@@ -133,6 +242,60 @@ void train_tree_1d(Tree *tree, float *data, int num_rows, int num_columns,
  */
 int* tree_inference_1d(Tree *tree, float *data, int num_rows, int num_columns);
 
+/**
+ * @brief Adds the votes of a trained tree to a vote matrix.
+ * 
+ * Same traversal as tree_inference_1d(), but instead of returning a predictions array
+ * it increments votes[i * num_classes + pred] for each sample i.
+ * 
+ * @param tree Pointer to the trained tree structure.
+ * @param data The dataset to make predictions on.
+ * @param num_rows Number of samples in the dataset.
+ * @param num_columns Number of features in the dataset.
+ * @param num_classes Number of unique classes in the dataset.
+ * @param votes num_rows x num_classes vote matrix to update.
+ */
+void tree_inference_votes_1d(Tree *tree, float *data, int num_rows, int num_columns, int num_classes, vote_t *votes);
+
+/**
+ * @brief Predicts the forest majority of every row, stopping as soon as the vote is decided.
+ *
+ * The trees of each row are evaluated in the given order, and evaluation stops once no
+ * other class can reach the leading one with the trees left (ties go to the lowest class,
+ * as in aggregate_and_save_predictions()). The predictions are therefore exactly those of
+ * the full vote, only cheaper when the trees agree early.
+ *
+ * @param trees Trained trees.
+ * @param order Evaluation order of the trees, NULL for index order.
+ * @param num_trees Number of trees.
+ * @param data The dataset to make predictions on.
+ * @param num_rows Number of samples in the dataset.
+ * @param num_columns Number of columns of a row in data.
+ * @param num_classes Number of unique classes in the dataset.
+ * @param predictions Array of num_rows classes to fill.
+ * @return The number of tree evaluations over all rows.
+ */
+long long forest_predict_early_exit_1d(Tree *trees, const int *order, int num_trees, float *data, int num_rows,
+                                       int num_columns, int num_classes, int *predictions);
+
+/**
+ * @brief Orders the trees by how often they agree with the forest majority.
+ *
+ * Trees that agree most with the full vote on the given rows come first, so that
+ * forest_predict_early_exit_1d() reaches a decided vote with fewer trees. Labels are not
+ * used, so the rows can be the ones to score. Ties keep the index order.
+ *
+ * @param trees Trained trees.
+ * @param num_trees Number of trees.
+ * @param data Calibration rows.
+ * @param num_rows Number of calibration rows.
+ * @param num_columns Number of columns of a row in data.
+ * @param num_classes Number of unique classes in the dataset.
+ * @param order Array of num_trees tree indices to fill.
+ */
+void order_trees_by_agreement(Tree *trees, int num_trees, float *data, int num_rows, int num_columns,
+                              int num_classes, int *order);
+
 /**
  * @brief Trains a decision tree using MPI for parallel processing.
  * 
@@ -38,20 +38,24 @@
 void get_class_pred(float** data, int num_rows, int num_columns, int num_classes, Node *node);
 
 /**
- * @brief Recursively frees memory allocated for the nodes and the tree.
- * 
- * This function frees all dynamically allocated memory for the tree structure.
- * It is a recursive function that destroys nodes and their children.
+ * @brief Frees the node arrays of a trained tree, logging the destruction to stdout.
  * 
  * @param tree Pointer to the tree that needs to be destroyed.
  */
 void destroy_tree(Tree *tree);
 
+/**
+ * @brief Frees the node arrays of a trained tree without logging, leaving it empty.
+ * 
+ * @param tree Pointer to the tree to free.
+ */
+void free_tree(Tree *tree);
+
 /**
  * @brief Recursively frees memory allocated for a node and its children.
  * 
- * This function frees all dynamically allocated memory for a node and its children 
- * in a recursive manner.
+ * This function frees all dynamically allocated memory for a node of a tree being
+ * grown and its children in a recursive manner.
  * 
  * @param node Pointer to the node that needs to be destroyed.
  */
@@ -70,13 +74,54 @@ void print_tree(Tree *tree);
 /**
  * @brief Recursively prints node information (feature, threshold, prediction, etc.).
  * 
- * This function prints the details of each node in the tree, including the feature index, 
+ * This function prints the details of each node of a tree being grown, including the feature index, 
  * threshold, predicted class, entropy, depth, and the number of samples in that node.
  * 
  * @param node Pointer to the node to be printed.
  */
 void print_node(Node *node);
 
+/**
+ * @brief Size of the trees before and after compact_tree(), summed over the trees compacted.
+ */
+typedef struct CompactionStats {
+    long long nodes_before;  /**< Nodes before compaction. */
+    long long nodes_after;   /**< Nodes after compaction. */
+    int depth_before;        /**< Largest depth before compaction. */
+    int depth_after;         /**< Largest depth after compaction. */
+    long long bytes_before;  /**< Node array bytes before compaction. */
+    long long bytes_after;   /**< Node array bytes after compaction. */
+} CompactionStats;
+
+/**
+ * @brief Collapses the subtrees whose leaves all predict the same class.
+ *
+ * grow_tree_1d() accepts any split that lowers the entropy, even when both children keep
+ * the majority class of their parent. Working bottom-up, every node whose two children are
+ * leaves with the same prediction becomes a leaf with that prediction, so whole subtrees
+ * collapse. The node arrays are then rebuilt without the collapsed subtrees. Predictions
+ * are unchanged; traversals get shorter and the serialized model smaller. The training
+ * statistics are dropped: the compacted tree has stats == NULL, as a loaded model.
+ *
+ * @param tree Trained tree, compacted in place.
+ * @param stats Totals to add this tree to, NULL if not needed.
+ */
+void compact_tree(Tree *tree, CompactionStats *stats);
+
+/**
+ * @brief Returns the bytes held by the node arrays of a trained tree, statistics included.
+ *
+ * @param tree Pointer to the tree.
+ */
+long long tree_memory_bytes(const Tree *tree);
+
+/**
+ * @brief Returns the depth of the deepest leaf of a trained tree (0 for a single leaf).
+ *
+ * @param tree Pointer to the tree.
+ */
+int tree_depth(const Tree *tree);
+
 /**
  * @brief Recursively serializes a node and its children to a binary file.
  * 
@@ -92,8 +137,8 @@ void serialize_node(Node *node, FILE *fp);
 /**
  * @brief Serializes a decision tree to a binary file.
  * 
- * This function serializes the entire tree to a binary file. The tree structure is 
- * recursively serialized using the `serialize_node` function.
+ * This function writes the tree to a binary file in the format of
+ * serialize_tree_to_buffer().
  * 
  * @param tree Pointer to the tree to be serialized.
  * @param filename Path to the output binary file.
@@ -114,14 +159,26 @@ Node *deserialize_node(FILE *fp);
 /**
  * @brief Deserializes a tree structure from a binary file.
  * 
- * This function deserializes a complete tree structure from a binary file and reconstructs 
- * the tree starting from the root node.
+ * This function reads either a file written by serialize_tree() or one holding the
+ * marker format of serialize_node(), as written by the other builds.
  * 
  * @param filename Path to the binary file to load the tree from.
- * @return Pointer to the reconstructed Tree structure.
+ * @return Pointer to the reconstructed Tree structure; exits if the file cannot be loaded.
  */
 Tree *deserialize_tree(const char *filename);
 
+/**
+ * @brief Loads a tree from a binary file, as deserialize_tree() does, without exiting.
+ *
+ * Reads the formats of serialize_tree() and serialize_node(). Truncated files and files
+ * holding an empty tree are rejected.
+ *
+ * @param filename Path to the binary file to load the tree from.
+ * @param tree Tree to fill; left empty on failure.
+ * @return 0 on success, -1 if the file cannot be opened or is malformed.
+ */
+int load_tree_file(const char *filename, Tree *tree);
+
 /**
  * @brief Saves an array of predictions to a file, one per line.
  * 
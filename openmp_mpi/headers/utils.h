@@ -3,6 +3,7 @@
 
 //Maximum number of rows that can be processed
 #define MAX_ROWS 20000000
+#define DATASET_MAGIC 0x53444652  // "RFDS", binary datasets written by data/make_dataset
 
 /**
  * @brief Parses command-line arguments for various options.
@@ -29,6 +30,53 @@ int parse_arguments(int argc, char *argv[], int *max_matrix_rows_print, int *num
                     char **store_predictions_path, char **store_metrics_path, char **new_tree_path, 
                     char **dataset_path, float *train_proportion, float *train_tree_proportion, int *seed, int *thread_count);
 
+// Ways of splitting the training work across MPI processes (--parallelism)
+#define PARALLELISM_TREE 0   // Each process trains whole trees
+#define PARALLELISM_DATA 1   // Rows are partitioned, every tree is built by all processes
+#define PARALLELISM_FEATURE 2 // Columns are partitioned, every tree is built by all processes
+
+// Placement of the large buffers on NUMA machines (--numa)
+#define NUMA_PLACEMENT_OFF 0        // Pages are placed by whichever thread writes them first
+#define NUMA_PLACEMENT_TOUCH 1      // Large buffers are first touched by all the OpenMP threads
+#define NUMA_PLACEMENT_REPLICATE 2  // As touch, plus one copy of the local training rows per NUMA node
+
+/**
+ * @brief Options selecting how the work is laid out across MPI processes.
+ *
+ * Apart from the split search (--splitter, and --num_bins in data-parallel mode) and the
+ * bootstrap draw (--bootstrap replacement), these options only change how data and trees
+ * are distributed, never the model hyperparameters, which are still handled by parse_arguments().
+ */
+typedef struct RunOptions {
+    int shared_memory;   /**< Store the train/test matrices once per node in MPI shared windows (--shared_memory). */
+    int dynamic_schedule; /**< Pull tree ids from a shared counter instead of the static assignment (--schedule dynamic). */
+    int parallelism;      /**< One of the PARALLELISM_* values (--parallelism tree|data|feature). */
+    int num_bins;         /**< Histogram bins per feature in data-parallel mode (--num_bins). */
+    int pipeline;         /**< Score and reduce each tree while the next one trains (--pipeline). */
+    char *checkpoint_path; /**< File where every trained tree is appended, NULL to disable (--checkpoint_path). */
+    int resume;           /**< Skip the trees already in the checkpoint (--resume). */
+    char *profile_path;   /**< JSON file receiving the phase and per-depth profile, NULL to disable (--profile_path). */
+    int early_exit;       /**< Stop scoring a row once its vote is decided, when a process holds every tree (--early_exit). */
+    int confidence_order; /**< Score the trees that agree most with the forest first (--tree_order confidence). */
+    int compact_trees;    /**< Collapse subtrees whose leaves predict the same class before scoring and saving (--compact_trees). */
+    int numa;             /**< One of the NUMA_PLACEMENT_* values (--numa off|touch|replicate). */
+    int splitter;         /**< One of the SPLITTER_* values of tree/train_utils.h (--splitter best|random|approx). */
+    int bootstrap;        /**< One of the BOOTSTRAP_* values of tree/train_utils.h (--bootstrap copy|weights|replacement). */
+    float oob_tolerance;  /**< Stop growing once the out-of-bag accuracy stops improving by more than this, negative to disable (--oob_tolerance). */
+} RunOptions;
+
+/**
+ * @brief Parses the command-line options that select the distributed execution strategy.
+ *
+ * Unknown arguments are ignored so that this function can be called on the same argv
+ * given to parse_arguments(). Returns 0 on success and 1 on error.
+ *
+ * @param argc Number of command-line arguments.
+ * @param argv Command-line arguments.
+ * @param options Structure filled with defaults and then with the parsed options.
+ */
+int parse_run_options(int argc, char *argv[], RunOptions *options);
+
 /**
  * @brief Reads data from a CSV file into a float array.
  * 
@@ -42,6 +90,24 @@ int parse_arguments(int argc, char *argv[], int *max_matrix_rows_print, int *num
  */
 float* read_csv(const char *filename, int *num_rows, int *num_columns);
 
+/**
+ * @brief Reads a binary dataset written by data/make_dataset --format bin.
+ *
+ * The file holds three 32-bit ints (DATASET_MAGIC, rows, columns) followed by the
+ * rows x columns matrix of 32-bit floats in row-major order, which is read with a single fread.
+ *
+ * @param filename Path to the binary file to read.
+ * @param num_rows Pointer to store the number of rows.
+ * @param num_columns Pointer to store the number of columns (features + label).
+ * @return A pointer to the allocated float array containing the data, or NULL on failure.
+ */
+float* read_binary_dataset(const char *filename, int *num_rows, int *num_columns);
+
+/**
+ * @brief Reads a dataset with read_binary_dataset() if the path ends in .bin, with read_csv() otherwise.
+ */
+float* read_dataset(const char *filename, int *num_rows, int *num_columns);
+
 /**
  * @brief Performs a stratified split of the dataset into training and testing sets.
  * 
@@ -88,19 +154,6 @@ void summary(char* dataset_path, float train_proportion, float train_tree_propor
              char* store_predictions_path, char* store_metrics_path, char* new_tree_path,
              char* trained_tree_path, int seed);
 
-/**
- * Samples data without replacement from the training dataset
- *
- * @param train_data The full training dataset
- * @param train_size Number of samples in the training dataset
- * @param num_columns Number of features per sample
- * @param sample_proportion Proportion of data to sample (e.g., 0.75 for 75%)
- * @param sampled_data Output buffer for the sampled data (must be pre-allocated)
- * @return Returns 0 on success, non-zero on failure
- */
-int sample_data_without_replacement(float *train_data, int train_size, int num_columns,
-                                    float sample_proportion, float *sampled_data, int seed);
-
 /**
  * @brief Distributes trees among processes for parallel random forest training.
  * 
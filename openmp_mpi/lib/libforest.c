@@ -0,0 +1,486 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libforest.h"
+#include "../headers/forest.h"
+#include "../headers/tree/tree.h"
+#include "../headers/tree/utils.h"
+#include "../headers/tree/train_utils.h"
+#include "../headers/tree/memory_ser.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define RF_MODEL_MAGIC 0x424C4652  // "RFLB"
+#define RF_MODEL_VERSION 3         // 1 stored the trees in the recursive node format, 2 with their statistics
+#define RF_PREDICT_BLOCK 256       // Rows scored together, so that a block of votes stays in cache
+
+struct RFModel {
+    Forest forest;           /**< Trees and hyperparameters. */
+    int num_features;
+    int num_classes;
+    int num_threads;
+    int early_exit;          /**< rf_predict() stops scoring a row once its vote is decided. */
+};
+
+/**
+ * @brief Header of a model file, followed by the write_forest_model() image.
+ */
+typedef struct RFModelHeader {
+    int magic;
+    int version;
+    int num_features;
+    int num_classes;
+    int num_trees;
+    int max_depth;
+    int min_samples_split;
+    char max_features[32];
+} RFModelHeader;
+
+void rf_default_params(RFParams *params) {
+    params->num_trees = 10;
+    params->max_depth = 10;
+    params->min_samples_split = 2;
+    params->max_features = "sqrt";
+    params->sample_proportion = 0.75f;
+    params->seed = 0;
+    params->num_threads = 1;
+    params->splitter = RF_SPLITTER_BEST;
+    params->bootstrap = RF_BOOTSTRAP_COPY;
+}
+
+// RF_SPLITTER_* to the SPLITTER_* value of the training kernels
+static int rf_splitter(int splitter) {
+    switch (splitter) {
+    case RF_SPLITTER_RANDOM:
+        return SPLITTER_RANDOM;
+    case RF_SPLITTER_APPROX:
+        return SPLITTER_APPROX;
+    default:
+        return SPLITTER_BEST;
+    }
+}
+
+// RF_BOOTSTRAP_* to the BOOTSTRAP_* value of the training kernels
+static int rf_bootstrap(int bootstrap) {
+    switch (bootstrap) {
+    case RF_BOOTSTRAP_WEIGHTS:
+        return BOOTSTRAP_WEIGHTS;
+    case RF_BOOTSTRAP_REPLACEMENT:
+        return BOOTSTRAP_REPLACEMENT;
+    default:
+        return BOOTSTRAP_COPY;
+    }
+}
+
+static RFModel *create_model(int num_trees, int max_depth, int min_samples_split, const char *max_features,
+                             int num_features, int num_classes, int num_threads) {
+    RFModel *model = (RFModel *)calloc(1, sizeof(RFModel));
+    if (!model) {
+        return NULL;
+    }
+    create_forest(&model->forest, num_trees, max_depth, min_samples_split, max_features);
+    if (!model->forest.trees) {
+        free(model);
+        return NULL;
+    }
+    model->num_features = num_features;
+    model->num_classes = num_classes;
+    model->num_threads = num_threads > 0 ? num_threads : 1;
+    return model;
+}
+
+void rf_free(RFModel *model) {
+    if (!model) {
+        return;
+    }
+    // free_tree() rather than destroy_tree(), which logs to stdout
+    for (int t = 0; t < model->forest.num_trees; t++) {
+        free_tree(&model->forest.trees[t]);
+    }
+    free(model->forest.trees);
+    free(model);
+}
+
+int rf_train(const float *features, const int *labels, int num_rows, int num_features, int num_classes,
+             const RFParams *params, RFModel **model) {
+    RFParams defaults;
+    if (params == NULL) {
+        rf_default_params(&defaults);
+        params = &defaults;
+    }
+    if (!features || !labels || !model || num_rows <= 0 || num_features <= 0 ||
+        num_features > TREE_MAX_FEATURE + 1 || num_classes < 2 ||
+        params->num_trees <= 0 || params->num_trees > VOTE_MAX || params->max_depth < 0 ||
+        params->sample_proportion <= 0 || params->sample_proportion > 1 || !params->max_features ||
+        strlen(params->max_features) >= sizeof(((Forest *)0)->max_features) ||
+        (params->splitter != RF_SPLITTER_BEST && params->splitter != RF_SPLITTER_RANDOM &&
+         params->splitter != RF_SPLITTER_APPROX) ||
+        (params->bootstrap != RF_BOOTSTRAP_COPY && params->bootstrap != RF_BOOTSTRAP_WEIGHTS &&
+         params->bootstrap != RF_BOOTSTRAP_REPLACEMENT)) {
+        return RF_ERROR_ARGUMENT;
+    }
+    int num_selected = get_num_selected_features((char *)params->max_features, num_features);
+    if (num_selected < 1 || num_selected > num_features || (int)(params->sample_proportion * num_rows) < 1) {
+        return RF_ERROR_ARGUMENT;
+    }
+    for (int i = 0; i < num_rows; i++) {
+        if (labels[i] < 0 || labels[i] >= num_classes) {
+            return RF_ERROR_ARGUMENT;
+        }
+    }
+
+    // The kernels take the label as the last column of the matrix
+    int num_columns = num_features + 1;
+    float *train_data = (float *)malloc((size_t)num_rows * num_columns * sizeof(float));
+    RFModel *result = create_model(params->num_trees, params->max_depth, params->min_samples_split,
+                                   params->max_features, num_features, num_classes, params->num_threads);
+    if (!train_data || !result) {
+        free(train_data);
+        rf_free(result);
+        return RF_ERROR_MEMORY;
+    }
+    for (int i = 0; i < num_rows; i++) {
+        memcpy(train_data + (size_t)i * num_columns, features + (size_t)i * num_features, num_features * sizeof(float));
+        train_data[(size_t)i * num_columns + num_features] = (float)labels[i];
+    }
+
+    int sample_size = (int)(params->sample_proportion * num_rows);
+    int bootstrap = rf_bootstrap(params->bootstrap);
+    int failed = 0;
+
+    // One tree per thread, each with its own random stream and sample buffer. With weights the
+    // buffer only holds row ids and counts, and every thread reads the rows from train_data.
+    #pragma omp parallel num_threads(result->num_threads) reduction(|:failed)
+    {
+        float *sample = NULL;
+        int *sample_counts = NULL, *sample_rows = NULL;
+        if (bootstrap == BOOTSTRAP_COPY) {
+            sample = (float *)malloc((size_t)sample_size * num_columns * sizeof(float));
+        } else {
+            sample_counts = (int *)malloc((size_t)num_rows * sizeof(int));
+            sample_rows = (int *)malloc((size_t)sample_size * sizeof(int));
+        }
+        int allocated = bootstrap == BOOTSTRAP_COPY ? sample != NULL : sample_counts != NULL && sample_rows != NULL;
+        if (!allocated) {
+            failed = 1;
+        }
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int t = 0; t < params->num_trees; t++) {
+            if (!allocated) {
+                continue;
+            }
+            unsigned int rng = params->seed + (unsigned int)t;
+            int rows;
+            if (bootstrap == BOOTSTRAP_COPY) {
+                rows = sample_data_without_replacement(train_data, num_rows, num_columns, params->sample_proportion,
+                                                       sample, &rng);
+            } else {
+                rows = draw_bootstrap(num_rows, params->sample_proportion, bootstrap == BOOTSTRAP_REPLACEMENT,
+                                      sample_counts, sample_rows, &rng);
+            }
+            if (rows <= 0) {
+                failed = 1;
+                continue;
+            }
+            if (bootstrap == BOOTSTRAP_COPY) {
+                train_tree_1d(&result->forest.trees[t], sample, rows, num_columns, num_classes, params->max_depth,
+                              params->min_samples_split, result->forest.max_features,
+                              rf_splitter(params->splitter), 1, &rng);
+            } else {
+                train_tree_weighted(&result->forest.trees[t], train_data, num_columns, sample_rows, sample_counts,
+                                    rows, num_classes, params->max_depth, params->min_samples_split,
+                                    result->forest.max_features, rf_splitter(params->splitter), 1, &rng);
+            }
+        }
+        free(sample);
+        free(sample_counts);
+        free(sample_rows);
+    }
+    free(train_data);
+
+    if (failed) {
+        rf_free(result);
+        return RF_ERROR_MEMORY;
+    }
+    *model = result;
+    return RF_OK;
+}
+
+// Tallies the votes of every tree for rows [first_row, first_row + num_rows)
+static void block_votes(const RFModel *model, const float *features, int first_row, int num_rows, vote_t *votes) {
+    memset(votes, 0, (size_t)num_rows * model->num_classes * sizeof(vote_t));
+    float *block = (float *)features + (size_t)first_row * model->num_features;
+    for (int t = 0; t < model->forest.num_trees; t++) {
+        tree_inference_votes_1d(&model->forest.trees[t], block, num_rows, model->num_features, model->num_classes, votes);
+    }
+}
+
+// Scores the rows block by block in parallel, writing either classes or vote fractions
+static int predict_blocks(const RFModel *model, const float *features, int num_rows, int *predictions,
+                          float *probabilities) {
+    if (!model || !features || num_rows < 0) {
+        return RF_ERROR_ARGUMENT;
+    }
+    int num_classes = model->num_classes;
+    int num_blocks = (num_rows + RF_PREDICT_BLOCK - 1) / RF_PREDICT_BLOCK;
+    int failed = 0;
+
+    #pragma omp parallel num_threads(model->num_threads) reduction(|:failed)
+    {
+        vote_t *votes = (vote_t *)malloc((size_t)RF_PREDICT_BLOCK * num_classes * sizeof(vote_t));
+        if (!votes) {
+            failed = 1;
+        }
+
+        #pragma omp for schedule(static)
+        for (int b = 0; b < num_blocks; b++) {
+            if (!votes) {
+                continue;
+            }
+            int first_row = b * RF_PREDICT_BLOCK;
+            int rows = (num_rows - first_row < RF_PREDICT_BLOCK) ? num_rows - first_row : RF_PREDICT_BLOCK;
+            if (predictions && model->early_exit) {
+                forest_predict_early_exit_1d(model->forest.trees, NULL, model->forest.num_trees,
+                                             (float *)features + (size_t)first_row * model->num_features, rows,
+                                             model->num_features, num_classes, predictions + first_row);
+                continue;
+            }
+            block_votes(model, features, first_row, rows, votes);
+
+            for (int i = 0; i < rows; i++) {
+                const vote_t *row_votes = votes + (size_t)i * num_classes;
+                if (predictions) {
+                    int best = 0;
+                    for (int c = 1; c < num_classes; c++) {
+                        if (row_votes[c] > row_votes[best]) {
+                            best = c;
+                        }
+                    }
+                    predictions[first_row + i] = best;
+                } else {
+                    for (int c = 0; c < num_classes; c++) {
+                        probabilities[(size_t)(first_row + i) * num_classes + c] = (float)row_votes[c] / model->forest.num_trees;
+                    }
+                }
+            }
+        }
+        free(votes);
+    }
+    return failed ? RF_ERROR_MEMORY : RF_OK;
+}
+
+int rf_predict(const RFModel *model, const float *features, int num_rows, int *predictions) {
+    if (!predictions) {
+        return RF_ERROR_ARGUMENT;
+    }
+    return predict_blocks(model, features, num_rows, predictions, NULL);
+}
+
+int rf_predict_proba(const RFModel *model, const float *features, int num_rows, float *probabilities) {
+    if (!probabilities) {
+        return RF_ERROR_ARGUMENT;
+    }
+    return predict_blocks(model, features, num_rows, NULL, probabilities);
+}
+
+int rf_set_num_threads(RFModel *model, int num_threads) {
+    if (!model || num_threads <= 0) {
+        return RF_ERROR_ARGUMENT;
+    }
+    model->num_threads = num_threads;
+    return RF_OK;
+}
+
+int rf_set_early_exit(RFModel *model, int enabled) {
+    if (!model) {
+        return RF_ERROR_ARGUMENT;
+    }
+    model->early_exit = enabled != 0;
+    return RF_OK;
+}
+
+int rf_order_trees(RFModel *model, const float *features, int num_rows) {
+    if (!model || !features || num_rows <= 0) {
+        return RF_ERROR_ARGUMENT;
+    }
+    int num_trees = model->forest.num_trees;
+    int *order = (int *)malloc(num_trees * sizeof(int));
+    Tree *ordered = (Tree *)malloc(num_trees * sizeof(Tree));
+    if (!order || !ordered) {
+        free(order);
+        free(ordered);
+        return RF_ERROR_MEMORY;
+    }
+    order_trees_by_agreement(model->forest.trees, num_trees, (float *)features, num_rows, model->num_features,
+                             model->num_classes, order);
+
+    // The trees are moved rather than indexed, so the order is kept by rf_save()
+    for (int t = 0; t < num_trees; t++) {
+        ordered[t] = model->forest.trees[order[t]];
+    }
+    memcpy(model->forest.trees, ordered, num_trees * sizeof(Tree));
+    free(order);
+    free(ordered);
+    return RF_OK;
+}
+
+int rf_compact(RFModel *model) {
+    if (!model) {
+        return RF_ERROR_ARGUMENT;
+    }
+    for (int t = 0; t < model->forest.num_trees; t++) {
+        compact_tree(&model->forest.trees[t], NULL);
+    }
+    return RF_OK;
+}
+
+long long rf_num_nodes(const RFModel *model) {
+    long long nodes = 0;
+    for (int t = 0; model && t < model->forest.num_trees; t++) {
+        nodes += model->forest.trees[t].num_nodes;
+    }
+    return nodes;
+}
+
+int rf_save(const RFModel *model, const char *path) {
+    if (!model || !path) {
+        return RF_ERROR_ARGUMENT;
+    }
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        return RF_ERROR_IO;
+    }
+    RFModelHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = RF_MODEL_MAGIC;
+    header.version = RF_MODEL_VERSION;
+    header.num_features = model->num_features;
+    header.num_classes = model->num_classes;
+    header.num_trees = model->forest.num_trees;
+    header.max_depth = model->forest.max_depth;
+    header.min_samples_split = model->forest.min_samples_split;
+    memcpy(header.max_features, model->forest.max_features, sizeof(header.max_features));
+
+    int failed = fwrite(&header, sizeof(header), 1, fp) != 1 || write_forest_model(&model->forest, fp) != 0;
+    failed |= fclose(fp) != 0;
+    return failed ? RF_ERROR_IO : RF_OK;
+}
+
+// An empty tree cannot be walked, and a split on a missing feature would read past the row
+static int trees_fit_model(const RFModel *model) {
+    for (int t = 0; t < model->forest.num_trees; t++) {
+        const Tree *tree = &model->forest.trees[t];
+        if (tree->num_nodes == 0) {
+            return 0;
+        }
+        for (int i = 0; i < tree->num_nodes; i++) {
+            if (tree->nodes[i].feature >= model->num_features) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+int rf_load(const char *path, RFModel **model) {
+    if (!path || !model) {
+        return RF_ERROR_ARGUMENT;
+    }
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return RF_ERROR_IO;
+    }
+    RFModelHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != RF_MODEL_MAGIC ||
+        header.version < 1 || header.version > RF_MODEL_VERSION || header.num_features <= 0 || header.num_classes < 2 ||
+        header.num_trees <= 0 || header.num_trees > VOTE_MAX) {
+        fclose(fp);
+        return RF_ERROR_FORMAT;
+    }
+    header.max_features[sizeof(header.max_features) - 1] = '\0';
+
+    RFModel *result = create_model(header.num_trees, header.max_depth, header.min_samples_split,
+                                   header.max_features, header.num_features, header.num_classes, 1);
+    if (!result) {
+        fclose(fp);
+        return RF_ERROR_MEMORY;
+    }
+    if (read_forest_model(&result->forest, fp) != 0) {
+        // read_forest_model() already freed the trees it had read
+        free(result->forest.trees);
+        free(result);
+        fclose(fp);
+        return RF_ERROR_FORMAT;
+    }
+    fclose(fp);
+    if (!trees_fit_model(result)) {
+        rf_free(result);
+        return RF_ERROR_FORMAT;
+    }
+    *model = result;
+    return RF_OK;
+}
+
+int rf_load_forest_dir(const char *dir_path, int num_features, int num_classes, RFModel **model) {
+    if (!dir_path || !model || num_features <= 0 || num_classes < 2) {
+        return RF_ERROR_ARGUMENT;
+    }
+    Forest forest;
+    if (deserialize_forest(&forest, dir_path) != 0) {
+        return RF_ERROR_FORMAT;
+    }
+    if (forest.num_trees <= 0 || forest.num_trees > VOTE_MAX) {
+        for (int t = 0; t < forest.num_trees; t++) {
+            free_tree(&forest.trees[t]);
+        }
+        free(forest.trees);
+        return RF_ERROR_FORMAT;
+    }
+
+    RFModel *result = (RFModel *)calloc(1, sizeof(RFModel));
+    if (!result) {
+        for (int t = 0; t < forest.num_trees; t++) {
+            free_tree(&forest.trees[t]);
+        }
+        free(forest.trees);
+        return RF_ERROR_MEMORY;
+    }
+    result->forest = forest;
+    result->num_features = num_features;
+    result->num_classes = num_classes;
+    result->num_threads = 1;
+
+    if (!trees_fit_model(result)) {
+        rf_free(result);
+        return RF_ERROR_FORMAT;
+    }
+    *model = result;
+    return RF_OK;
+}
+
+int rf_num_trees(const RFModel *model) {
+    return model ? model->forest.num_trees : 0;
+}
+
+int rf_num_features(const RFModel *model) {
+    return model ? model->num_features : 0;
+}
+
+int rf_num_classes(const RFModel *model) {
+    return model ? model->num_classes : 0;
+}
+
+const char *rf_error_string(int status) {
+    switch (status) {
+        case RF_OK: return "success";
+        case RF_ERROR_ARGUMENT: return "invalid argument";
+        case RF_ERROR_MEMORY: return "out of memory";
+        case RF_ERROR_IO: return "file could not be opened, read or written";
+        case RF_ERROR_FORMAT: return "not a valid model file";
+        default: return "unknown error";
+    }
+}
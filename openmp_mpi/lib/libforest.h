@@ -0,0 +1,184 @@
+/**
+ * @file libforest.h
+ * @brief C API of libforest.so: train, save, load and score random forests in-process.
+ *
+ * The library is built from the MPI-free training and inference kernels (make lib) and
+ * keeps no global state: every random draw goes through a stream owned by the tree being
+ * trained, and all the model state lives in the RFModel handle. A trained model is only
+ * read by the prediction functions, so several threads can score with the same model
+ * concurrently.
+ *
+ * Tree t is trained on a bootstrap drawn with seed + t, exactly as in the openmp_mpi
+ * executable, so the same training rows and parameters give the same forest.
+ *
+ * Matrices are row-major float arrays of num_rows x num_features, without the label.
+ * Functions return RF_OK or a negative RF_ERROR_* code.
+ */
+#ifndef LIBFOREST_H
+#define LIBFOREST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RF_OK 0
+#define RF_ERROR_ARGUMENT -1  // Invalid argument or parameter
+#define RF_ERROR_MEMORY -2    // Allocation failure
+#define RF_ERROR_IO -3        // File could not be opened, read or written
+#define RF_ERROR_FORMAT -4    // File is not a libforest model
+
+#define RF_SPLITTER_BEST 0    // Exact search over every threshold of the drawn features
+#define RF_SPLITTER_RANDOM 1  // One random threshold per drawn feature (extremely randomized trees)
+#define RF_SPLITTER_APPROX 2  // Quantile sketch cut points on large nodes
+
+#define RF_BOOTSTRAP_COPY 0         // Rows drawn without replacement, copied into a buffer per thread
+#define RF_BOOTSTRAP_WEIGHTS 1      // Same rows and trees, read in place through per-row counts
+#define RF_BOOTSTRAP_REPLACEMENT 2  // Rows drawn with replacement, read in place through per-row counts
+
+/**
+ * @brief Opaque handle of a trained or loaded forest.
+ */
+typedef struct RFModel RFModel;
+
+/**
+ * @brief Training parameters, see rf_default_params() for the defaults.
+ */
+typedef struct RFParams {
+    int num_trees;             /**< Number of trees (default 10). */
+    int max_depth;             /**< Maximum depth of every tree (default 10). */
+    int min_samples_split;     /**< Minimum samples to split a node (default 2). */
+    const char *max_features;  /**< Features drawn at every node: "sqrt" (default), "log2" or an integer. */
+    float sample_proportion;   /**< Fraction of the rows drawn for every tree (default 0.75). */
+    unsigned int seed;         /**< Seed of the bootstraps and feature draws (default 0). */
+    int num_threads;           /**< Threads used for training and prediction (default 1). */
+    int splitter;              /**< RF_SPLITTER_BEST (default), RF_SPLITTER_RANDOM or RF_SPLITTER_APPROX. */
+    int bootstrap;             /**< RF_BOOTSTRAP_COPY (default), RF_BOOTSTRAP_WEIGHTS or RF_BOOTSTRAP_REPLACEMENT. */
+} RFParams;
+
+/**
+ * @brief Fills params with the defaults of the command-line executables.
+ */
+void rf_default_params(RFParams *params);
+
+/**
+ * @brief Trains a forest on in-memory arrays.
+ *
+ * Trees are trained in parallel, one per thread.
+ *
+ * @param features num_rows x num_features matrix.
+ * @param labels Class of every row, in [0, num_classes).
+ * @param num_rows Number of rows.
+ * @param num_features Number of features.
+ * @param num_classes Number of classes.
+ * @param params Training parameters, NULL for the defaults.
+ * @param model Pointer to store the trained model, to release with rf_free().
+ */
+int rf_train(const float *features, const int *labels, int num_rows, int num_features, int num_classes,
+             const RFParams *params, RFModel **model);
+
+/**
+ * @brief Predicts the class of every row (majority vote, ties to the lowest class).
+ *
+ * @param model Trained or loaded model.
+ * @param features num_rows x num_features matrix.
+ * @param num_rows Number of rows.
+ * @param predictions Caller-provided buffer of num_rows classes.
+ */
+int rf_predict(const RFModel *model, const float *features, int num_rows, int *predictions);
+
+/**
+ * @brief Computes the fraction of trees voting for every class.
+ *
+ * @param model Trained or loaded model.
+ * @param features num_rows x num_features matrix.
+ * @param num_rows Number of rows.
+ * @param probabilities Caller-provided buffer of num_rows x num_classes values.
+ */
+int rf_predict_proba(const RFModel *model, const float *features, int num_rows, float *probabilities);
+
+/**
+ * @brief Sets the number of threads used by the next predictions.
+ */
+int rf_set_num_threads(RFModel *model, int num_threads);
+
+/**
+ * @brief Enables early-exit voting in rf_predict().
+ *
+ * The trees of a row are evaluated one by one and scoring stops once no other class can
+ * catch up with the leading one, so predictions are identical to the full vote. Easy rows
+ * then need fewer trees. rf_predict_proba() always evaluates every tree.
+ */
+int rf_set_early_exit(RFModel *model, int enabled);
+
+/**
+ * @brief Reorders the trees so that the ones agreeing most with the forest come first.
+ *
+ * Agreement is measured on the given rows, without labels, so a sample of the rows to
+ * score works. With early exit, the vote of a row is then decided after fewer trees. The
+ * order is kept by rf_save() and does not change any prediction.
+ *
+ * @param model Trained or loaded model.
+ * @param features num_rows x num_features calibration matrix.
+ * @param num_rows Number of rows.
+ */
+int rf_order_trees(RFModel *model, const float *features, int num_rows);
+
+/**
+ * @brief Collapses the subtrees whose leaves all predict the same class.
+ *
+ * Lossless: predictions are unchanged, but the trees are shallower and smaller to save.
+ */
+int rf_compact(RFModel *model);
+
+/** @brief Total number of nodes of the model's trees. */
+long long rf_num_nodes(const RFModel *model);
+
+/**
+ * @brief Saves the model to a single file.
+ */
+int rf_save(const RFModel *model, const char *path);
+
+/**
+ * @brief Loads a model written by rf_save().
+ *
+ * @param path Path of the model file.
+ * @param model Pointer to store the loaded model, to release with rf_free().
+ */
+int rf_load(const char *path, RFModel **model);
+
+/**
+ * @brief Loads a forest directory written by the command-line executables (--new_forest_path).
+ *
+ * Those directories do not record the shape of the data, so it has to be given.
+ *
+ * @param dir_path Forest directory (forest_config.txt plus forest.bin or random_tree_<i>.bin).
+ * @param num_features Number of features the forest was trained on.
+ * @param num_classes Number of classes the forest was trained on.
+ * @param model Pointer to store the loaded model, to release with rf_free().
+ */
+int rf_load_forest_dir(const char *dir_path, int num_features, int num_classes, RFModel **model);
+
+/** @brief Number of trees of the model. */
+int rf_num_trees(const RFModel *model);
+
+/** @brief Number of features the model expects. */
+int rf_num_features(const RFModel *model);
+
+/** @brief Number of classes the model predicts. */
+int rf_num_classes(const RFModel *model);
+
+/**
+ * @brief Releases a model. NULL is ignored.
+ */
+void rf_free(RFModel *model);
+
+/**
+ * @brief Returns a static description of an RF_* status code.
+ */
+const char *rf_error_string(int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBFOREST_H
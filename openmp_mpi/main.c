@@ -16,13 +16,26 @@
 #include "headers/metrics.h"
 #include "headers/forest.h"
 #include "headers/memory_ser.h"
+#include "headers/shared_data.h"
+#include "headers/scheduler.h"
+#include "headers/pipeline.h"
+#include "headers/checkpoint.h"
+#include "headers/oob.h"
+#include "headers/data_parallel.h"
+#include "headers/feature_parallel.h"
+#include "headers/profile_report.h"
 #include "headers/tree/tree.h"
 #include "headers/tree/utils.h"
 #include "headers/tree/train_utils.h"
+#include "headers/tree/profile.h"
+#include "headers/tree/counters.h"
+#include "headers/tree/numa.h"
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+#define EARLY_EXIT_CALIBRATION_ROWS 1024  // Test rows used to order the trees by agreement
+
 int main(int argc, char *argv[]) {
     int max_matrix_rows_print = 0; // Default: print nothing
     int num_classes = -1;
@@ -63,6 +76,18 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (num_trees > VOTE_MAX) {
+        printf("At most %d trees are supported, instead %d were requested.\n", VOTE_MAX, num_trees);
+        return 1;
+    }
+
+    RunOptions options;
+    if (parse_run_options(argc, argv, &options) != 0) {
+        printf("Error parsing run options. Please check the command line options.\n");
+        return 1;
+    }
+    profile_init(options.profile_path != NULL);
+
     int rank, process_number, provided;
     MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
     MPI_Comm_size(MPI_COMM_WORLD, &process_number);
@@ -72,6 +97,69 @@ int main(int argc, char *argv[]) {
     int num_trees_assigned = 0;
     float *my_train_data = NULL;
     int my_sample_size = 0;
+    SharedDataset shared;
+    int local_train_size = 0, local_test_size = 0, first_test_row = 0;
+    float *local_test_data = NULL;
+    float *feature_block = NULL;
+    int first_feature = 0, num_local_features = 0;
+
+    if (trained_forest_path != NULL && options.parallelism != PARALLELISM_TREE) {
+        // A saved forest is always scored by scattering whole trees
+        options.parallelism = PARALLELISM_TREE;
+    }
+    if (options.parallelism == PARALLELISM_DATA && options.shared_memory) {
+        if (rank == 0) {
+            printf("Process 0: --shared_memory is ignored, rows are partitioned across processes\n");
+            fflush(stdout);
+        }
+        options.shared_memory = 0;
+    }
+    if (options.pipeline && (trained_forest_path != NULL || options.parallelism != PARALLELISM_TREE)) {
+        if (rank == 0) {
+            printf("Process 0: --pipeline only applies to tree-parallel training and is ignored\n");
+            fflush(stdout);
+        }
+        options.pipeline = 0;
+    }
+    if (options.checkpoint_path != NULL && (trained_forest_path != NULL || options.parallelism != PARALLELISM_TREE)) {
+        if (rank == 0) {
+            printf("Process 0: --checkpoint_path only applies to tree-parallel training and is ignored\n");
+            fflush(stdout);
+        }
+        options.checkpoint_path = NULL;
+    }
+    if (options.bootstrap != BOOTSTRAP_COPY && options.parallelism != PARALLELISM_TREE) {
+        // Data and feature parallel training already sample rows without copying them
+        if (rank == 0) {
+            printf("Process 0: --bootstrap only applies to tree-parallel training and is ignored\n");
+            fflush(stdout);
+        }
+        options.bootstrap = BOOTSTRAP_COPY;
+    }
+    if (options.oob_tolerance >= 0 && (trained_forest_path != NULL || options.parallelism != PARALLELISM_TREE ||
+                                       options.pipeline)) {
+        if (rank == 0) {
+            printf("Process 0: --oob_tolerance only applies to tree-parallel training without --pipeline and is ignored\n");
+            fflush(stdout);
+        }
+        options.oob_tolerance = -1.0f;
+    }
+    if (options.numa == NUMA_PLACEMENT_REPLICATE && options.parallelism != PARALLELISM_DATA) {
+        // Tree and feature parallel training read the rows from a single thread
+        if (rank == 0) {
+            printf("Process 0: --numa replicate only applies to data-parallel training, using touch\n");
+            fflush(stdout);
+        }
+        options.numa = NUMA_PLACEMENT_TOUCH;
+    }
+    if (options.numa != NUMA_PLACEMENT_OFF) {
+        numa_set_first_touch(n_threads);
+        char binding[64];
+        numa_describe_binding(binding, sizeof(binding));
+        printf("Process %d: %d NUMA nodes, main thread on node %d, OpenMP threads %s\n",
+               rank, numa_num_nodes(), numa_current_node(), binding);
+        fflush(stdout);
+    }
 
     // Process 0 reads the dataset and determines basic parameters
     if (rank == 0) {
@@ -88,7 +176,8 @@ int main(int argc, char *argv[]) {
         printf("Process 0: Reading dataset from %s\n", dataset_path);
         fflush(stdout);
         
-        data = read_csv(dataset_path, &num_rows, &num_columns);
+        double parse_start = profile_start();
+        data = read_dataset(dataset_path, &num_rows, &num_columns);
         if (data == NULL) {
             fprintf(stderr, "Process 0: Failed to read CSV data\n");
             MPI_Abort(MPI_COMM_WORLD, 1);
@@ -109,6 +198,13 @@ int main(int argc, char *argv[]) {
             }
             num_classes++;
         }
+        profile_phase_end(PHASE_PARSE, parse_start);
+
+        if (num_columns - 1 > TREE_MAX_FEATURE + 1) {
+            fprintf(stderr, "Process 0: At most %d features are supported, the dataset has %d\n",
+                    TREE_MAX_FEATURE + 1, num_columns - 1);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
 
         printf("Process 0: Number of classes determined: %d\n", num_classes);
         fflush(stdout);
@@ -120,39 +216,66 @@ int main(int argc, char *argv[]) {
 	
 
     // Broadcast dataset dimensions and parameters to all processes
+    double broadcast_start = profile_start();
     MPI_Bcast(&num_rows, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&num_columns, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&num_classes, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&mode, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
-    // All non-root processes allocate memory for the dataset
-    if (rank != 0) {
-        data = (float *)malloc(num_rows * num_columns * sizeof(float));
-        if (data == NULL) {
-            fprintf(stderr, "Process %d: Failed to allocate memory for dataset\n", rank);
-            MPI_Abort(MPI_COMM_WORLD, 1);
+    if (options.shared_memory) {
+        // One copy of the train/test matrices per node, read by all local ranks
+        shared_dataset_split(&shared, data, num_rows, num_columns, num_classes, train_proportion, seed,
+                             &train_data, &train_size, &test_data, &test_size);
+        data = NULL;
+        profile_phase_end(PHASE_BROADCAST, broadcast_start);
+    } else if (options.parallelism == PARALLELISM_DATA) {
+        // Only process 0 splits the dataset, the rows are scattered below
+        int sizes[2] = {0, 0};
+        profile_phase_end(PHASE_BROADCAST, broadcast_start);
+        if (rank == 0) {
+            double split_start = profile_start();
+            stratified_split(data, num_rows, num_columns, num_classes, train_proportion,
+                             &train_data, &sizes[0], &test_data, &sizes[1], seed);
+            free(data);
+            data = NULL;
+            profile_phase_end(PHASE_SPLIT, split_start);
         }
+        MPI_Bcast(sizes, 2, MPI_INT, 0, MPI_COMM_WORLD);
+        train_size = sizes[0];
+        test_size = sizes[1];
+    } else {
+        // All non-root processes allocate memory for the dataset
+        if (rank != 0) {
+            data = (float *)numa_alloc((size_t)num_rows * num_columns * sizeof(float));
+            if (data == NULL) {
+                fprintf(stderr, "Process %d: Failed to allocate memory for dataset\n", rank);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
         
-        printf("Process %d: Allocated memory for dataset - %d rows, %d columns\n", 
-               rank, num_rows, num_columns);
-        fflush(stdout);
-    }
+            printf("Process %d: Allocated memory for dataset - %d rows, %d columns\n", 
+                   rank, num_rows, num_columns);
+            fflush(stdout);
+        }
 
-    // Broadcast the entire dataset to all processes
-    printf("Process %d: Broadcasting dataset...\n", rank);
-    fflush(stdout);
+        // Broadcast the entire dataset to all processes
+        printf("Process %d: Broadcasting dataset...\n", rank);
+        fflush(stdout);
     
-    MPI_Bcast(data, num_rows * num_columns, MPI_FLOAT, 0, MPI_COMM_WORLD);
+        MPI_Bcast(data, num_rows * num_columns, MPI_FLOAT, 0, MPI_COMM_WORLD);
+        profile_phase_end(PHASE_BROADCAST, broadcast_start);
     
-    printf("Process %d: Dataset broadcast complete\n", rank);
-    fflush(stdout);
+        printf("Process %d: Dataset broadcast complete\n", rank);
+        fflush(stdout);
     
-    stratified_split(data, num_rows, num_columns, num_classes, train_proportion,
-                    &train_data, &train_size, &test_data, &test_size, seed);
+        double split_start = profile_start();
+        stratified_split(data, num_rows, num_columns, num_classes, train_proportion,
+                        &train_data, &train_size, &test_data, &test_size, seed);
+        profile_phase_end(PHASE_SPLIT, split_start);
                     
-    // Free the original dataset as it's no longer needed
-    free(data);
-    data = NULL;
+        // Free the original dataset as it's no longer needed
+        free(data);
+        data = NULL;
+    }
 
 	// Only process 0 extracts targets from test data
     if (rank == 0) {
@@ -172,6 +295,46 @@ int main(int argc, char *argv[]) {
         targets = NULL;  // Other processes don't need targets
     }
 
+    local_train_size = train_size;
+    local_test_size = test_size;
+    if (options.parallelism == PARALLELISM_DATA) {
+        // Every process keeps one block of the training rows and one block of the test rows
+        float *full_train = train_data, *full_test = test_data;
+        int first_train_row;
+        double scatter_start = profile_start();
+        scatter_rows(full_train, train_size, num_columns, &train_data, &local_train_size, &first_train_row);
+        scatter_rows(full_test, test_size, num_columns, &test_data, &local_test_size, &first_test_row);
+        profile_phase_end(PHASE_BROADCAST, scatter_start);
+        free(full_train);
+        free(full_test);
+
+        printf("Process %d: Holding training rows [%d, %d) and test rows [%d, %d)\n", rank,
+               first_train_row, first_train_row + local_train_size, first_test_row, first_test_row + local_test_size);
+        fflush(stdout);
+    } else if (options.parallelism == PARALLELISM_FEATURE && mode == 0) {
+        // Every process keeps its block of feature columns and scores one block of the test rows
+        double extract_start = profile_start();
+        feature_block = extract_feature_block(train_data, train_size, num_columns, &first_feature, &num_local_features);
+        profile_phase_end(PHASE_SPLIT, extract_start);
+
+        int *row_counts = (int *)malloc(process_number * sizeof(int));
+        int *row_displs = (int *)malloc(process_number * sizeof(int));
+        if (!row_counts || !row_displs) {
+            fprintf(stderr, "Process %d: Failed to allocate memory for row distribution\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        distribute_trees(test_size, process_number, row_counts, row_displs);
+        local_test_size = row_counts[rank];
+        first_test_row = row_displs[rank];
+        free(row_counts);
+        free(row_displs);
+
+        printf("Process %d: Holding features [%d, %d) and scoring test rows [%d, %d)\n", rank,
+               first_feature, first_feature + num_local_features, first_test_row, first_test_row + local_test_size);
+        fflush(stdout);
+    }
+    local_test_data = test_data + (options.parallelism == PARALLELISM_FEATURE ? (size_t)first_test_row * num_columns : 0);
+
     // Calculate sample size for training
     sample_size = (int)(train_tree_proportion * train_size);
 
@@ -179,6 +342,43 @@ int main(int argc, char *argv[]) {
            rank, sample_size, train_tree_proportion * 100, train_size);
     fflush(stdout);
 
+    // Trees still to train: all of them, or the ones missing from the checkpoint on resume
+    int *remaining_trees = (int *)malloc(num_trees * sizeof(int));
+    int *finished_trees = (int *)calloc(num_trees, sizeof(int));
+    if (remaining_trees == NULL || finished_trees == NULL) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for tree ids\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    Checkpoint checkpoint;
+    Tree *checkpointed_trees = NULL;
+    int num_checkpointed = 0, num_remaining = 0;
+    if (mode == 0 && options.checkpoint_path != NULL) {
+        CheckpointHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = CHECKPOINT_MAGIC;
+        header.seed = seed;
+        header.num_rows = num_rows;
+        header.num_columns = num_columns;
+        header.num_classes = num_classes;
+        header.max_depth = max_depth;
+        header.min_samples_split = min_samples_split;
+        header.train_proportion = train_proportion;
+        header.train_tree_proportion = train_tree_proportion;
+        strncpy(header.max_features, max_features, sizeof(header.max_features) - 1);
+        header.splitter = options.splitter;
+        // Copies and unit weights grow the same trees, only a draw with replacement changes them
+        header.bootstrap = options.bootstrap == BOOTSTRAP_REPLACEMENT ? BOOTSTRAP_REPLACEMENT : BOOTSTRAP_COPY;
+
+        checkpoint_open(&checkpoint, options.checkpoint_path, options.resume, &header, num_trees,
+                        finished_trees, &checkpointed_trees, &num_checkpointed);
+    }
+    for (int t = 0; t < num_trees; t++) {
+        if (!finished_trees[t]) {
+            remaining_trees[num_remaining++] = t;
+        }
+    }
+    free(finished_trees);
+
     // Calculate tree distribution among ALL processes
     int *tree_counts = (int *)malloc(process_number * sizeof(int));
     int *tree_displs = (int *)malloc(process_number * sizeof(int));
@@ -189,227 +389,497 @@ int main(int argc, char *argv[]) {
     }
     
     // Distribute trees among ALL processes
-    distribute_trees(num_trees, process_number, tree_counts, tree_displs);
+    distribute_trees(num_remaining, process_number, tree_counts, tree_displs);
     num_trees_assigned = tree_counts[rank];
 
-    printf("Process %d: Assigned %d trees to train\n", rank, num_trees_assigned);
-    fflush(stdout);
-
-    // Each process samples its own training data if it has trees assigned
-    if (num_trees_assigned > 0) {
-        my_train_data = (float *)malloc(sample_size * num_columns * sizeof(float));
-        if (!my_train_data) {
-            fprintf(stderr, "Process %d: Malloc failed for my_train_data\n", rank);
-            MPI_Abort(MPI_COMM_WORLD, 1);
-        }
+    if (!options.dynamic_schedule) {
+        printf("Process %d: Assigned %d trees to train\n", rank, num_trees_assigned);
+        fflush(stdout);
+    }
 
-        // Each process uses a different seed for sampling to ensure different samples
-        my_sample_size = sample_data_without_replacement(
-            train_data, train_size, num_columns, train_tree_proportion, my_train_data, seed + rank);
-        
-        if (my_sample_size <= 0) {
-            fprintf(stderr, "Process %d: Error in sampling data (got size: %d)\n", rank, my_sample_size);
+    // Sum of the votes of all processes, only allocated on process 0
+    vote_t *global_votes = NULL;
+    if (rank == 0) {
+        global_votes = (vote_t *)calloc((size_t)test_size * num_classes, sizeof(vote_t));
+        if (!global_votes) {
+            fprintf(stderr, "Process 0: Calloc failed for global_votes\n");
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
-        
-        printf("Process %d: Sampled %d rows for training\n", rank, my_sample_size);
-        fflush(stdout);
     }
 
-    // Free train_data as each process now has its own sample
-    if (train_data) {
-        free(train_data);
-        train_data = NULL;
+    // Every process, even without trees, contributes a vote matrix to the reduction
+    vote_t *local_votes = (vote_t *)calloc((size_t)test_size * num_classes, sizeof(vote_t));
+    if (!local_votes) {
+        fprintf(stderr, "Process %d: Calloc failed for local_votes\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
+
 	// Synchronize all processes before starting computation
     MPI_Barrier(MPI_COMM_WORLD);
     
     // ALL PROCESSES PERFORM COMPUTATION
-    if (mode == 0 && num_trees_assigned > 0) {
-        printf("Process %d: Starting training of %d trees\n", rank, num_trees_assigned);
-        fflush(stdout);
-        
-        // Allocate array to store trained trees
-        Tree *trees = (Tree *)malloc(num_trees_assigned * sizeof(Tree));
+    Tree *trees = NULL;
+    int num_local_trees = 0;
+    int *local_tree_ids = (int *)malloc(num_trees * sizeof(int));  // Global id of every local tree
+    if (!local_tree_ids) {
+        fprintf(stderr, "Process %d: Malloc failed for local_tree_ids\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (mode == 0 && options.parallelism == PARALLELISM_DATA) {
+        // Every process takes part in every tree and ends up with the whole forest
+        trees = (Tree *)malloc(num_trees * sizeof(Tree));
         if (!trees) {
             fprintf(stderr, "Process %d: Malloc failed for trees array\n", rank);
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
+
+        // The histogram threads read every local row at every node, so each NUMA node
+        // gets its own copy of the rows
+        NumaReplicas replicas;
+        int num_replicas = 0;
+        if (options.numa == NUMA_PLACEMENT_REPLICATE) {
+            num_replicas = numa_replicas_create(&replicas, train_data, (size_t)local_train_size * num_columns, n_threads);
+            if (num_replicas < 0) {
+                fprintf(stderr, "Process %d: Failed to allocate memory for NUMA replicas\n", rank);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            printf("Process %d: %d NUMA replicas of the %d local training rows\n", rank, num_replicas, local_train_size);
+            fflush(stdout);
+        }
+
+        train_start = MPI_Wtime();
+
+        for (int t = 0; t < num_trees; t++) {
+            double tree_start = MPI_Wtime();
+
+            train_tree_data_parallel(&trees[t], train_data, local_train_size, num_columns, num_classes,
+                                     max_depth, min_samples_split, max_features, options.splitter,
+                                     train_tree_proportion, options.num_bins, seed + t, n_threads, num_replicas > 0 ? &replicas : NULL);
+            num_local_trees++;
+
+            if (rank == 0) {
+                printf("Process 0: Finished data-parallel tree %d/%d in %.4f seconds\n",
+                       t + 1, num_trees, MPI_Wtime() - tree_start);
+                fflush(stdout);
+            }
+        }
+
+        train_end = MPI_Wtime();
+        train_time = train_end - train_start;
+        if (options.numa == NUMA_PLACEMENT_REPLICATE) {
+            numa_replicas_free(&replicas);
+        }
+    } else if (mode == 0 && options.parallelism == PARALLELISM_FEATURE) {
+        // Every process takes part in every tree and ends up with the whole forest
+        trees = (Tree *)malloc(num_trees * sizeof(Tree));
+        if (!trees) {
+            fprintf(stderr, "Process %d: Malloc failed for trees array\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        train_start = MPI_Wtime();
+
+        for (int t = 0; t < num_trees; t++) {
+            double tree_start = MPI_Wtime();
+
+            train_tree_feature_parallel(&trees[t], feature_block, train_size, first_feature, num_local_features,
+                                        num_columns, num_classes, max_depth, min_samples_split, max_features,
+                                        options.splitter, train_tree_proportion, seed + t, n_threads);
+            num_local_trees++;
+
+            if (rank == 0) {
+                printf("Process 0: Finished feature-parallel tree %d/%d in %.4f seconds\n",
+                       t + 1, num_trees, MPI_Wtime() - tree_start);
+                fflush(stdout);
+            }
+        }
+
+        train_end = MPI_Wtime();
+        train_time = train_end - train_start;
+
+        free(feature_block);
+        feature_block = NULL;
+    } else if (mode == 0 && options.pipeline) {
+        // Each tree is scored as soon as it is trained and its votes are reduced on
+        // process 0 while the next tree trains
+        TreeScheduler scheduler;
+        tree_scheduler_create(&scheduler, options.dynamic_schedule, tree_displs[rank], num_trees_assigned, MPI_COMM_WORLD);
+
+        trees = (Tree *)malloc(num_trees * sizeof(Tree));
+        if (!trees) {
+            fprintf(stderr, "Process %d: Malloc failed for trees array\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        num_local_trees = train_and_score_pipelined(&scheduler, remaining_trees, num_remaining,
+                                                    trees, local_tree_ids, num_trees,
+                                                    options.checkpoint_path != NULL ? &checkpoint : NULL,
+                                                    train_data, train_size,
+                                                    test_data, test_size, num_columns, num_classes,
+                                                    max_depth, min_samples_split, max_features,
+                                                    options.splitter, options.bootstrap, train_tree_proportion,
+                                                    seed, n_threads,
+                                                    global_votes, &train_time, &inference_time);
+
+        printf("Process %d: Finished pipelined training and scoring (%d trees)\n", rank, num_local_trees);
+        fflush(stdout);
+
+        tree_scheduler_free(&scheduler);
+    } else if (mode == 0) {
+        // Trees are indexed by a global id, either from the static assignment or pulled
+        // from a shared counter. The bootstrap of tree t is always drawn with seed + t,
+        // so the forest does not depend on which process trained which tree.
+        TreeScheduler scheduler;
+        tree_scheduler_create(&scheduler, options.dynamic_schedule, tree_displs[rank], num_trees_assigned, MPI_COMM_WORLD);
+
+        // Allocate array to store trained trees (any process may get all of them when scheduling dynamically)
+        trees = (Tree *)malloc(num_trees * sizeof(Tree));
+        // With weights the bootstrap is a list of rows and their counts over train_data, no row is copied
+        int *sample_counts = NULL, *sample_rows = NULL;
+        if (options.bootstrap == BOOTSTRAP_COPY) {
+            my_train_data = (float *)numa_alloc((size_t)sample_size * num_columns * sizeof(float));
+        } else {
+            sample_counts = (int *)malloc((size_t)train_size * sizeof(int));
+            sample_rows = (int *)malloc((size_t)sample_size * sizeof(int));
+        }
+        if (!trees || (options.bootstrap == BOOTSTRAP_COPY ? !my_train_data : !sample_counts || !sample_rows)) {
+            fprintf(stderr, "Process %d: Malloc failed for trees array or the bootstrap sample\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
         
         // Start training timing
         train_start = MPI_Wtime();
+
+        // With --oob_tolerance the training goes in rounds of one tree per process, after
+        // which every process knows the out-of-bag accuracy and they stop together
+        int track_oob = options.oob_tolerance >= 0, oob_stop = 0;
+        OobTracker oob;
+        if (track_oob) {
+            oob_tracker_create(&oob, train_data, train_size, num_columns, num_classes, train_tree_proportion,
+                               options.bootstrap == BOOTSTRAP_REPLACEMENT, options.oob_tolerance, n_threads);
+            for (int t = 0; checkpointed_trees != NULL && t < num_trees; t++) {
+                oob_tracker_add_tree(&oob, &checkpointed_trees[t], seed + t);
+            }
+        }
         
-        for (int t = 0; t < num_trees_assigned; t++) {
-            printf("Process %d: Training tree %d/%d\n", rank, t+1, num_trees_assigned);
+        int slot;
+        while (!oob_stop && (slot = tree_scheduler_next(&scheduler, num_remaining)) >= 0) {
+            int tree_id = remaining_trees[slot];
+            printf("Process %d: Training tree %d/%d\n", rank, tree_id + 1, num_trees);
             printf("====================================================\n");
             fflush(stdout);
             double tree_start = MPI_Wtime();
+
+            double sample_start = profile_start();
+            unsigned int rng = (unsigned int)(seed + tree_id);
+            if (options.bootstrap == BOOTSTRAP_COPY) {
+                my_sample_size = sample_data_without_replacement(
+                    train_data, train_size, num_columns, train_tree_proportion, my_train_data, &rng);
+            } else {
+                my_sample_size = draw_bootstrap(train_size, train_tree_proportion,
+                                                options.bootstrap == BOOTSTRAP_REPLACEMENT,
+                                                sample_counts, sample_rows, &rng);
+            }
+            if (my_sample_size <= 0) {
+                fprintf(stderr, "Process %d: Error in sampling data (got size: %d)\n", rank, my_sample_size);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            profile_phase_end(PHASE_SAMPLE, sample_start);
             
-            train_tree_1d(&trees[t], my_train_data, my_sample_size, num_columns, num_classes,
-                         max_depth, min_samples_split, max_features, n_threads);
+            double grow_start = profile_start();
+            if (options.bootstrap == BOOTSTRAP_COPY) {
+                train_tree_1d(&trees[num_local_trees], my_train_data, my_sample_size, num_columns, num_classes,
+                             max_depth, min_samples_split, max_features, options.splitter, n_threads, &rng);
+            } else {
+                train_tree_weighted(&trees[num_local_trees], train_data, num_columns, sample_rows, sample_counts,
+                                    my_sample_size, num_classes, max_depth, min_samples_split, max_features,
+                                    options.splitter, n_threads, &rng);
+            }
+            profile_phase_end(PHASE_TRAIN, grow_start);
+            if (options.checkpoint_path != NULL) {
+                checkpoint_write_tree(&checkpoint, &trees[num_local_trees], tree_id);
+            }
+            local_tree_ids[num_local_trees] = tree_id;
+            num_local_trees++;
             
             double tree_end = MPI_Wtime();
             printf("Process %d: Finished tree %d/%d in %.4f seconds\n", 
-                   rank, t+1, num_trees_assigned, tree_end - tree_start);
+                   rank, tree_id + 1, num_trees, tree_end - tree_start);
             fflush(stdout);
+
+            if (track_oob) {
+                oob_tracker_add_tree(&oob, &trees[num_local_trees - 1], seed + tree_id);
+                oob_stop = oob_tracker_end_round(&oob, MPI_COMM_WORLD);
+            }
+        }
+        // A process without trees left keeps joining the rounds until the forest stops growing
+        while (track_oob && !oob_stop) {
+            oob_stop = oob_tracker_end_round(&oob, MPI_COMM_WORLD);
+        }
+        if (track_oob) {
+            if (rank == 0) {
+                printf("Process 0: Out-of-bag accuracy %.4f with %d of %d trees (best %.4f at %d trees)\n",
+                       oob.accuracy, oob.num_trees, num_trees, oob.best_accuracy, oob.best_trees);
+                fflush(stdout);
+            }
+            oob_tracker_free(&oob);
         }
 
         train_end = MPI_Wtime();
+        train_time = train_end - train_start;
 		
-		printf("Process %d: Finished all the training\n", rank);
+		printf("Process %d: Finished all the training (%d trees)\n", rank, num_local_trees);
 		fflush(stdout);
+
+        tree_scheduler_free(&scheduler);
         
         // Free training data after training is complete
-        if (my_train_data) {
-			printf("Process %d: About to free my train data \n", rank);
-			fflush(stdout);
-            free(my_train_data);
-            my_train_data = NULL;
+        free(my_train_data);
+        my_train_data = NULL;
+        free(sample_counts);
+        free(sample_rows);
+    }
+
+    if (mode == 0 && options.checkpoint_path != NULL) {
+        checkpoint_close(&checkpoint);
+    }
+
+    if (mode == 0 && counters_enabled()) {
+        // Work done by every process and by the whole job, to compare runs independently of timing
+        long long local_counters[COUNTER_COUNT], total_counters[COUNTER_COUNT];
+        counters_get(local_counters);
+        MPI_Reduce(local_counters, total_counters, COUNTER_COUNT, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+        printf("Process %d: Work counters:", rank);
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            printf(" %s=%lld", counter_name(c), local_counters[c]);
         }
-        
+        printf("\n");
+        if (rank == 0) {
+            printf("Process 0: Total work counters:");
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                printf(" %s=%lld", counter_name(c), total_counters[c]);
+            }
+            printf("\n");
+        }
+        fflush(stdout);
+    }
+    free(remaining_trees);
+
+    // Training data is no longer needed once every process has built its trees
+    if (options.shared_memory) {
+        shared_dataset_free_train(&shared);
+        train_data = NULL;
+    } else if (train_data) {
+        free(train_data);
+        train_data = NULL;
+    }
+
+    if (mode == 1) {
+        // Process 0 loads the saved forest and scatters it: every process scores the
+        // test set with its share of the trees
+        if (rank == 0) {
+            printf("Process 0: Loading forest from %s\n", trained_forest_path);
+            fflush(stdout);
+
+            Forest *loaded_forest = (Forest *)malloc(sizeof(Forest));
+            if (!loaded_forest || deserialize_forest(loaded_forest, trained_forest_path) != 0 ||
+                loaded_forest->num_trees <= 0 || loaded_forest->num_trees > VOTE_MAX) {
+                fprintf(stderr, "Process 0: Failed to load a usable forest from %s\n", trained_forest_path);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            num_trees = loaded_forest->num_trees;
+
+            trees = distribute_forest(loaded_forest->trees, loaded_forest->num_trees, &num_local_trees);
+            free_forest(loaded_forest);
+        } else {
+            trees = receive_forest(&num_local_trees);
+        }
+        MPI_Bcast(&num_trees, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+        printf("Process %d: Received %d trees to score\n", rank, num_local_trees);
+        fflush(stdout);
+    }
+
+    if (options.compact_trees && num_local_trees > 0) {
+        // Lossless, so it also applies to loaded forests and to trees already scored by the pipeline
+        CompactionStats compaction = {0, 0, 0, 0, 0, 0};
+        for (int t = 0; t < num_local_trees; t++) {
+            compact_tree(&trees[t], &compaction);
+        }
+        printf("Process %d: Compaction of %d trees: %lld -> %lld nodes (-%.1f%%), max depth %d -> %d, %lld -> %lld KB\n",
+               rank, num_local_trees, compaction.nodes_before, compaction.nodes_after,
+               100.0 * (compaction.nodes_before - compaction.nodes_after) / compaction.nodes_before,
+               compaction.depth_before, compaction.depth_after,
+               compaction.bytes_before / 1024, compaction.bytes_after / 1024);
+        fflush(stdout);
+    }
+
+    // Early exit needs the whole forest next to the rows a process scores: true in data and
+    // feature parallelism, and in tree parallelism with a single process
+    int early_exit = options.early_exit && !options.pipeline && options.checkpoint_path == NULL &&
+                     ((mode == 0 && options.parallelism != PARALLELISM_TREE) || process_number == 1);
+    if (options.early_exit && !early_exit && rank == 0) {
+        printf("Process 0: --early_exit needs every tree on every process and no pipeline or checkpoint, scoring all the trees\n");
+        fflush(stdout);
+    }
+
+    if (options.pipeline) {
+        // Votes were already scored and reduced tree by tree
+    } else if (num_local_trees > 0) {
         // Start inference timing
         infer_start = MPI_Wtime();
+        double scoring_start = profile_start();
         
-        // Allocate space for predictions from all trees
-        int *local_predictions = (int *)malloc(num_trees_assigned * test_size * sizeof(int));
-        if (!local_predictions) {
-            fprintf(stderr, "Process %d: Malloc failed for local_predictions\n", rank);
-            MPI_Abort(MPI_COMM_WORLD, 1);
-        }
-        
-        // Make predictions with all trees
-        for (int t = 0; t < num_trees_assigned; t++) {
-            int *tree_preds = tree_inference_1d(&trees[t], test_data, test_size, num_columns);
-            if (!tree_preds) {
-                fprintf(stderr, "Process %d: tree_inference_1d returned NULL for tree %d\n", rank, t);
+        if (early_exit) {
+            // Each row gets a single vote for the class its full vote would elect, so the
+            // reduction and the aggregation below are unchanged
+            int *order = NULL;
+            if (options.confidence_order) {
+                order = (int *)malloc(num_local_trees * sizeof(int));
+                if (!order) {
+                    fprintf(stderr, "Process %d: Malloc failed for the tree order\n", rank);
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                int calibration_rows = local_test_size < EARLY_EXIT_CALIBRATION_ROWS ? local_test_size : EARLY_EXIT_CALIBRATION_ROWS;
+                order_trees_by_agreement(trees, num_local_trees, local_test_data, calibration_rows, num_columns,
+                                         num_classes, order);
+            }
+            int *row_predictions = (int *)malloc((local_test_size > 0 ? local_test_size : 1) * sizeof(int));
+            if (!row_predictions) {
+                fprintf(stderr, "Process %d: Malloc failed for the early-exit predictions\n", rank);
                 MPI_Abort(MPI_COMM_WORLD, 1);
             }
-            
-            // Copy predictions for this tree
-            for (int i = 0; i < test_size; i++) {
-                local_predictions[t * test_size + i] = tree_preds[i];
+            long long evaluated = forest_predict_early_exit_1d(trees, order, num_local_trees, local_test_data,
+                                                               local_test_size, num_columns, num_classes, row_predictions);
+            for (int i = 0; i < local_test_size; i++) {
+                local_votes[(size_t)(first_test_row + i) * num_classes + row_predictions[i]] = 1;
+            }
+            printf("Process %d: Early exit evaluated %.2f of %d trees per row on average\n", rank,
+                   local_test_size > 0 ? (double)evaluated / local_test_size : 0.0, num_local_trees);
+            fflush(stdout);
+            free(row_predictions);
+            free(order);
+        } else {
+            // Tally the votes of all local trees into the test_size x num_classes matrix
+            for (int t = 0; t < num_local_trees; t++) {
+                tree_inference_votes_1d(&trees[t], local_test_data, local_test_size, num_columns, num_classes,
+                                        local_votes + (size_t)first_test_row * num_classes);
             }
-            
-            // Free the predictions for this tree
-            free(tree_preds);
         }
         
         infer_end = MPI_Wtime();
-        
-        // Calculate times
-        train_time = train_end - train_start;
         inference_time = infer_end - infer_start;
+        profile_phase_end(PHASE_INFERENCE, scoring_start);
         
         printf("Process %d: Completed - train_time: %.6f, inference_time: %.6f, total_time: %.6f\n", 
                rank, train_time, inference_time, total_time);
         fflush(stdout);
-        
-		if (rank == 0) {
-				// Process 0 collects all predictions
-				printf("Process 0: Collecting predictions from all processes\n");
-				fflush(stdout);
-				
-				// Use the existing tree_counts and tree_displs arrays
-				// (no need to recreate them)
-				
-				// Allocate memory for all predictions
-				int **all_predictions = (int **)malloc(process_number * sizeof(int *));
-				if (!all_predictions) {
-					fprintf(stderr, "Process 0: Failed to allocate all_predictions array\n");
-					MPI_Abort(MPI_COMM_WORLD, 1);
-				}
-				
-				// Process 0's own predictions
-				all_predictions[0] = local_predictions;
-				
-				// Receive predictions from other processes
-				for (int p = 1; p < process_number; p++) {
-					if (tree_counts[p] > 0) {
-						all_predictions[p] = (int *)malloc(tree_counts[p] * test_size * sizeof(int));
-						if (!all_predictions[p]) {
-							fprintf(stderr, "Process 0: Failed to allocate predictions array for process %d\n", p);
-							MPI_Abort(MPI_COMM_WORLD, 1);
-						}
-						
-						printf("Process 0: Receiving %d predictions from process %d\n", 
-							   tree_counts[p] * test_size, p);
-						fflush(stdout);
-						
-						MPI_Recv(all_predictions[p], tree_counts[p] * test_size, MPI_INT, p, 0, 
-								 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-					} else {
-						all_predictions[p] = NULL;  // No predictions from this process
-					}
-				}
-				
-				printf("Process 0: All predictions collected, starting aggregation\n");
-				fflush(stdout);
-				
-				// Aggregate predictions and save results
-				aggregate_and_save_predictions(process_number, test_size, num_classes,
-											 all_predictions, tree_counts, targets,
-											 store_predictions_path, store_metrics_path, rank);
-				
-				printf("Process 0: All predictions aggregated, results available\n");
-				fflush(stdout);
-				
-				global_end = MPI_Wtime(); 
-				
-				// Clean up prediction arrays
-				for (int p = 1; p < process_number; p++) {
-					if (all_predictions[p]) {
-						free(all_predictions[p]);
-					}
-				}
-				free(all_predictions);
-				
-				printf("Process 0: Prediction aggregation and saving completed\n");
-				fflush(stdout);
-				
-			} else {
-				// Other processes send their predictions to process 0
-				printf("Process %d: Sending %d predictions to process 0\n", 
-					   rank, num_trees_assigned * test_size);
-				fflush(stdout);
-				
-				MPI_Send(local_predictions, num_trees_assigned * test_size, MPI_INT, 0, 0, MPI_COMM_WORLD);
-				
-				printf("Process %d: Predictions sent to process 0\n", rank);
-				fflush(stdout);
-				
-			}
-
-        // Clean up memory
-        free(local_predictions);
-        
-        // Free memory for all trained trees
-		printf("Process %d: about to destroy all my trees", rank);
+	} else {
+        printf("Process %d: No trees to score, skipping inference\n", rank);
         fflush(stdout);
-		
-//        for (int t = 0; t < num_trees_assigned; t++) {
-//			printf("Process %d: about to destroy %d my tree", rank, t);
-//          destroy_tree(&trees[t]);
-//			printf("Process %d: destroyed my %d tree", rank, t);
-//        	fflush(stdout);
-//        }
-		printf("Process %d: about to destroy my tree array", rank);
+    }
 
-        free(trees);
-		printf("Process %d: destroyed my trees array", rank);
-        
+    // Sum the vote matrices of all processes on process 0: the message size depends
+    // only on test_size and num_classes, not on the number of trees
+    double aggregation_start = profile_start();
+    if (!options.pipeline) {
+        MPI_Reduce(local_votes, global_votes, test_size * num_classes, MPI_UNSIGNED_SHORT, MPI_SUM, 0, MPI_COMM_WORLD);
+    }
 
-	} else if (num_trees_assigned == 0) {
-        printf("Process %d: No trees assigned, skipping computation\n", rank);
+    if (rank == 0) {
+        printf("Process 0: All votes reduced, starting aggregation\n");
         fflush(stdout);
-        
-        // Initialize timing variables for processes with no trees
-        train_time = 0.0;
-        inference_time = 0.0;
-        total_time = 0.0;
+
+        if (checkpointed_trees != NULL) {
+            // Trees trained before the restart are only held by process 0
+            double resume_start = MPI_Wtime();
+            double scoring_start = profile_start();
+            for (int t = 0; t < num_trees; t++) {
+                if (checkpointed_trees[t].nodes != NULL) {
+                    tree_inference_votes_1d(&checkpointed_trees[t], test_data, test_size, num_columns, num_classes, global_votes);
+                }
+            }
+            inference_time += MPI_Wtime() - resume_start;
+            profile_phase_end(PHASE_INFERENCE, scoring_start);
+        }
+
+        aggregate_and_save_predictions(test_size, num_classes, global_votes, targets,
+                                       store_predictions_path, store_metrics_path, rank);
+
+        global_end = MPI_Wtime();
+
+        printf("Process 0: Prediction aggregation and saving completed\n");
+        fflush(stdout);
+        free(global_votes);
+    }
+    free(local_votes);
+    profile_phase_end(PHASE_AGGREGATION, aggregation_start);
+
+    if (mode == 0) {
+        // Process 0 collects every tree and saves the forest as a single model file
+        double save_start = profile_start();
+        Forest *model = NULL;
+        if (rank == 0) {
+            model = (Forest *)malloc(sizeof(Forest));
+            if (!model) {
+                fprintf(stderr, "Process 0: Malloc failed for the saved forest\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            create_forest(model, num_trees, max_depth, min_samples_split, max_features);
+        }
+
+        if (options.parallelism == PARALLELISM_TREE) {
+            gather_forest(trees, local_tree_ids, num_local_trees, rank == 0 ? model->trees : NULL);
+        } else if (rank == 0) {
+            // Every process holds the whole forest, process 0 hands its copy over
+            memcpy(model->trees, trees, num_trees * sizeof(Tree));
+            num_local_trees = 0;
+        }
+
+        if (rank == 0) {
+            if (checkpointed_trees != NULL) {
+                for (int t = 0; t < num_trees; t++) {
+                    if (checkpointed_trees[t].nodes != NULL) {
+                        model->trees[t] = checkpointed_trees[t];
+                    }
+                }
+                free(checkpointed_trees);
+                checkpointed_trees = NULL;
+            }
+
+            // Trees never trained because the out-of-bag accuracy converged are left out
+            int num_saved = 0;
+            for (int t = 0; t < model->num_trees; t++) {
+                if (model->trees[t].nodes != NULL) {
+                    model->trees[num_saved++] = model->trees[t];
+                }
+            }
+            model->num_trees = num_saved;
+
+            serialize_forest(model, new_forest_path);
+            printf("Process 0: Saved %d trees to %s/%s\n", model->num_trees, new_forest_path, FOREST_MODEL_FILE);
+            fflush(stdout);
+            free_forest(model);
+        }
+        profile_phase_end(PHASE_SAVE, save_start);
     }
+
+    // Free memory for all trained trees
+    if (trees) {
+        for (int t = 0; t < num_local_trees; t++) {
+            free_tree(&trees[t]);
+        }
+        free(trees);
+        trees = NULL;
+    }
+    free(local_tree_ids);
     
     // Clean up test data and targets for ALL processes
-    if (test_data) {
+    if (options.shared_memory) {
+        shared_dataset_free_test(&shared);
+        test_data = NULL;
+    } else if (test_data) {
         free(test_data);
         test_data = NULL;
     }
@@ -453,6 +923,10 @@ int main(int argc, char *argv[]) {
     }
 	free(tree_counts);
 	free(tree_displs);
+
+    if (options.profile_path != NULL) {
+        profile_write_report(options.profile_path, n_threads);
+    }
     
     MPI_Finalize();
     return 0;
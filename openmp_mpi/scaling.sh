@@ -0,0 +1,130 @@
+#!/bin/bash
+# Local strong/weak scaling driver: sweeps mpirun -np counts and OpenMP thread counts on
+# one machine, repeats every configuration, and prints speedup/efficiency tables against
+# a 1 process x 1 thread baseline that it runs itself.
+#
+# Strong scaling keeps the forest fixed (N_TREES trees). Weak scaling gives every worker
+# (process x thread) N_TREES trees, so the forest grows with the number of workers.
+#
+# Every setting can be overridden from the environment, e.g.
+#   PROCESSES="1 2 4" THREADS="1 2" REPS=5 MODE=strong ./scaling.sh
+#   make scaling SCALING_ENV='PROCESSES="1 2" MPIRUN_FLAGS="--oversubscribe"'
+
+DATASET="${DATASET:-../data/classification_dataset.csv}"
+N_TREES="${N_TREES:-8}"
+MIN_SAMPLES_SPLIT="${MIN_SAMPLES_SPLIT:-200}"
+MAX_DEPTH="${MAX_DEPTH:-10}"
+PROCESSES="${PROCESSES:-1 2 4}"
+THREADS="${THREADS:-1 2 4}"
+REPS="${REPS:-3}"
+MODE="${MODE:-both}"                     # strong, weak or both
+MPIRUN="${MPIRUN:-mpirun}"
+MPIRUN_FLAGS="${MPIRUN_FLAGS:-}"
+EXTRA_ARGS="${EXTRA_ARGS:-}"             # Extra ./final options, e.g. "--schedule dynamic"
+OUTDIR="${OUTDIR:-output/scaling}"
+
+if [ ! -x ./final ]; then
+  echo "./final not found, run make first" >&2
+  exit 1
+fi
+if [ ! -f "$DATASET" ]; then
+  echo "Dataset $DATASET not found" >&2
+  exit 1
+fi
+case "$MODE" in
+  strong|weak|both) ;;
+  *) echo "MODE must be strong, weak or both, instead $MODE was provided" >&2; exit 1 ;;
+esac
+
+mkdir -p "$OUTDIR/logs"
+RAW="$OUTDIR/runs.csv"
+echo "mode,processes,threads,trees,rep,train_time,total_time" > "$RAW"
+
+# Runs one configuration REPS times and appends the timings to the raw CSV
+run_config() {
+  local mode=$1 processes=$2 threads=$3 trees=$4
+  for rep in $(seq 1 "$REPS"); do
+    local log="$OUTDIR/logs/${mode}_p${processes}_t${threads}_r${rep}.log"
+    echo "Running $mode: $processes processes x $threads threads, $trees trees (rep $rep/$REPS)"
+    OMP_NUM_THREADS=$threads $MPIRUN $MPIRUN_FLAGS -np "$processes" ./final \
+      --n_threads "$threads" \
+      --num_trees "$trees" \
+      --max_depth "$MAX_DEPTH" \
+      --min_samples_split "$MIN_SAMPLES_SPLIT" \
+      --dataset_path "$DATASET" \
+      --store_predictions_path "$OUTDIR/predictions.csv" \
+      --store_metrics_path "$OUTDIR/metrics_output.txt" \
+      --new_forest_path "$OUTDIR/model" \
+      $EXTRA_ARGS > "$log" 2>&1
+    if [ $? -ne 0 ]; then
+      echo "Run failed, see $log" >&2
+      exit 1
+    fi
+    local train_time total_time
+    train_time=$(awk -F': ' '/^Maximum training time/ {print $2 + 0}' "$log")
+    total_time=$(awk -F': ' '/^Maximum total time/ {print $2 + 0}' "$log")
+    echo "$mode,$processes,$threads,$trees,$rep,$train_time,$total_time" >> "$RAW"
+  done
+}
+
+# The baseline serves both modes: 1 worker trains N_TREES trees in both cases
+run_config baseline 1 1 "$N_TREES"
+for processes in $PROCESSES; do
+  for threads in $THREADS; do
+    if [ "$processes" -eq 1 ] && [ "$threads" -eq 1 ]; then
+      continue
+    fi
+    if [ "$MODE" != "weak" ]; then
+      run_config strong "$processes" "$threads" "$N_TREES"
+    fi
+    if [ "$MODE" != "strong" ]; then
+      run_config weak "$processes" "$threads" $((N_TREES * processes * threads))
+    fi
+  done
+done
+
+# Mean and sample standard deviation of every configuration, then speedup and efficiency
+# against the mean baseline time. The spread of the speedup is propagated from the spread
+# of the configuration time (first order).
+for mode in strong weak; do
+  if [ "$MODE" != "both" ] && [ "$MODE" != "$mode" ]; then
+    continue
+  fi
+  TABLE="$OUTDIR/${mode}_scaling.csv"
+  awk -F, -v mode="$mode" '
+    NR == 1 { next }
+    $1 == "baseline" || $1 == mode {
+      key = ($1 == "baseline") ? "1,1" : $2 "," $3
+      if (!(key in n)) { order[++keys] = key; trees[key] = $4 }
+      n[key]++
+      train_sum[key] += $6; train_sq[key] += $6 * $6
+      total_sum[key] += $7; total_sq[key] += $7 * $7
+    }
+    function stddev(sum, sq, count) {
+      if (count < 2) return 0
+      v = (sq - sum * sum / count) / (count - 1)
+      return v > 0 ? sqrt(v) : 0
+    }
+    END {
+      print "processes,threads,workers,trees,reps,train_mean,train_std,total_mean,total_std,speedup,speedup_std,efficiency"
+      base = total_sum["1,1"] / n["1,1"]
+      for (i = 1; i <= keys; i++) {
+        key = order[i]
+        split(key, pt, ",")
+        workers = pt[1] * pt[2]
+        train_mean = train_sum[key] / n[key]
+        total_mean = total_sum[key] / n[key]
+        total_std = stddev(total_sum[key], total_sq[key], n[key])
+        # Strong: T1 / Tp. Weak: the work grows with the workers, so the scaled speedup is p * T1 / Tp
+        speedup = (mode == "strong" ? 1 : workers) * base / total_mean
+        printf "%d,%d,%d,%d,%d,%.6f,%.6f,%.6f,%.6f,%.3f,%.3f,%.3f\n", pt[1], pt[2], workers, trees[key], n[key],
+               train_mean, stddev(train_sum[key], train_sq[key], n[key]), total_mean, total_std,
+               speedup, speedup * total_std / total_mean, speedup / workers
+      }
+    }' "$RAW" > "$TABLE"
+
+  echo
+  echo "=== ${mode^^} SCALING (baseline 1 process x 1 thread, $REPS reps) ==="
+  column -s, -t < "$TABLE" 2>/dev/null || cat "$TABLE"
+  echo "Saved to $TABLE"
+done
@@ -0,0 +1,470 @@
+/**
+ * @file score.c
+ * @brief Streaming batch scoring: predicts a dataset of any size in constant memory.
+ *
+ * Rows are read from a CSV or binary dataset (or stdin) in blocks of --block_rows and
+ * flow through a three-stage pipeline over a ring of SCORE_SLOTS blocks: a reader thread
+ * parses block k + 1 while the main thread scores block k with all the trees (rf_predict
+ * on --n_threads OpenMP threads) and a writer thread writes the predictions of block
+ * k - 1. Memory is bounded by the ring, whatever the number of rows.
+ *
+ * The input has either one column per feature or an extra last column with the label, in
+ * which case the accuracy is reported as well. Predictions are written in the format of
+ * ./final (a "Predictions" header, then one class per line). The summary goes to stderr,
+ * so that predictions can be written to stdout.
+ *
+ * Usage: ./score/forest_score (--model path | --trained_forest_path dir --num_features N --num_classes N)
+ *                             [--input path|-] [--output path|-] [--block_rows N] [--n_threads N]
+ *                             [--format csv|bin] [--header 0|1] [--early_exit 0|1]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "../lib/libforest.h"
+#include "../headers/utils.h"
+
+#define SCORE_SLOTS 3  // One block being parsed, one being scored and one being written
+
+/**
+ * @brief Command-line settings of the scorer.
+ */
+typedef struct ScoreConfig {
+    const char *model_path;    /**< Model written by rf_save(). */
+    const char *forest_path;   /**< Forest directory written by ./final. */
+    int num_features;          /**< Features of forest_path. */
+    int num_classes;           /**< Classes of forest_path. */
+    const char *input;         /**< Dataset path, "-" for stdin. */
+    const char *output;        /**< Predictions path, "-" for stdout. */
+    int block_rows;            /**< Rows per block. */
+    int threads;               /**< OpenMP threads of the inference kernel. */
+    int early_exit;            /**< Stop scoring a row once its vote is decided. */
+    int binary;                /**< Input is a binary dataset instead of CSV. */
+    int header;                /**< The CSV input starts with a header line. */
+} ScoreConfig;
+
+typedef enum SlotState { SLOT_FREE, SLOT_PARSED, SLOT_SCORED } SlotState;
+
+/**
+ * @brief A block of rows and its predictions.
+ */
+typedef struct Slot {
+    SlotState state;
+    float *rows;        /**< block_rows x num_features. */
+    int *targets;       /**< Labels, when the input has them. */
+    int *predictions;
+    int num_rows;       /**< 0 marks the end of the input. */
+} Slot;
+
+/**
+ * @brief State shared by the three stages.
+ */
+typedef struct Pipeline {
+    const ScoreConfig *config;
+    RFModel *model;
+    int num_features;
+    FILE *input;
+    FILE *output;
+    int has_targets;            /**< Input rows carry a label column. */
+    int input_columns;          /**< Columns of a binary input. */
+    long long remaining_rows;   /**< Rows left in a binary input. */
+    char *line;                 /**< getline() buffer of the reader. */
+    size_t line_capacity;
+    int pending_line;           /**< The reader already holds the first data line. */
+    long long line_number;
+
+    Slot slots[SCORE_SLOTS];
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int failed;
+
+    long long rows;             /**< Rows scored. */
+    long long correct;          /**< Correct predictions, when there are labels. */
+    double score_time;          /**< Time spent in rf_predict. */
+} Pipeline;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *checked_malloc(size_t bytes) {
+    void *ptr = malloc(bytes > 0 ? bytes : 1);
+    if (ptr == NULL) {
+        fprintf(stderr, "Scorer: Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+/* ---- pipeline hand-off ---- */
+
+static Slot *wait_slot(Pipeline *pipeline, int index, SlotState state) {
+    Slot *slot = &pipeline->slots[index % SCORE_SLOTS];
+    pthread_mutex_lock(&pipeline->lock);
+    while (slot->state != state && !pipeline->failed) {
+        pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return pipeline->failed ? NULL : slot;
+}
+
+static void publish_slot(Pipeline *pipeline, Slot *slot, SlotState state) {
+    pthread_mutex_lock(&pipeline->lock);
+    slot->state = state;
+    pthread_cond_broadcast(&pipeline->changed);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+static void fail(Pipeline *pipeline) {
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->failed = 1;
+    pthread_cond_broadcast(&pipeline->changed);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+/* ---- reader ---- */
+
+// Parses one CSV line into the features of a row and its label. Returns the number of fields
+static int parse_line(char *line, float *row, int num_features, int *target) {
+    int fields = 0;
+    char *cursor = line;
+    for (;;) {
+        char *end;
+        float value = strtof(cursor, &end);
+        if (end == cursor) {
+            return -1;
+        }
+        if (fields < num_features) {
+            row[fields] = value;
+        } else if (fields == num_features) {
+            *target = (int)value;
+        }
+        fields++;
+        while (*end == ' ' || *end == '\t' || *end == '\r' || *end == '\n') end++;
+        if (*end == '\0') {
+            return fields;
+        }
+        if (*end != ',') {
+            return -1;
+        }
+        cursor = end + 1;
+    }
+}
+
+static int read_csv_block(Pipeline *pipeline, Slot *slot) {
+    int num_features = pipeline->num_features;
+    int count = 0;
+    while (count < pipeline->config->block_rows) {
+        if (!pipeline->pending_line) {
+            if (getline(&pipeline->line, &pipeline->line_capacity, pipeline->input) < 0) {
+                break;
+            }
+            pipeline->line_number++;
+        }
+        pipeline->pending_line = 0;
+        if (pipeline->line[strspn(pipeline->line, " \t\r\n")] == '\0') {
+            continue;  // Blank line
+        }
+        int target = 0;
+        int fields = parse_line(pipeline->line, slot->rows + (size_t)count * num_features, num_features, &target);
+        if (fields != num_features + pipeline->has_targets) {
+            fprintf(stderr, "Scorer: Line %lld has %d fields, expected %d\n", pipeline->line_number, fields,
+                    num_features + pipeline->has_targets);
+            return -1;
+        }
+        slot->targets[count++] = target;
+    }
+    return count;
+}
+
+static int read_binary_block(Pipeline *pipeline, Slot *slot) {
+    int num_features = pipeline->num_features;
+    int count = pipeline->remaining_rows < pipeline->config->block_rows ? (int)pipeline->remaining_rows
+                                                                         : pipeline->config->block_rows;
+    if (!pipeline->has_targets) {
+        if (fread(slot->rows, sizeof(float), (size_t)count * num_features, pipeline->input) != (size_t)count * num_features) {
+            fprintf(stderr, "Scorer: The binary input is truncated\n");
+            return -1;
+        }
+    } else {
+        // Rows are read one at a time to drop the label column in place
+        for (int i = 0; i < count; i++) {
+            float label;
+            if (fread(slot->rows + (size_t)i * num_features, sizeof(float), num_features, pipeline->input) != (size_t)num_features ||
+                fread(&label, sizeof(float), 1, pipeline->input) != 1) {
+                fprintf(stderr, "Scorer: The binary input is truncated\n");
+                return -1;
+            }
+            slot->targets[i] = (int)label;
+        }
+    }
+    pipeline->remaining_rows -= count;
+    return count;
+}
+
+static void *reader_main(void *arg) {
+    Pipeline *pipeline = (Pipeline *)arg;
+    for (int block = 0;; block++) {
+        Slot *slot = wait_slot(pipeline, block, SLOT_FREE);
+        if (slot == NULL) {
+            return NULL;
+        }
+        int count = pipeline->config->binary ? read_binary_block(pipeline, slot) : read_csv_block(pipeline, slot);
+        if (count < 0) {
+            fail(pipeline);
+            return NULL;
+        }
+        slot->num_rows = count;
+        publish_slot(pipeline, slot, SLOT_PARSED);
+        if (count == 0) {
+            return NULL;
+        }
+    }
+}
+
+/* ---- writer ---- */
+
+static void *writer_main(void *arg) {
+    Pipeline *pipeline = (Pipeline *)arg;
+    for (int block = 0;; block++) {
+        Slot *slot = wait_slot(pipeline, block, SLOT_SCORED);
+        if (slot == NULL) {
+            return NULL;
+        }
+        if (slot->num_rows == 0) {
+            return NULL;
+        }
+        for (int i = 0; i < slot->num_rows; i++) {
+            fprintf(pipeline->output, "%d\n", slot->predictions[i]);
+        }
+        if (ferror(pipeline->output)) {
+            fprintf(stderr, "Scorer: Failed to write the predictions\n");
+            fail(pipeline);
+            return NULL;
+        }
+        publish_slot(pipeline, slot, SLOT_FREE);
+    }
+}
+
+/* ---- setup ---- */
+
+static int parse_score_arguments(int argc, char *argv[], ScoreConfig *config) {
+    config->model_path = NULL;
+    config->forest_path = NULL;
+    config->num_features = 0;
+    config->num_classes = 0;
+    config->input = "-";
+    config->output = "-";
+    config->block_rows = 65536;
+    config->threads = 1;
+    config->early_exit = 0;
+    config->binary = -1;
+    config->header = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s.\n", argv[i]);
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (strcmp(argv[i - 1], "--model") == 0) config->model_path = value;
+        else if (strcmp(argv[i - 1], "--trained_forest_path") == 0) config->forest_path = value;
+        else if (strcmp(argv[i - 1], "--num_features") == 0) config->num_features = atoi(value);
+        else if (strcmp(argv[i - 1], "--num_classes") == 0) config->num_classes = atoi(value);
+        else if (strcmp(argv[i - 1], "--input") == 0) config->input = value;
+        else if (strcmp(argv[i - 1], "--output") == 0) config->output = value;
+        else if (strcmp(argv[i - 1], "--block_rows") == 0) config->block_rows = atoi(value);
+        else if (strcmp(argv[i - 1], "--n_threads") == 0) config->threads = atoi(value);
+        else if (strcmp(argv[i - 1], "--early_exit") == 0) config->early_exit = atoi(value);
+        else if (strcmp(argv[i - 1], "--header") == 0) config->header = atoi(value);
+        else if (strcmp(argv[i - 1], "--format") == 0) {
+            if (strcmp(value, "csv") == 0) config->binary = 0;
+            else if (strcmp(value, "bin") == 0) config->binary = 1;
+            else {
+                fprintf(stderr, "Format must be csv or bin, instead %s was provided.\n", value);
+                return 1;
+            }
+        }
+        else {
+            fprintf(stderr, "Unknown option %s.\n", argv[i - 1]);
+            return 1;
+        }
+    }
+
+    if ((config->model_path == NULL) == (config->forest_path == NULL)) {
+        fprintf(stderr, "Exactly one of --model and --trained_forest_path is required.\n");
+        return 1;
+    }
+    if (config->forest_path != NULL && (config->num_features < 1 || config->num_classes < 2)) {
+        fprintf(stderr, "--trained_forest_path requires --num_features and --num_classes.\n");
+        return 1;
+    }
+    if (config->block_rows < 1 || config->threads < 1) {
+        fprintf(stderr, "Invalid scorer settings.\n");
+        return 1;
+    }
+    // Like read_dataset(), a .bin suffix selects the binary format unless --format says otherwise
+    if (config->binary < 0) {
+        size_t length = strlen(config->input);
+        config->binary = length >= 4 && strcmp(config->input + length - 4, ".bin") == 0;
+    }
+    return 0;
+}
+
+static RFModel *load_model(const ScoreConfig *config) {
+    RFModel *model = NULL;
+    int status = config->model_path != NULL
+                     ? rf_load(config->model_path, &model)
+                     : rf_load_forest_dir(config->forest_path, config->num_features, config->num_classes, &model);
+    if (status != RF_OK) {
+        fprintf(stderr, "Scorer: Failed to load the model: %s\n", rf_error_string(status));
+        return NULL;
+    }
+    rf_set_num_threads(model, config->threads);
+    rf_set_early_exit(model, config->early_exit);
+    return model;
+}
+
+// Reads the binary header or the first CSV data line to find whether rows carry a label
+static int open_input(Pipeline *pipeline) {
+    int num_features = pipeline->num_features;
+    if (pipeline->config->binary) {
+        int header[3];
+        if (fread(header, sizeof(int), 3, pipeline->input) != 3 || header[0] != DATASET_MAGIC || header[1] < 0 ||
+            (header[2] != num_features && header[2] != num_features + 1)) {
+            fprintf(stderr, "Scorer: The input is not a binary dataset with %d features\n", num_features);
+            return -1;
+        }
+        pipeline->remaining_rows = header[1];
+        pipeline->has_targets = header[2] == num_features + 1;
+        return 0;
+    }
+
+    if (pipeline->config->header && getline(&pipeline->line, &pipeline->line_capacity, pipeline->input) >= 0) {
+        pipeline->line_number++;
+    }
+    while (getline(&pipeline->line, &pipeline->line_capacity, pipeline->input) >= 0) {
+        pipeline->line_number++;
+        if (pipeline->line[strspn(pipeline->line, " \t\r\n")] == '\0') {
+            continue;
+        }
+        float *row = (float *)checked_malloc((num_features + 1) * sizeof(float));
+        int target;
+        int fields = parse_line(pipeline->line, row, num_features, &target);
+        free(row);
+        if (fields != num_features && fields != num_features + 1) {
+            fprintf(stderr, "Scorer: Line %lld has %d fields, expected %d or %d\n", pipeline->line_number, fields,
+                    num_features, num_features + 1);
+            return -1;
+        }
+        pipeline->has_targets = fields == num_features + 1;
+        pipeline->pending_line = 1;
+        break;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    ScoreConfig config;
+    if (parse_score_arguments(argc, argv, &config) != 0) {
+        return 1;
+    }
+    Pipeline pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.config = &config;
+    pipeline.model = load_model(&config);
+    if (pipeline.model == NULL) {
+        return 1;
+    }
+    pipeline.num_features = rf_num_features(pipeline.model);
+
+    pipeline.input = strcmp(config.input, "-") == 0 ? stdin : fopen(config.input, config.binary ? "rb" : "r");
+    pipeline.output = strcmp(config.output, "-") == 0 ? stdout : fopen(config.output, "w");
+    if (pipeline.input == NULL || pipeline.output == NULL) {
+        fprintf(stderr, "Scorer: Failed to open %s\n", pipeline.input == NULL ? config.input : config.output);
+        return 1;
+    }
+    if (open_input(&pipeline) != 0) {
+        return 1;
+    }
+
+    for (int s = 0; s < SCORE_SLOTS; s++) {
+        pipeline.slots[s].state = SLOT_FREE;
+        pipeline.slots[s].rows = (float *)checked_malloc((size_t)config.block_rows * pipeline.num_features * sizeof(float));
+        pipeline.slots[s].targets = (int *)checked_malloc((size_t)config.block_rows * sizeof(int));
+        pipeline.slots[s].predictions = (int *)checked_malloc((size_t)config.block_rows * sizeof(int));
+    }
+    pthread_mutex_init(&pipeline.lock, NULL);
+    pthread_cond_init(&pipeline.changed, NULL);
+    fprintf(pipeline.output, "Predictions\n");
+
+    double start = now_s();
+    pthread_t reader, writer;
+    if (pthread_create(&reader, NULL, reader_main, &pipeline) != 0 ||
+        pthread_create(&writer, NULL, writer_main, &pipeline) != 0) {
+        fprintf(stderr, "Scorer: Failed to start the pipeline threads\n");
+        return 1;
+    }
+
+    // Scoring stage: every block is scored with all the trees while its neighbours are parsed and written
+    for (int block = 0;; block++) {
+        Slot *slot = wait_slot(&pipeline, block, SLOT_PARSED);
+        if (slot == NULL) {
+            break;
+        }
+        if (slot->num_rows > 0) {
+            double score_start = now_s();
+            if (rf_predict(pipeline.model, slot->rows, slot->num_rows, slot->predictions) != RF_OK) {
+                fprintf(stderr, "Scorer: Prediction failed\n");
+                fail(&pipeline);
+                break;
+            }
+            pipeline.score_time += now_s() - score_start;
+            pipeline.rows += slot->num_rows;
+            for (int i = 0; i < slot->num_rows && pipeline.has_targets; i++) {
+                pipeline.correct += slot->predictions[i] == slot->targets[i];
+            }
+        }
+        publish_slot(&pipeline, slot, SLOT_SCORED);
+        if (slot->num_rows == 0) {
+            break;
+        }
+    }
+    pthread_join(reader, NULL);
+    pthread_join(writer, NULL);
+    double elapsed = now_s() - start;
+
+    int failed = pipeline.failed;
+    if (pipeline.output != stdout && fclose(pipeline.output) != 0) {
+        fprintf(stderr, "Scorer: Failed to write the predictions\n");
+        failed = 1;
+    } else if (pipeline.output == stdout) {
+        fflush(stdout);
+    }
+    if (pipeline.input != stdin) {
+        fclose(pipeline.input);
+    }
+
+    if (!failed) {
+        fprintf(stderr, "Scorer: %lld rows in %.3f s (%.0f rows/s), scoring %.3f s, blocks of %d rows, %d threads\n",
+                pipeline.rows, elapsed, elapsed > 0 ? pipeline.rows / elapsed : 0, pipeline.score_time,
+                config.block_rows, config.threads);
+        if (pipeline.has_targets && pipeline.rows > 0) {
+            fprintf(stderr, "Scorer: Accuracy %.6f\n", (double)pipeline.correct / pipeline.rows);
+        }
+    }
+
+    for (int s = 0; s < SCORE_SLOTS; s++) {
+        free(pipeline.slots[s].rows);
+        free(pipeline.slots[s].targets);
+        free(pipeline.slots[s].predictions);
+    }
+    free(pipeline.line);
+    rf_free(pipeline.model);
+    return failed;
+}
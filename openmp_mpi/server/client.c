@@ -0,0 +1,249 @@
+/**
+ * @file client.c
+ * @brief Load generator for forest_server.
+ *
+ * Opens --connections concurrent connections, each sending --requests requests of --rows
+ * random rows and waiting for the answer before sending the next one. It reports the
+ * end-to-end latency percentiles and throughput seen by the clients, then prints the
+ * statistics of the server.
+ *
+ * Usage: ./server/forest_client (--socket path | --port N) [--connections N] [--requests N]
+ *                               [--rows N] [--seed N]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "protocol.h"
+
+/**
+ * @brief Command-line settings of the load generator.
+ */
+typedef struct ClientConfig {
+    const char *socket_path;  /**< Unix domain socket of the server. */
+    int port;                 /**< Loopback TCP port of the server, when there is no socket_path. */
+    int connections;          /**< Concurrent connections. */
+    int requests;             /**< Requests sent by every connection. */
+    int rows;                 /**< Rows per request. */
+    int seed;                 /**< Seed of the random rows. */
+} ClientConfig;
+
+/**
+ * @brief Work and results of one connection.
+ */
+typedef struct Worker {
+    const ClientConfig *config;
+    int index;
+    double *latencies;        /**< End-to-end latency of every request (us). */
+    int failed;
+} Worker;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void *checked_malloc(size_t bytes) {
+    void *ptr = malloc(bytes > 0 ? bytes : 1);
+    if (ptr == NULL) {
+        fprintf(stderr, "Client: Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int count, double p) {
+    int index = (int)(p * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+static int connect_server(const ClientConfig *config) {
+    int fd;
+    if (config->socket_path != NULL) {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, config->socket_path, sizeof(address.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t)config->port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+        if (fd >= 0) {
+            int no_delay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        }
+    }
+    return fd;
+}
+
+static int read_hello(int fd, ServerHello *hello) {
+    return read_full(fd, hello, sizeof(*hello)) != 0 || hello->magic != SERVER_MAGIC;
+}
+
+static void *worker_main(void *arg) {
+    Worker *worker = (Worker *)arg;
+    const ClientConfig *config = worker->config;
+    ServerHello hello;
+    int fd = connect_server(config);
+    if (fd < 0 || read_hello(fd, &hello) != 0 || config->rows > hello.max_rows) {
+        worker->failed = 1;
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+
+    unsigned int state = (unsigned int)(config->seed * 7919 + worker->index);
+    size_t num_values = (size_t)config->rows * hello.num_features;
+    float *rows = (float *)checked_malloc(num_values * sizeof(float));
+    int *predictions = (int *)checked_malloc((size_t)config->rows * sizeof(int));
+
+    for (int r = 0; r < config->requests && !worker->failed; r++) {
+        for (size_t v = 0; v < num_values; v++) {
+            state = state * 1103515245u + 12345u;
+            rows[v] = ((state >> 8) & 0xFFFF) / 65535.0f * 6.0f - 3.0f;
+        }
+        int32_t num_rows = config->rows, answered = 0;
+        double start = now_us();
+        if (write_full(fd, &num_rows, sizeof(num_rows)) != 0 || write_full(fd, rows, num_values * sizeof(float)) != 0 ||
+            read_full(fd, &answered, sizeof(answered)) != 0 || answered != num_rows ||
+            read_full(fd, predictions, (size_t)num_rows * sizeof(int)) != 0) {
+            worker->failed = 1;
+            break;
+        }
+        worker->latencies[r] = now_us() - start;
+        for (int i = 0; i < num_rows; i++) {
+            if (predictions[i] < 0 || predictions[i] >= hello.num_classes) {
+                worker->failed = 1;
+            }
+        }
+    }
+    close(fd);
+    free(rows);
+    free(predictions);
+    return NULL;
+}
+
+static void print_server_stats(const ClientConfig *config) {
+    ServerHello hello;
+    int fd = connect_server(config);
+    if (fd < 0 || read_hello(fd, &hello) != 0) {
+        if (fd >= 0) close(fd);
+        return;
+    }
+    int32_t request = 0, length = 0;
+    char text[1024];
+    if (write_full(fd, &request, sizeof(request)) == 0 && read_full(fd, &length, sizeof(length)) == 0 &&
+        length > 0 && length < (int32_t)sizeof(text) && read_full(fd, text, length) == 0) {
+        text[length] = '\0';
+        printf("Server statistics: %s\n", text);
+    }
+    close(fd);
+}
+
+static int parse_client_arguments(int argc, char *argv[], ClientConfig *config) {
+    config->socket_path = NULL;
+    config->port = 0;
+    config->connections = 4;
+    config->requests = 1000;
+    config->rows = 1;
+    config->seed = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printf("Missing value for %s.\n", argv[i]);
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (strcmp(argv[i - 1], "--socket") == 0) config->socket_path = value;
+        else if (strcmp(argv[i - 1], "--port") == 0) config->port = atoi(value);
+        else if (strcmp(argv[i - 1], "--connections") == 0) config->connections = atoi(value);
+        else if (strcmp(argv[i - 1], "--requests") == 0) config->requests = atoi(value);
+        else if (strcmp(argv[i - 1], "--rows") == 0) config->rows = atoi(value);
+        else if (strcmp(argv[i - 1], "--seed") == 0) config->seed = atoi(value);
+        else {
+            printf("Unknown option %s.\n", argv[i - 1]);
+            return 1;
+        }
+    }
+
+    if ((config->socket_path == NULL) == (config->port == 0)) {
+        printf("Exactly one of --socket and --port is required.\n");
+        return 1;
+    }
+    if (config->port < 0 || config->port > 65535 || config->connections < 1 || config->requests < 1 ||
+        config->rows < 1) {
+        printf("Invalid client settings.\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    ClientConfig config;
+    if (parse_client_arguments(argc, argv, &config) != 0) {
+        return 1;
+    }
+
+    Worker *workers = (Worker *)checked_malloc(config.connections * sizeof(Worker));
+    pthread_t *threads = (pthread_t *)checked_malloc(config.connections * sizeof(pthread_t));
+    double start = now_us();
+    for (int c = 0; c < config.connections; c++) {
+        workers[c].config = &config;
+        workers[c].index = c;
+        workers[c].latencies = (double *)checked_malloc(config.requests * sizeof(double));
+        workers[c].failed = 0;
+        pthread_create(&threads[c], NULL, worker_main, &workers[c]);
+    }
+    for (int c = 0; c < config.connections; c++) {
+        pthread_join(threads[c], NULL);
+    }
+    double elapsed = (now_us() - start) / 1e6;
+
+    int total = config.connections * config.requests, failed = 0;
+    double *all = (double *)checked_malloc(total * sizeof(double));
+    for (int c = 0; c < config.connections; c++) {
+        failed |= workers[c].failed;
+        memcpy(all + (size_t)c * config.requests, workers[c].latencies, config.requests * sizeof(double));
+        free(workers[c].latencies);
+    }
+    if (failed) {
+        fprintf(stderr, "Client: A connection failed or received an invalid answer\n");
+    } else {
+        qsort(all, total, sizeof(double), compare_doubles);
+        printf("Client: %d requests of %d rows over %d connections in %.3f s\n", total, config.rows,
+               config.connections, elapsed);
+        printf("Client: %.1f requests/s, %.1f rows/s\n", total / elapsed, (double)total * config.rows / elapsed);
+        printf("Client: latency us p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n", percentile(all, total, 0.5),
+               percentile(all, total, 0.9), percentile(all, total, 0.99), all[total - 1]);
+        print_server_stats(&config);
+    }
+    free(all);
+    free(workers);
+    free(threads);
+    return failed;
+}
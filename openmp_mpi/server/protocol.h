@@ -0,0 +1,63 @@
+/**
+ * @file protocol.h
+ * @brief Wire protocol between forest_server and its clients.
+ *
+ * All integers and floats are sent in the host byte order, since the server only listens
+ * on a Unix domain socket or on the loopback interface.
+ *
+ * On connect the server sends a ServerHello. Each request is then an int32 row count
+ * followed by rows x num_features floats, and the server answers with the same int32 row
+ * count followed by one int32 class per row. A request with 0 rows asks for the server
+ * statistics instead, answered as an int32 length followed by that many bytes of JSON.
+ * A negative or oversized row count closes the connection.
+ */
+#ifndef FOREST_PROTOCOL_H
+#define FOREST_PROTOCOL_H
+
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define SERVER_MAGIC 0x53524652  // "RFRS"
+
+/**
+ * @brief First message of every connection.
+ */
+typedef struct ServerHello {
+    int32_t magic;          /**< SERVER_MAGIC. */
+    int32_t num_features;   /**< Floats per row. */
+    int32_t num_classes;    /**< Classes of the model. */
+    int32_t max_rows;       /**< Largest row count accepted in one request. */
+} ServerHello;
+
+/**
+ * @brief Reads exactly size bytes, retrying on short reads. Returns 0 on success.
+ */
+static inline int read_full(int fd, void *buffer, size_t size) {
+    char *cursor = (char *)buffer;
+    while (size > 0) {
+        ssize_t got = read(fd, cursor, size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return -1;
+        cursor += got;
+        size -= (size_t)got;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes exactly size bytes, retrying on short writes. Returns 0 on success.
+ */
+static inline int write_full(int fd, const void *buffer, size_t size) {
+    const char *cursor = (const char *)buffer;
+    while (size > 0) {
+        ssize_t put = write(fd, cursor, size);
+        if (put < 0 && errno == EINTR) continue;
+        if (put <= 0) return -1;
+        cursor += put;
+        size -= (size_t)put;
+    }
+    return 0;
+}
+
+#endif // FOREST_PROTOCOL_H
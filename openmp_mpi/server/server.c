@@ -0,0 +1,541 @@
+/**
+ * @file server.c
+ * @brief Long-running inference server: loads a forest once and scores rows sent over a socket.
+ *
+ * Every connection is served by its own thread, which reads a request, queues it and waits
+ * for its predictions. A single batcher thread coalesces the queued requests into a
+ * micro-batch, closed when it reaches --max_batch rows or when the oldest request has
+ * waited --batch_timeout_us, and scores it with rf_predict() on --n_threads OpenMP threads.
+ *
+ * The server keeps the latency of the last requests (from the end of the read to the
+ * predictions being ready) and reports p50/p90/p99, throughput and batch sizes every
+ * --stats_interval seconds, on request (0-row requests, see protocol.h) and on exit.
+ *
+ * Usage: ./server/forest_server (--model path | --trained_forest_path dir --num_features N --num_classes N)
+ *                               (--socket path | --port N) [--n_threads N] [--max_batch N]
+ *                               [--batch_timeout_us N] [--max_request_rows N] [--stats_interval N]
+ *                               [--early_exit 0|1]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "protocol.h"
+#include "../lib/libforest.h"
+
+#define LATENCY_WINDOW 65536  // Requests kept for the latency percentiles
+
+/**
+ * @brief Command-line settings of the server.
+ */
+typedef struct ServerConfig {
+    const char *model_path;    /**< Model written by rf_save(). */
+    const char *forest_path;   /**< Forest directory written by ./final. */
+    int num_features;          /**< Features of forest_path. */
+    int num_classes;           /**< Classes of forest_path. */
+    const char *socket_path;   /**< Unix domain socket to listen on. */
+    int port;                  /**< Loopback TCP port to listen on, when there is no socket_path. */
+    int threads;               /**< OpenMP threads of the inference kernel. */
+    int early_exit;            /**< Stop scoring a row once its vote is decided. */
+    int max_batch;             /**< Rows that close a micro-batch. */
+    int batch_timeout_us;      /**< Longest wait of a queued request before its batch is closed. */
+    int max_request_rows;      /**< Largest request accepted. */
+    int stats_interval;        /**< Seconds between statistics lines, 0 to print them only on exit. */
+} ServerConfig;
+
+/**
+ * @brief A queued request, owned by the connection thread that waits for it.
+ */
+typedef struct Request {
+    const float *rows;
+    int num_rows;
+    int *predictions;
+    double arrival_us;
+    int done;
+    pthread_cond_t ready;
+    struct Request *next;
+} Request;
+
+/**
+ * @brief State shared by the connection threads and the batcher.
+ */
+typedef struct Server {
+    ServerConfig config;
+    RFModel *model;
+    int num_features;
+    int num_classes;
+
+    pthread_mutex_t lock;
+    pthread_cond_t queued;        /**< Signaled when a request is queued. */
+    Request *head, *tail;
+    int queued_rows;
+
+    // Statistics, protected by lock
+    double start_us;
+    long long requests;
+    long long rows;
+    long long batches;
+    double busy_us;               /**< Time spent scoring batches. */
+    double *latencies;            /**< Ring of the last LATENCY_WINDOW latencies (us). */
+    long long latency_count;
+} Server;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop(int signal_number) {
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void *checked_malloc(size_t bytes) {
+    void *ptr = malloc(bytes > 0 ? bytes : 1);
+    if (ptr == NULL) {
+        fprintf(stderr, "Server: Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int count, double p) {
+    int index = (int)(p * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+/* ---- statistics ---- */
+
+/**
+ * @brief Formats the statistics as JSON into buffer. Returns the length of the text.
+ */
+static int format_stats(Server *server, char *buffer, size_t size) {
+    pthread_mutex_lock(&server->lock);
+    int count = server->latency_count < LATENCY_WINDOW ? (int)server->latency_count : LATENCY_WINDOW;
+    double *sorted = (double *)checked_malloc(count * sizeof(double));
+    memcpy(sorted, server->latencies, count * sizeof(double));
+    long long requests = server->requests, rows = server->rows, batches = server->batches;
+    double busy_us = server->busy_us;
+    double elapsed = (now_us() - server->start_us) / 1e6;
+    pthread_mutex_unlock(&server->lock);
+
+    qsort(sorted, count, sizeof(double), compare_doubles);
+    double p50 = count > 0 ? percentile(sorted, count, 0.5) : 0;
+    double p90 = count > 0 ? percentile(sorted, count, 0.9) : 0;
+    double p99 = count > 0 ? percentile(sorted, count, 0.99) : 0;
+    double max = count > 0 ? sorted[count - 1] : 0;
+    free(sorted);
+
+    return snprintf(buffer, size,
+                    "{\"uptime_s\": %.3f, \"requests\": %lld, \"rows\": %lld, \"batches\": %lld, "
+                    "\"mean_batch_rows\": %.2f, \"requests_per_s\": %.1f, \"rows_per_s\": %.1f, "
+                    "\"busy_fraction\": %.3f, \"latency_us\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}}",
+                    elapsed, requests, rows, batches, batches > 0 ? (double)rows / batches : 0,
+                    elapsed > 0 ? requests / elapsed : 0, elapsed > 0 ? rows / elapsed : 0,
+                    elapsed > 0 ? busy_us / 1e6 / elapsed : 0, p50, p90, p99, max);
+}
+
+static void print_stats(Server *server) {
+    char text[512];
+    format_stats(server, text, sizeof(text));
+    printf("Server: %s\n", text);
+    fflush(stdout);
+}
+
+/* ---- batching ---- */
+
+// Scores the requests of a batch; one request is scored in place, several are copied together
+static void score_batch(Server *server, Request *first, int num_requests, int batch_rows, float **batch,
+                        int **batch_predictions, int *batch_capacity) {
+    if (num_requests == 1) {
+        rf_predict(server->model, first->rows, first->num_rows, first->predictions);
+        return;
+    }
+    if (batch_rows > *batch_capacity) {
+        free(*batch);
+        free(*batch_predictions);
+        *batch = (float *)checked_malloc((size_t)batch_rows * server->num_features * sizeof(float));
+        *batch_predictions = (int *)checked_malloc((size_t)batch_rows * sizeof(int));
+        *batch_capacity = batch_rows;
+    }
+    int offset = 0;
+    Request *request = first;
+    for (int r = 0; r < num_requests; r++, request = request->next) {
+        memcpy(*batch + (size_t)offset * server->num_features, request->rows,
+               (size_t)request->num_rows * server->num_features * sizeof(float));
+        offset += request->num_rows;
+    }
+    rf_predict(server->model, *batch, batch_rows, *batch_predictions);
+    offset = 0;
+    request = first;
+    for (int r = 0; r < num_requests; r++, request = request->next) {
+        memcpy(request->predictions, *batch_predictions + offset, (size_t)request->num_rows * sizeof(int));
+        offset += request->num_rows;
+    }
+}
+
+static void *batcher_main(void *arg) {
+    Server *server = (Server *)arg;
+    float *batch = NULL;
+    int *batch_predictions = NULL;
+    int batch_capacity = 0;
+
+    pthread_mutex_lock(&server->lock);
+    for (;;) {
+        while (server->head == NULL) {
+            pthread_cond_wait(&server->queued, &server->lock);
+        }
+
+        // Wait for a full batch, but no longer than the timeout of the oldest request
+        double deadline = server->head->arrival_us + server->config.batch_timeout_us;
+        while (server->queued_rows < server->config.max_batch && now_us() < deadline) {
+            struct timespec until;
+            double wake_us = deadline;
+            until.tv_sec = (time_t)(wake_us / 1e6);
+            until.tv_nsec = (long)((wake_us - until.tv_sec * 1e6) * 1e3);
+            pthread_cond_timedwait(&server->queued, &server->lock, &until);
+        }
+
+        // Take whole requests up to max_batch rows; an oversized request forms its own batch
+        Request *first = server->head, *last = first;
+        int num_requests = 1, batch_rows = first->num_rows;
+        while (last->next != NULL && batch_rows + last->next->num_rows <= server->config.max_batch) {
+            last = last->next;
+            batch_rows += last->num_rows;
+            num_requests++;
+        }
+        server->head = last->next;
+        if (server->head == NULL) {
+            server->tail = NULL;
+        }
+        server->queued_rows -= batch_rows;
+        pthread_mutex_unlock(&server->lock);
+
+        double start = now_us();
+        score_batch(server, first, num_requests, batch_rows, &batch, &batch_predictions, &batch_capacity);
+        double end = now_us();
+
+        pthread_mutex_lock(&server->lock);
+        server->batches++;
+        server->busy_us += end - start;
+        Request *request = first;
+        for (int r = 0; r < num_requests; r++) {
+            Request *next = request->next;  // The request is gone once its owner wakes up
+            server->latencies[server->latency_count % LATENCY_WINDOW] = end - request->arrival_us;
+            server->latency_count++;
+            server->requests++;
+            server->rows += request->num_rows;
+            request->done = 1;
+            pthread_cond_signal(&request->ready);
+            request = next;
+        }
+    }
+    return NULL;
+}
+
+/* ---- connections ---- */
+
+typedef struct Connection {
+    Server *server;
+    int fd;
+} Connection;
+
+static void *connection_main(void *arg) {
+    Connection *connection = (Connection *)arg;
+    Server *server = connection->server;
+    int fd = connection->fd;
+    free(connection);
+
+    ServerHello hello = {SERVER_MAGIC, server->num_features, server->num_classes, server->config.max_request_rows};
+    float *rows = NULL;
+    int *predictions = NULL;
+    int capacity = 0;
+
+    if (write_full(fd, &hello, sizeof(hello)) == 0) {
+        int32_t num_rows;
+        while (read_full(fd, &num_rows, sizeof(num_rows)) == 0) {
+            if (num_rows == 0) {
+                char text[512];
+                int32_t length = format_stats(server, text, sizeof(text));
+                if (write_full(fd, &length, sizeof(length)) != 0 || write_full(fd, text, length) != 0) {
+                    break;
+                }
+                continue;
+            }
+            if (num_rows < 0 || num_rows > server->config.max_request_rows) {
+                break;
+            }
+            if (num_rows > capacity) {
+                free(rows);
+                free(predictions);
+                rows = (float *)checked_malloc((size_t)num_rows * server->num_features * sizeof(float));
+                predictions = (int *)checked_malloc((size_t)num_rows * sizeof(int));
+                capacity = num_rows;
+            }
+            if (read_full(fd, rows, (size_t)num_rows * server->num_features * sizeof(float)) != 0) {
+                break;
+            }
+
+            Request request;
+            request.rows = rows;
+            request.num_rows = num_rows;
+            request.predictions = predictions;
+            request.done = 0;
+            request.next = NULL;
+            pthread_cond_init(&request.ready, NULL);
+
+            pthread_mutex_lock(&server->lock);
+            request.arrival_us = now_us();
+            if (server->tail != NULL) {
+                server->tail->next = &request;
+            } else {
+                server->head = &request;
+            }
+            server->tail = &request;
+            server->queued_rows += num_rows;
+            pthread_cond_signal(&server->queued);
+            while (!request.done) {
+                pthread_cond_wait(&request.ready, &server->lock);
+            }
+            pthread_mutex_unlock(&server->lock);
+            pthread_cond_destroy(&request.ready);
+
+            if (write_full(fd, &num_rows, sizeof(num_rows)) != 0 ||
+                write_full(fd, predictions, (size_t)num_rows * sizeof(int)) != 0) {
+                break;
+            }
+        }
+    }
+    close(fd);
+    free(rows);
+    free(predictions);
+    return NULL;
+}
+
+/* ---- setup ---- */
+
+static int parse_server_arguments(int argc, char *argv[], ServerConfig *config) {
+    config->model_path = NULL;
+    config->forest_path = NULL;
+    config->num_features = 0;
+    config->num_classes = 0;
+    config->socket_path = NULL;
+    config->port = 0;
+    config->threads = 1;
+    config->early_exit = 0;
+    config->max_batch = 256;
+    config->batch_timeout_us = 200;
+    config->max_request_rows = 1 << 20;
+    config->stats_interval = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printf("Missing value for %s.\n", argv[i]);
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (strcmp(argv[i - 1], "--model") == 0) config->model_path = value;
+        else if (strcmp(argv[i - 1], "--trained_forest_path") == 0) config->forest_path = value;
+        else if (strcmp(argv[i - 1], "--num_features") == 0) config->num_features = atoi(value);
+        else if (strcmp(argv[i - 1], "--num_classes") == 0) config->num_classes = atoi(value);
+        else if (strcmp(argv[i - 1], "--socket") == 0) config->socket_path = value;
+        else if (strcmp(argv[i - 1], "--port") == 0) config->port = atoi(value);
+        else if (strcmp(argv[i - 1], "--n_threads") == 0) config->threads = atoi(value);
+        else if (strcmp(argv[i - 1], "--early_exit") == 0) config->early_exit = atoi(value);
+        else if (strcmp(argv[i - 1], "--max_batch") == 0) config->max_batch = atoi(value);
+        else if (strcmp(argv[i - 1], "--batch_timeout_us") == 0) config->batch_timeout_us = atoi(value);
+        else if (strcmp(argv[i - 1], "--max_request_rows") == 0) config->max_request_rows = atoi(value);
+        else if (strcmp(argv[i - 1], "--stats_interval") == 0) config->stats_interval = atoi(value);
+        else {
+            printf("Unknown option %s.\n", argv[i - 1]);
+            return 1;
+        }
+    }
+
+    if ((config->model_path == NULL) == (config->forest_path == NULL)) {
+        printf("Exactly one of --model and --trained_forest_path is required.\n");
+        return 1;
+    }
+    if (config->forest_path != NULL && (config->num_features < 1 || config->num_classes < 2)) {
+        printf("--trained_forest_path requires --num_features and --num_classes.\n");
+        return 1;
+    }
+    if ((config->socket_path == NULL) == (config->port == 0)) {
+        printf("Exactly one of --socket and --port is required.\n");
+        return 1;
+    }
+    if (config->port < 0 || config->port > 65535 || config->threads < 1 || config->max_batch < 1 ||
+        config->batch_timeout_us < 0 || config->max_request_rows < 1 || config->stats_interval < 0) {
+        printf("Invalid server settings.\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int open_listener(const ServerConfig *config) {
+    int fd;
+    if (config->socket_path != NULL) {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (strlen(config->socket_path) >= sizeof(address.sun_path)) {
+            fprintf(stderr, "Server: Socket path %s is too long\n", config->socket_path);
+            return -1;
+        }
+        strcpy(address.sun_path, config->socket_path);
+        unlink(config->socket_path);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            perror("Server: Failed to bind the socket");
+            return -1;
+        }
+    } else {
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t)config->port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int reuse = 1;
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        }
+        if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            perror("Server: Failed to bind the port");
+            return -1;
+        }
+    }
+    if (listen(fd, 128) != 0) {
+        perror("Server: Failed to listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static RFModel *load_model(const ServerConfig *config) {
+    RFModel *model = NULL;
+    int status = config->model_path != NULL
+                     ? rf_load(config->model_path, &model)
+                     : rf_load_forest_dir(config->forest_path, config->num_features, config->num_classes, &model);
+    if (status != RF_OK) {
+        fprintf(stderr, "Server: Failed to load the model: %s\n", rf_error_string(status));
+        return NULL;
+    }
+    rf_set_num_threads(model, config->threads);
+    rf_set_early_exit(model, config->early_exit);
+    return model;
+}
+
+int main(int argc, char *argv[]) {
+    Server server;
+    memset(&server, 0, sizeof(server));
+    if (parse_server_arguments(argc, argv, &server.config) != 0) {
+        return 1;
+    }
+    server.model = load_model(&server.config);
+    if (server.model == NULL) {
+        return 1;
+    }
+    server.num_features = rf_num_features(server.model);
+    server.num_classes = rf_num_classes(server.model);
+    server.latencies = (double *)checked_malloc(LATENCY_WINDOW * sizeof(double));
+
+    // The batcher waits on absolute monotonic deadlines
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&server.queued, &attributes);
+    pthread_condattr_destroy(&attributes);
+    pthread_mutex_init(&server.lock, NULL);
+
+    int listener = open_listener(&server.config);
+    if (listener < 0) {
+        rf_free(server.model);
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);  // A client hanging up must not kill the server
+
+    server.start_us = now_us();
+    pthread_t batcher;
+    if (pthread_create(&batcher, NULL, batcher_main, &server) != 0) {
+        fprintf(stderr, "Server: Failed to start the batcher\n");
+        return 1;
+    }
+    pthread_detach(batcher);
+
+    if (server.config.socket_path != NULL) {
+        printf("Server: %d trees, %d features, %d classes, listening on %s\n", rf_num_trees(server.model),
+               server.num_features, server.num_classes, server.config.socket_path);
+    } else {
+        printf("Server: %d trees, %d features, %d classes, listening on 127.0.0.1:%d\n", rf_num_trees(server.model),
+               server.num_features, server.num_classes, server.config.port);
+    }
+    fflush(stdout);
+
+    double next_stats = server.start_us + server.config.stats_interval * 1e6;
+    while (!stop_requested) {
+        // Wake up regularly to notice a stop request and print the periodic statistics
+        struct pollfd waiting = {listener, POLLIN, 0};
+        int ready = poll(&waiting, 1, 200);
+        if (server.config.stats_interval > 0 && now_us() >= next_stats) {
+            print_stats(&server);
+            next_stats += server.config.stats_interval * 1e6;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        if (server.config.socket_path == NULL) {
+            int no_delay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        }
+        Connection *connection = (Connection *)checked_malloc(sizeof(Connection));
+        connection->server = &server;
+        connection->fd = fd;
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, connection_main, connection) != 0) {
+            fprintf(stderr, "Server: Failed to start a connection thread\n");
+            close(fd);
+            free(connection);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    // Open connections are dropped with the process; the model is never freed under the batcher
+    print_stats(&server);
+    close(listener);
+    if (server.config.socket_path != NULL) {
+        unlink(server.config.socket_path);
+    }
+    return 0;
+}
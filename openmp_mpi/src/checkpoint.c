@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <mpi.h>
+
+#include "../headers/checkpoint.h"
+#include "../headers/tree/memory_ser.h"
+
+/**
+ * @brief Header of one tree record, followed by size bytes of serialized tree.
+ */
+typedef struct CheckpointRecord {
+    int magic;
+    int tree_id;
+    int size;
+    uint32_t checksum;
+} CheckpointRecord;
+
+// FNV-1a over the serialized tree, to reject records cut by a crash
+static uint32_t record_checksum(const uint8_t *data, int size) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Reads the records of an existing checkpoint on process 0 and returns the offset after the
+// last valid one
+static long long load_records(Checkpoint *checkpoint, long long file_size, int num_trees, int *finished,
+                             Tree *trees, int *num_finished) {
+    long long offset = sizeof(CheckpointHeader);
+    CheckpointRecord record;
+
+    while (offset + (long long)sizeof(CheckpointRecord) <= file_size) {
+        MPI_File_read_at(checkpoint->file, offset, &record, sizeof(CheckpointRecord), MPI_BYTE, MPI_STATUS_IGNORE);
+        if (record.magic != CHECKPOINT_RECORD_MAGIC || record.size <= 0 ||
+            offset + (long long)sizeof(CheckpointRecord) + record.size > file_size) {
+            break;
+        }
+
+        uint8_t *payload = (uint8_t *)malloc(record.size);
+        if (!payload) {
+            fprintf(stderr, "Process 0: Failed to allocate memory for checkpoint record\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        MPI_File_read_at(checkpoint->file, offset + sizeof(CheckpointRecord), payload, record.size, MPI_BYTE, MPI_STATUS_IGNORE);
+        if (record_checksum(payload, record.size) != record.checksum) {
+            free(payload);
+            break;
+        }
+
+        // Trees beyond the current forest size are kept in the file but not used
+        if (record.tree_id >= 0 && record.tree_id < num_trees && !finished[record.tree_id]) {
+            if (deserialize_tree_from_buffer(payload, record.size, &trees[record.tree_id]) != 0) {
+                fprintf(stderr, "Process 0: Malformed tree %d in checkpoint\n", record.tree_id);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            finished[record.tree_id] = 1;
+            (*num_finished)++;
+        }
+        free(payload);
+        offset += sizeof(CheckpointRecord) + record.size;
+    }
+
+    if (offset < file_size) {
+        printf("Process 0: Dropping %lld bytes of incomplete checkpoint records\n", file_size - offset);
+    }
+    return offset;
+}
+
+void checkpoint_open(Checkpoint *checkpoint, const char *path, int resume, const CheckpointHeader *header,
+                     int num_trees, int *finished, Tree **finished_trees, int *num_finished) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    checkpoint->pending = 0;
+    checkpoint->record = NULL;
+    *finished_trees = NULL;
+    memset(finished, 0, num_trees * sizeof(int));
+    *num_finished = 0;
+
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDWR | MPI_MODE_CREATE, MPI_INFO_NULL,
+                      &checkpoint->file) != MPI_SUCCESS) {
+        fprintf(stderr, "Process %d: Failed to open checkpoint %s\n", rank, path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    long long end = sizeof(CheckpointHeader);
+    if (rank == 0) {
+        MPI_Offset file_size = 0;
+        MPI_File_get_size(checkpoint->file, &file_size);
+
+        if (resume && file_size > 0) {
+            CheckpointHeader stored;
+            memset(&stored, 0, sizeof(stored));
+            if (file_size >= (MPI_Offset)sizeof(CheckpointHeader)) {
+                MPI_File_read_at(checkpoint->file, 0, &stored, sizeof(CheckpointHeader), MPI_BYTE, MPI_STATUS_IGNORE);
+            }
+            if (memcmp(&stored, header, sizeof(CheckpointHeader)) != 0) {
+                fprintf(stderr, "Process 0: Checkpoint %s was written with different data or parameters\n", path);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+
+            *finished_trees = (Tree *)malloc(num_trees * sizeof(Tree));
+            if (!*finished_trees) {
+                fprintf(stderr, "Process 0: Failed to allocate memory for checkpointed trees\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            for (int t = 0; t < num_trees; t++) {
+                (*finished_trees)[t].nodes = NULL;
+                (*finished_trees)[t].stats = NULL;
+                (*finished_trees)[t].num_nodes = 0;
+            }
+            end = load_records(checkpoint, file_size, num_trees, finished, *finished_trees, num_finished);
+
+            printf("Process 0: Resuming from %s - %d/%d trees already trained\n", path, *num_finished, num_trees);
+            fflush(stdout);
+        } else {
+            if (resume) {
+                printf("Process 0: No checkpoint found at %s, starting from scratch\n", path);
+                fflush(stdout);
+            }
+            MPI_File_write_at(checkpoint->file, 0, (void *)header, sizeof(CheckpointHeader), MPI_BYTE, MPI_STATUS_IGNORE);
+        }
+    }
+
+    MPI_Bcast(&end, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    MPI_Bcast(finished, num_trees, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(num_finished, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    // Drop stale or incomplete records, new ones are appended from here
+    MPI_File_set_size(checkpoint->file, (MPI_Offset)end);
+
+    MPI_Aint bytes = (rank == 0) ? sizeof(long long) : 0;
+    MPI_Win_allocate(bytes, sizeof(long long), MPI_INFO_NULL, MPI_COMM_WORLD, &checkpoint->next_offset,
+                     &checkpoint->offset_win);
+    if (rank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, checkpoint->offset_win);
+        *checkpoint->next_offset = end;
+        MPI_Win_unlock(0, checkpoint->offset_win);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Win_lock_all(0, checkpoint->offset_win);
+}
+
+// Waits for the outstanding write of this process and releases its buffer
+static void checkpoint_wait(Checkpoint *checkpoint) {
+    if (!checkpoint->pending) {
+        return;
+    }
+    MPI_Wait(&checkpoint->request, MPI_STATUS_IGNORE);
+    free(checkpoint->record);
+    checkpoint->record = NULL;
+    checkpoint->pending = 0;
+}
+
+void checkpoint_write_tree(Checkpoint *checkpoint, Tree *tree, int tree_id) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    checkpoint_wait(checkpoint);
+
+    void *payload = NULL;
+    int size = 0;
+    serialize_tree_to_buffer(tree, 1, &payload, &size);
+
+    long long record_bytes = sizeof(CheckpointRecord) + size;
+    uint8_t *record = (uint8_t *)malloc(record_bytes);
+    if (!record) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for checkpoint record\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    CheckpointRecord header = {CHECKPOINT_RECORD_MAGIC, tree_id, size, record_checksum((uint8_t *)payload, size)};
+    memcpy(record, &header, sizeof(CheckpointRecord));
+    memcpy(record + sizeof(CheckpointRecord), payload, size);
+    free(payload);
+
+    // Reserve space at the end of the file, then write without waiting
+    long long offset;
+    MPI_Fetch_and_op(&record_bytes, &offset, MPI_LONG_LONG, 0, 0, MPI_SUM, checkpoint->offset_win);
+    MPI_Win_flush(0, checkpoint->offset_win);
+
+    MPI_File_iwrite_at(checkpoint->file, (MPI_Offset)offset, record, (int)record_bytes, MPI_BYTE, &checkpoint->request);
+    checkpoint->record = record;
+    checkpoint->pending = 1;
+}
+
+void checkpoint_close(Checkpoint *checkpoint) {
+    checkpoint_wait(checkpoint);
+    MPI_Win_unlock_all(checkpoint->offset_win);
+    MPI_Win_free(&checkpoint->offset_win);
+    MPI_File_close(&checkpoint->file);
+}
@@ -0,0 +1,664 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <mpi.h>
+
+#include "../headers/data_parallel.h"
+#include "../headers/utils.h"
+#include "../headers/tree/tree.h"
+#include "../headers/tree/train_utils.h"
+#include "../headers/tree/profile.h"
+#include "../headers/tree/counters.h"
+#include "../headers/tree/numa.h"
+#include "../headers/tree/sketch.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**
+ * @brief State shared by all the nodes of a data-parallel tree.
+ */
+typedef struct DataParallelContext {
+    float *data;                /**< Local block of training rows. */
+    const NumaReplicas *replicas; /**< Per-NUMA-node copies of data read by the histogram threads, NULL if none. */
+    int num_columns;            /**< Number of columns (features + label). */
+    int num_classes;            /**< Number of classes. */
+    int max_depth;              /**< Maximum depth of the tree. */
+    int min_samples_split;      /**< Minimum number of global samples to split a node. */
+    int num_selected_features;  /**< Features evaluated at each node. */
+    int num_bins;               /**< Histogram bins per feature. */
+    int splitter;               /**< SPLITTER_BEST (uniform histograms), SPLITTER_RANDOM or SPLITTER_APPROX. */
+    int num_threads;            /**< Threads used to build the local histograms. */
+    float *feature_min;         /**< Global minimum of each feature over the tree sample. */
+    float *bin_width;           /**< Width of the bins of each feature (0 for constant features). */
+    int *selected_features;     /**< Feature indices, shuffled at each node. */
+    unsigned int rng;           /**< Random stream of the feature draws, identical on every process. */
+    int *local_hist;            /**< selected features x bins x classes counts of this process. */
+    int *global_hist;           /**< Same counts summed over all processes. */
+    float *node_range;          /**< Ranges and thresholds of the selected features (SPLITTER_RANDOM). */
+    QuantileSketch *sketches;   /**< Local sketch of each selected feature (SPLITTER_APPROX). */
+    QuantileSketch *merged;     /**< Same sketches merged over all processes (SPLITTER_APPROX). */
+    float *cuts;                /**< num_bins - 1 cut points per selected feature (SPLITTER_APPROX). */
+    int *num_cuts;              /**< Cut points found for each selected feature (SPLITTER_APPROX). */
+} DataParallelContext;
+
+void scatter_rows(float *data, int num_rows, int num_columns, float **local_data, int *local_rows, int *first_row) {
+    int rank, process_number;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+
+    int *row_counts = (int *)malloc(process_number * sizeof(int));
+    int *row_displs = (int *)malloc(process_number * sizeof(int));
+    int *counts = (int *)malloc(process_number * sizeof(int));
+    int *displs = (int *)malloc(process_number * sizeof(int));
+    if (!row_counts || !row_displs || !counts || !displs) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for row distribution\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    distribute_trees(num_rows, process_number, row_counts, row_displs);
+    for (int p = 0; p < process_number; p++) {
+        counts[p] = row_counts[p] * num_columns;
+        displs[p] = row_displs[p] * num_columns;
+    }
+
+    *local_rows = row_counts[rank];
+    *first_row = row_displs[rank];
+    *local_data = (float *)numa_alloc(((size_t)counts[rank] > 0 ? (size_t)counts[rank] : 1) * sizeof(float));
+    if (!*local_data) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for local rows\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    MPI_Scatterv(data, counts, displs, MPI_FLOAT, *local_data, counts[rank], MPI_FLOAT, 0, MPI_COMM_WORLD);
+
+    free(row_counts);
+    free(row_displs);
+    free(counts);
+    free(displs);
+}
+
+// Upper edge of a bin, which is also the threshold stored when the split falls after it
+static inline float bin_edge(const DataParallelContext *ctx, int feature, int bin) {
+    return ctx->feature_min[feature] + (bin + 1) * ctx->bin_width[feature];
+}
+
+// A value lands in the first bin whose upper edge is not below it, so that rows on an edge
+// are counted on the side the stored threshold sends them to (value <= threshold goes left)
+static inline int feature_bin(const DataParallelContext *ctx, int feature, float value) {
+    int bin = (int)((value - ctx->feature_min[feature]) / ctx->bin_width[feature]);
+    if (bin < 0) {
+        bin = 0;
+    } else if (bin >= ctx->num_bins) {
+        bin = ctx->num_bins - 1;
+    }
+    // The division may round across an edge: settle on the edges themselves
+    while (bin > 0 && value <= bin_edge(ctx, feature, bin - 1)) {
+        bin--;
+    }
+    while (bin < ctx->num_bins - 1 && value > bin_edge(ctx, feature, bin)) {
+        bin++;
+    }
+    return bin;
+}
+
+// Histogram search: sweeps the bin edges of the selected features on the class histograms
+// combined over all processes. Returns the best entropy and fills the winning position in
+// the draw, its last left bin and the class counts of its left side.
+static float histogram_split_data_parallel(DataParallelContext *ctx, const Node *node, const int *indices,
+                                           int local_rows, const int *class_counts, int *best_selected,
+                                           int *best_bin, int *left_counts, int *left_size) {
+    int num_classes = ctx->num_classes;
+    int num_bins = ctx->num_bins;
+    int target_column = ctx->num_columns - 1;
+    int num_selected = ctx->num_selected_features;
+
+    // Local class histograms of the selected features
+    size_t hist_size = (size_t)num_selected * num_bins * num_classes;
+    memset(ctx->local_hist, 0, hist_size * sizeof(int));
+
+    #pragma omp parallel for num_threads(ctx->num_threads)
+    for (int s = 0; s < num_selected; s++) {
+        int feature = ctx->selected_features[s];
+        if (ctx->bin_width[feature] <= 0) {
+            continue;
+        }
+        int *feature_hist = ctx->local_hist + (size_t)s * num_bins * num_classes;
+        const float *data = ctx->replicas ? numa_replica_local(ctx->replicas) : ctx->data;
+        for (int i = 0; i < local_rows; i++) {
+            const float *row = data + (size_t)indices[i] * ctx->num_columns;
+            int bin = feature_bin(ctx, feature, row[feature]);
+            feature_hist[bin * num_classes + (int)row[target_column]]++;
+        }
+    }
+
+    MPI_Allreduce(ctx->local_hist, ctx->global_hist, (int)hist_size, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    // Sweep the bin edges of every selected feature on the combined histograms
+    float best_entropy = INFINITY;
+    int right_counts[num_classes];
+    *best_selected = -1;
+    *best_bin = -1;
+
+    for (int s = 0; s < num_selected; s++) {
+        if (ctx->bin_width[ctx->selected_features[s]] <= 0) {
+            continue;
+        }
+        const int *feature_hist = ctx->global_hist + (size_t)s * num_bins * num_classes;
+        int sweep_size = 0;
+        memset(left_counts, 0, num_classes * sizeof(int));
+
+        for (int b = 0; b < num_bins - 1; b++) {
+            for (int c = 0; c < num_classes; c++) {
+                left_counts[c] += feature_hist[b * num_classes + c];
+                sweep_size += feature_hist[b * num_classes + c];
+            }
+            int right_size = node->num_samples - sweep_size;
+            COUNTER_ADD(COUNTER_CANDIDATES, 1);
+            if (sweep_size == 0) {
+                continue;
+            }
+            if (right_size == 0) {
+                break;
+            }
+            for (int c = 0; c < num_classes; c++) {
+                right_counts[c] = class_counts[c] - left_counts[c];
+            }
+
+            float entropy = get_entropy(left_counts, right_counts, sweep_size, right_size, num_classes);
+            COUNTER_ADD(COUNTER_ENTROPY_EVALS, 1);
+            if (entropy + EPSILON < best_entropy) {
+                best_entropy = entropy;
+                *best_selected = s;
+                *best_bin = b;
+            }
+        }
+    }
+
+    // Class counts of the left child, from the combined histogram of the winning feature
+    *left_size = 0;
+    memset(left_counts, 0, num_classes * sizeof(int));
+    if (*best_selected >= 0) {
+        const int *best_hist = ctx->global_hist + (size_t)*best_selected * num_bins * num_classes;
+        for (int b = 0; b <= *best_bin; b++) {
+            for (int c = 0; c < num_classes; c++) {
+                left_counts[c] += best_hist[b * num_classes + c];
+                *left_size += best_hist[b * num_classes + c];
+            }
+        }
+    }
+    return best_entropy;
+}
+
+// Random search (SPLITTER_RANDOM): one threshold per selected feature, drawn between the
+// global min and max of the node rows. Two reductions per node, one for the ranges and one
+// for the left class counts. Returns the best entropy and fills the winning position in the
+// draw, its threshold and the class counts of its left side.
+static float random_split_data_parallel(DataParallelContext *ctx, const Node *node, const int *indices,
+                                        int local_rows, const int *class_counts, unsigned int split_seed,
+                                        int *best_selected, float *best_threshold, int *left_counts,
+                                        int *left_size) {
+    int num_classes = ctx->num_classes;
+    int target_column = ctx->num_columns - 1;
+    int num_selected = ctx->num_selected_features;
+    // [min, -max] of every selected feature, so both reduce with MPI_MIN
+    float *range = ctx->node_range;
+    float *threshold = ctx->node_range + 2 * num_selected;
+
+    #pragma omp parallel for num_threads(ctx->num_threads)
+    for (int s = 0; s < num_selected; s++) {
+        int feature = ctx->selected_features[s];
+        const float *data = ctx->replicas ? numa_replica_local(ctx->replicas) : ctx->data;
+        float min = FLT_MAX, max = -FLT_MAX;
+        for (int i = 0; i < local_rows; i++) {
+            float value = data[(size_t)indices[i] * ctx->num_columns + feature];
+            if (value < min) min = value;
+            if (value > max) max = value;
+        }
+        range[2 * s] = min;
+        range[2 * s + 1] = -max;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, range, 2 * num_selected, MPI_FLOAT, MPI_MIN, MPI_COMM_WORLD);
+
+    // Same thresholds on every process, placed as in get_random_split_num_var()
+    for (int s = 0; s < num_selected; s++) {
+        float min = range[2 * s], max = -range[2 * s + 1];
+        threshold[s] = min + random_split_unit(split_seed, ctx->selected_features[s]) * (max - min);
+        if (!(threshold[s] < max)) {
+            threshold[s] = min;
+        }
+    }
+
+    size_t counts_size = (size_t)num_selected * num_classes;
+    memset(ctx->local_hist, 0, counts_size * sizeof(int));
+    #pragma omp parallel for num_threads(ctx->num_threads)
+    for (int s = 0; s < num_selected; s++) {
+        if (!(range[2 * s] < -range[2 * s + 1])) {
+            continue;
+        }
+        int feature = ctx->selected_features[s];
+        int *feature_counts = ctx->local_hist + (size_t)s * num_classes;
+        const float *data = ctx->replicas ? numa_replica_local(ctx->replicas) : ctx->data;
+        for (int i = 0; i < local_rows; i++) {
+            const float *row = data + (size_t)indices[i] * ctx->num_columns;
+            if (row[feature] <= threshold[s]) {
+                feature_counts[(int)row[target_column]]++;
+            }
+        }
+    }
+    MPI_Allreduce(ctx->local_hist, ctx->global_hist, (int)counts_size, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    float best_entropy = INFINITY;
+    int right_counts[num_classes];
+    *best_selected = -1;
+    for (int s = 0; s < num_selected; s++) {
+        if (!(range[2 * s] < -range[2 * s + 1])) {
+            continue;
+        }
+        const int *feature_counts = ctx->global_hist + (size_t)s * num_classes;
+        int feature_left = 0;
+        for (int c = 0; c < num_classes; c++) {
+            feature_left += feature_counts[c];
+            right_counts[c] = class_counts[c] - feature_counts[c];
+        }
+        COUNTER_ADD(COUNTER_CANDIDATES, 1);
+        if (feature_left == 0 || feature_left == node->num_samples) {
+            continue;
+        }
+        float entropy = get_entropy((int *)feature_counts, right_counts, feature_left,
+                                    node->num_samples - feature_left, num_classes);
+        COUNTER_ADD(COUNTER_ENTROPY_EVALS, 1);
+        if (entropy + EPSILON < best_entropy) {
+            best_entropy = entropy;
+            *best_selected = s;
+        }
+    }
+
+    *left_size = 0;
+    memset(left_counts, 0, num_classes * sizeof(int));
+    if (*best_selected >= 0) {
+        const int *best_counts = ctx->global_hist + (size_t)*best_selected * num_classes;
+        for (int c = 0; c < num_classes; c++) {
+            left_counts[c] = best_counts[c];
+            *left_size += best_counts[c];
+        }
+        *best_threshold = threshold[*best_selected];
+    }
+    return best_entropy;
+}
+
+// Approximate search (SPLITTER_APPROX): every process sketches the selected features over its
+// node rows, all the sketches are gathered and merged in rank order, so every process derives
+// the same num_bins - 1 quantile cuts per feature, and the class histograms between the cuts
+// are combined as in the histogram search. Returns the best entropy and fills the winning
+// position in the draw, its cut and the class counts of its left side.
+static float approx_split_data_parallel(DataParallelContext *ctx, const Node *node, const int *indices,
+                                        int local_rows, const int *class_counts, int *best_selected,
+                                        float *best_threshold, int *left_counts, int *left_size) {
+    int rank, process_number;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+
+    int num_classes = ctx->num_classes;
+    int num_bins = ctx->num_bins;
+    int max_cuts = num_bins - 1;
+    int target_column = ctx->num_columns - 1;
+    int num_selected = ctx->num_selected_features;
+
+    int failed = 0;
+    #pragma omp parallel for num_threads(ctx->num_threads) reduction(|:failed)
+    for (int s = 0; s < num_selected; s++) {
+        int feature = ctx->selected_features[s];
+        const float *data = ctx->replicas ? numa_replica_local(ctx->replicas) : ctx->data;
+        sketch_reset(&ctx->sketches[s]);
+        for (int i = 0; i < local_rows; i++) {
+            failed |= sketch_add(&ctx->sketches[s], data[(size_t)indices[i] * ctx->num_columns + feature]) != 0;
+        }
+    }
+
+    size_t local_bytes = 0;
+    for (int s = 0; s < num_selected; s++) {
+        local_bytes += sketch_packed_size(&ctx->sketches[s]);
+    }
+    char *local_packed = (char *)malloc(local_bytes);
+    int *sizes = (int *)malloc(process_number * sizeof(int));
+    int *displs = (int *)malloc(process_number * sizeof(int));
+    COUNTER_ADD(COUNTER_MALLOCS, 3);
+    if (failed || !local_packed || !sizes || !displs) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for the split sketches\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    char *cursor = local_packed;
+    for (int s = 0; s < num_selected; s++) {
+        sketch_pack(&ctx->sketches[s], cursor);
+        cursor += sketch_packed_size(&ctx->sketches[s]);
+    }
+
+    int local_size = (int)local_bytes;
+    MPI_Allgather(&local_size, 1, MPI_INT, sizes, 1, MPI_INT, MPI_COMM_WORLD);
+    int total_size = 0;
+    for (int p = 0; p < process_number; p++) {
+        displs[p] = total_size;
+        total_size += sizes[p];
+    }
+    char *all_packed = (char *)malloc(total_size);
+    COUNTER_ADD(COUNTER_MALLOCS, 1);
+    if (!all_packed) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for the split sketches\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Allgatherv(local_packed, local_size, MPI_BYTE, all_packed, sizes, displs, MPI_BYTE, MPI_COMM_WORLD);
+
+    for (int s = 0; s < num_selected; s++) {
+        sketch_reset(&ctx->merged[s]);
+    }
+    for (int p = 0; p < process_number; p++) {
+        const char *packed = all_packed + displs[p];
+        for (int s = 0; s < num_selected; s++) {
+            size_t used = sketch_merge_packed(&ctx->merged[s], packed);
+            if (used == 0) {
+                fprintf(stderr, "Process %d: Failed to merge the split sketches\n", rank);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            packed += used;
+        }
+    }
+    for (int s = 0; s < num_selected; s++) {
+        ctx->num_cuts[s] = sketch_cuts(&ctx->merged[s], max_cuts, ctx->cuts + (size_t)s * max_cuts);
+        if (ctx->num_cuts[s] < 0) {
+            fprintf(stderr, "Process %d: Failed to allocate memory for the split cuts\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    free(local_packed);
+    free(all_packed);
+    free(sizes);
+    free(displs);
+
+    // Local class histograms between the cuts, combined over all processes
+    size_t hist_size = (size_t)num_selected * num_bins * num_classes;
+    memset(ctx->local_hist, 0, hist_size * sizeof(int));
+    #pragma omp parallel for num_threads(ctx->num_threads)
+    for (int s = 0; s < num_selected; s++) {
+        int feature = ctx->selected_features[s];
+        const float *cuts = ctx->cuts + (size_t)s * max_cuts;
+        int *feature_hist = ctx->local_hist + (size_t)s * num_bins * num_classes;
+        const float *data = ctx->replicas ? numa_replica_local(ctx->replicas) : ctx->data;
+        for (int i = 0; i < local_rows; i++) {
+            const float *row = data + (size_t)indices[i] * ctx->num_columns;
+            int bin = sketch_cut_bin(cuts, ctx->num_cuts[s], row[feature]);
+            feature_hist[bin * num_classes + (int)row[target_column]]++;
+        }
+    }
+    MPI_Allreduce(ctx->local_hist, ctx->global_hist, (int)hist_size, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    // Sweep the cuts of every selected feature
+    float best_entropy = INFINITY;
+    int best_cut = -1;
+    int right_counts[num_classes];
+    *best_selected = -1;
+    for (int s = 0; s < num_selected; s++) {
+        const int *feature_hist = ctx->global_hist + (size_t)s * num_bins * num_classes;
+        int sweep_size = 0;
+        memset(left_counts, 0, num_classes * sizeof(int));
+        for (int b = 0; b < ctx->num_cuts[s]; b++) {
+            for (int c = 0; c < num_classes; c++) {
+                left_counts[c] += feature_hist[b * num_classes + c];
+                sweep_size += feature_hist[b * num_classes + c];
+            }
+            int right_size = node->num_samples - sweep_size;
+            COUNTER_ADD(COUNTER_CANDIDATES, 1);
+            if (sweep_size == 0) {
+                continue;
+            }
+            if (right_size == 0) {
+                break;
+            }
+            for (int c = 0; c < num_classes; c++) {
+                right_counts[c] = class_counts[c] - left_counts[c];
+            }
+            float entropy = get_entropy(left_counts, right_counts, sweep_size, right_size, num_classes);
+            COUNTER_ADD(COUNTER_ENTROPY_EVALS, 1);
+            if (entropy + EPSILON < best_entropy) {
+                best_entropy = entropy;
+                *best_selected = s;
+                best_cut = b;
+            }
+        }
+    }
+
+    *left_size = 0;
+    memset(left_counts, 0, num_classes * sizeof(int));
+    if (*best_selected >= 0) {
+        const int *best_hist = ctx->global_hist + (size_t)*best_selected * num_bins * num_classes;
+        for (int b = 0; b <= best_cut; b++) {
+            for (int c = 0; c < num_classes; c++) {
+                left_counts[c] += best_hist[b * num_classes + c];
+                *left_size += best_hist[b * num_classes + c];
+            }
+        }
+        *best_threshold = ctx->cuts[(size_t)*best_selected * max_cuts + best_cut];
+    }
+    return best_entropy;
+}
+
+// Grows a node whose local rows are indices[0..local_rows). class_counts are the global
+// class counts of the node, identical on every process.
+static void grow_node_data_parallel(DataParallelContext *ctx, Node *node, int *indices, int local_rows,
+                                    const int *class_counts) {
+    int num_classes = ctx->num_classes;
+    int num_features = ctx->num_columns - 1;
+
+    profile_node(node->depth, node->num_samples);
+    if (node->num_samples < ctx->min_samples_split) {
+        COUNTER_ADD(COUNTER_LEAVES_MIN_SAMPLES, 1);
+        return;
+    }
+    if (node->depth >= ctx->max_depth) {
+        COUNTER_ADD(COUNTER_LEAVES_MAX_DEPTH, 1);
+        return;
+    }
+    float node_entropy = compute_entropy((int *)class_counts, node->num_samples, num_classes);
+
+    // Same draw on every process since the generator was seeded with the tree seed
+    for (int i = 0; i < num_features; i++) {
+        ctx->selected_features[i] = i;
+    }
+    shuffle(ctx->selected_features, num_features, &ctx->rng);
+
+    double search_start = profile_start();
+    float best_entropy;
+    int best_selected, best_bin = -1;
+    float best_threshold = 0.0f;
+    int left_size, right_size;
+    int left_counts[num_classes], right_counts[num_classes];
+    if (ctx->splitter == SPLITTER_RANDOM) {
+        unsigned int split_seed = (unsigned int)rng_next(&ctx->rng);
+        best_entropy = random_split_data_parallel(ctx, node, indices, local_rows, class_counts, split_seed,
+                                                  &best_selected, &best_threshold, left_counts, &left_size);
+    } else if (ctx->splitter == SPLITTER_APPROX) {
+        best_entropy = approx_split_data_parallel(ctx, node, indices, local_rows, class_counts,
+                                                  &best_selected, &best_threshold, left_counts, &left_size);
+    } else {
+        best_entropy = histogram_split_data_parallel(ctx, node, indices, local_rows, class_counts,
+                                                     &best_selected, &best_bin, left_counts, &left_size);
+    }
+    profile_step_end(STEP_SEARCH, search_start);
+
+    if (best_selected < 0 || best_entropy + EPSILON >= node_entropy) {
+        COUNTER_ADD(COUNTER_LEAVES_NO_GAIN, 1);
+        return;
+    }
+
+    int best_feature = ctx->selected_features[best_selected];
+    if (ctx->splitter == SPLITTER_BEST) {
+        best_threshold = bin_edge(ctx, best_feature, best_bin);
+    }
+    right_size = node->num_samples - left_size;
+    for (int c = 0; c < num_classes; c++) {
+        right_counts[c] = class_counts[c] - left_counts[c];
+    }
+
+    // Partition the local rows in place with the test of inference, which feature_bin() agrees with
+    double partition_start = profile_start();
+    int local_left = 0;
+    for (int i = 0; i < local_rows; i++) {
+        float value = ctx->data[(size_t)indices[i] * ctx->num_columns + best_feature];
+        if (value <= best_threshold) {
+            int tmp = indices[local_left];
+            indices[local_left] = indices[i];
+            indices[i] = tmp;
+            local_left++;
+        }
+    }
+    profile_step_end(STEP_PARTITION, partition_start);
+
+    node->feature = best_feature;
+    node->threshold = best_threshold;
+    node->entropy = best_entropy;
+    node->left = create_node(-1, -1, NULL, NULL, argmax(left_counts, num_classes),
+                             node->depth + 1, INFINITY, left_size);
+    node->right = create_node(-1, -1, NULL, NULL, argmax(right_counts, num_classes),
+                              node->depth + 1, INFINITY, right_size);
+
+    grow_node_data_parallel(ctx, node->left, indices, local_left, left_counts);
+    grow_node_data_parallel(ctx, node->right, indices + local_left, local_rows - local_left, right_counts);
+}
+
+void train_tree_data_parallel(Tree *tree, float *local_data, int local_rows, int num_columns, int num_classes,
+                              int max_depth, int min_samples_split, char *max_features, int splitter,
+                              float sample_proportion, int num_bins, int tree_seed, int num_threads,
+                              const NumaReplicas *replicas) {
+    int rank, process_number;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+
+    int num_features = num_columns - 1;
+    int target_column = num_columns - 1;
+
+    // Local bootstrap: a different draw on every process
+    double sample_start = profile_start();
+    int sample_rows = (int)(sample_proportion * local_rows);
+    int *indices = (int *)malloc((local_rows > 0 ? local_rows : 1) * sizeof(int));
+    if (!indices) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for sample indices\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int i = 0; i < local_rows; i++) {
+        indices[i] = i;
+    }
+    unsigned int sample_rng = (unsigned int)(tree_seed * process_number + rank);
+    shuffle(indices, local_rows, &sample_rng);
+    profile_phase_end(PHASE_SAMPLE, sample_start);
+
+    double grow_start = profile_start();
+
+    DataParallelContext ctx;
+    ctx.data = local_data;
+    ctx.replicas = replicas;
+    ctx.num_columns = num_columns;
+    ctx.num_classes = num_classes;
+    ctx.max_depth = max_depth;
+    ctx.min_samples_split = min_samples_split;
+    ctx.num_bins = num_bins;
+    ctx.splitter = splitter;
+    ctx.num_threads = num_threads;
+    ctx.num_selected_features = get_num_selected_features(max_features, num_features);
+    if (ctx.num_selected_features < 1) {
+        ctx.num_selected_features = 1;
+    } else if (ctx.num_selected_features > num_features) {
+        ctx.num_selected_features = num_features;
+    }
+
+    size_t hist_size = (size_t)ctx.num_selected_features * num_bins * num_classes;
+    ctx.feature_min = (float *)malloc(num_features * sizeof(float));
+    ctx.bin_width = (float *)malloc(num_features * sizeof(float));
+    ctx.selected_features = (int *)malloc(num_features * sizeof(int));
+    ctx.local_hist = (int *)malloc(hist_size * sizeof(int));
+    ctx.global_hist = (int *)malloc(hist_size * sizeof(int));
+    ctx.node_range = (float *)malloc(3 * ctx.num_selected_features * sizeof(float));
+    float *feature_max = (float *)malloc(num_features * sizeof(float));
+    ctx.sketches = NULL;
+    ctx.merged = NULL;
+    ctx.cuts = NULL;
+    ctx.num_cuts = NULL;
+    if (splitter == SPLITTER_APPROX) {
+        ctx.sketches = (QuantileSketch *)malloc(ctx.num_selected_features * sizeof(QuantileSketch));
+        ctx.merged = (QuantileSketch *)malloc(ctx.num_selected_features * sizeof(QuantileSketch));
+        ctx.cuts = (float *)malloc((size_t)ctx.num_selected_features * (num_bins - 1) * sizeof(float));
+        ctx.num_cuts = (int *)malloc(ctx.num_selected_features * sizeof(int));
+        if (!ctx.sketches || !ctx.merged || !ctx.cuts || !ctx.num_cuts) {
+            fprintf(stderr, "Process %d: Failed to allocate memory for the split sketches\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        for (int s = 0; s < ctx.num_selected_features; s++) {
+            sketch_init(&ctx.sketches[s], SKETCH_DEFAULT_K);
+            sketch_init(&ctx.merged[s], SKETCH_DEFAULT_K);
+        }
+    }
+    if (!ctx.feature_min || !ctx.bin_width || !ctx.selected_features || !ctx.local_hist ||
+        !ctx.global_hist || !ctx.node_range || !feature_max) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for histograms\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Global range of every feature over the tree sample, and global class counts of the root
+    int local_counts[num_classes], class_counts[num_classes];
+    memset(local_counts, 0, num_classes * sizeof(int));
+    for (int f = 0; f < num_features; f++) {
+        ctx.feature_min[f] = FLT_MAX;
+        feature_max[f] = -FLT_MAX;
+    }
+    for (int i = 0; i < sample_rows; i++) {
+        const float *row = local_data + (size_t)indices[i] * num_columns;
+        for (int f = 0; f < num_features; f++) {
+            if (row[f] < ctx.feature_min[f]) ctx.feature_min[f] = row[f];
+            if (row[f] > feature_max[f]) feature_max[f] = row[f];
+        }
+        local_counts[(int)row[target_column]]++;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, ctx.feature_min, num_features, MPI_FLOAT, MPI_MIN, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, feature_max, num_features, MPI_FLOAT, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(local_counts, class_counts, num_classes, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    int total_samples = 0;
+    for (int c = 0; c < num_classes; c++) {
+        total_samples += class_counts[c];
+    }
+    for (int f = 0; f < num_features; f++) {
+        ctx.bin_width[f] = (feature_max[f] > ctx.feature_min[f]) ? (feature_max[f] - ctx.feature_min[f]) / num_bins : 0.0f;
+    }
+
+    // Identical feature draws on every process from here on
+    ctx.rng = (unsigned int)tree_seed;
+    Node *root = create_node(-1, -1000, NULL, NULL, argmax(class_counts, num_classes), 0, 1000, total_samples);
+    grow_node_data_parallel(&ctx, root, indices, sample_rows, class_counts);
+    profile_phase_end(PHASE_TRAIN, grow_start);
+    counters_merge();
+    if (tree_from_nodes(tree, root) != 0) {
+        fprintf(stderr, "Process %d: Failed to flatten the trained tree\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    free(indices);
+    free(feature_max);
+    free(ctx.feature_min);
+    free(ctx.bin_width);
+    free(ctx.selected_features);
+    free(ctx.local_hist);
+    free(ctx.global_hist);
+    free(ctx.node_range);
+    if (ctx.sketches != NULL) {
+        for (int s = 0; s < ctx.num_selected_features; s++) {
+            sketch_free(&ctx.sketches[s]);
+            sketch_free(&ctx.merged[s]);
+        }
+    }
+    free(ctx.sketches);
+    free(ctx.merged);
+    free(ctx.cuts);
+    free(ctx.num_cuts);
+}
@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+
+#include "../headers/feature_parallel.h"
+#include "../headers/utils.h"
+#include "../headers/tree/tree.h"
+#include "../headers/tree/train_utils.h"
+#include "../headers/tree/profile.h"
+#include "../headers/tree/counters.h"
+
+/**
+ * @brief State shared by all the nodes of a feature-parallel tree.
+ */
+typedef struct FeatureParallelContext {
+    int num_local_columns;      /**< Owned features + label. */
+    int first_feature;          /**< Global index of the first owned feature. */
+    int num_local_features;     /**< Number of owned features. */
+    int num_features;           /**< Total number of features. */
+    int num_classes;            /**< Number of classes. */
+    int max_depth;              /**< Maximum depth of the tree. */
+    int min_samples_split;      /**< Minimum number of samples to split a node. */
+    int num_selected_features;  /**< Features evaluated at each node. */
+    int splitter;               /**< SPLITTER_BEST, SPLITTER_RANDOM or SPLITTER_APPROX. */
+    int num_threads;            /**< Threads used by the split sweep. */
+    int *feature_owner;         /**< Rank owning each global feature. */
+    int *selected_features;     /**< Feature indices, shuffled at each node. */
+    unsigned int rng;           /**< Random stream of the tree, identical on every process. */
+} FeatureParallelContext;
+
+/**
+ * @brief Split chosen by the owner of the winning feature, broadcast ahead of the bitmap.
+ */
+typedef struct FeatureSplit {
+    float threshold;
+    int pred_left;
+    int pred_right;
+} FeatureSplit;
+
+float *extract_feature_block(float *data, int num_rows, int num_columns, int *first_feature, int *num_local_features) {
+    int rank, process_number;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+
+    int num_features = num_columns - 1;
+    int *counts = (int *)malloc(process_number * sizeof(int));
+    int *displs = (int *)malloc(process_number * sizeof(int));
+    if (!counts || !displs) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for feature distribution\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    distribute_trees(num_features, process_number, counts, displs);
+    *first_feature = displs[rank];
+    *num_local_features = counts[rank];
+    free(counts);
+    free(displs);
+
+    int local_columns = *num_local_features + 1;
+    float *block = (float *)malloc(((size_t)num_rows * local_columns > 0 ? (size_t)num_rows * local_columns : 1) * sizeof(float));
+    if (!block) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for feature block\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    for (int i = 0; i < num_rows; i++) {
+        const float *row = data + (size_t)i * num_columns;
+        float *local_row = block + (size_t)i * local_columns;
+        memcpy(local_row, row + *first_feature, *num_local_features * sizeof(float));
+        local_row[*num_local_features] = row[num_columns - 1];
+    }
+    return block;
+}
+
+// Grows a node whose rows are data[0..node->num_samples), laid out as the local block.
+// Rows are kept in the same order on every process.
+static void grow_node_feature_parallel(FeatureParallelContext *ctx, Node *node, float *data) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int num_rows = node->num_samples;
+    int num_local_columns = ctx->num_local_columns;
+    int target_column = num_local_columns - 1;
+
+    profile_node(node->depth, num_rows);
+    if (num_rows < ctx->min_samples_split) {
+        COUNTER_ADD(COUNTER_LEAVES_MIN_SAMPLES, 1);
+        return;
+    }
+    if (node->depth >= ctx->max_depth) {
+        COUNTER_ADD(COUNTER_LEAVES_MAX_DEPTH, 1);
+        return;
+    }
+
+    // Same draw on every process, and the same draw as find_best_split_1d()
+    for (int i = 0; i < ctx->num_features; i++) {
+        ctx->selected_features[i] = i;
+    }
+    shuffle(ctx->selected_features, ctx->num_features, &ctx->rng);
+    unsigned int split_seed = ctx->splitter == SPLITTER_RANDOM ? (unsigned int)rng_next(&ctx->rng) : 0;
+
+    // Search on the selected features owned by this process
+    struct {
+        float entropy;
+        int position;
+    } local_best = {INFINITY, ctx->num_selected_features}, global_best;
+    FeatureSplit split = {0.0f, -1, -1};
+
+    float *feature_values = (float *)malloc(num_rows * sizeof(float));
+    float *target_values = (float *)malloc(num_rows * sizeof(float));
+    COUNTER_ADD(COUNTER_MALLOCS, 2);
+    if (!feature_values || !target_values) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for split search\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    for (int s = 0; s < ctx->num_selected_features; s++) {
+        int feature = ctx->selected_features[s];
+        if (ctx->feature_owner[feature] != rank) {
+            continue;
+        }
+        int local_column = feature - ctx->first_feature;
+        float *feature_best_split;
+        if (ctx->splitter == SPLITTER_RANDOM) {
+            double search_start = profile_start();
+            feature_best_split = get_random_split_num_var(data, NULL, NULL, num_rows, num_local_columns,
+                                                          local_column, ctx->num_classes,
+                                                          random_split_unit(split_seed, feature));
+            profile_step_end(STEP_SEARCH, search_start);
+        } else if (ctx->splitter == SPLITTER_APPROX && num_rows > APPROX_MIN_ROWS) {
+            double search_start = profile_start();
+            feature_best_split = get_approx_split_num_var(data, NULL, NULL, num_rows, num_local_columns,
+                                                          local_column, ctx->num_classes, SKETCH_DEFAULT_K,
+                                                          ctx->num_threads);
+            profile_step_end(STEP_SEARCH, search_start);
+        } else {
+            double sort_start = profile_start();
+            for (int j = 0; j < num_rows; j++) {
+                feature_values[j] = data[(size_t)j * num_local_columns + local_column];
+                target_values[j] = data[(size_t)j * num_local_columns + target_column];
+            }
+            merge_sort(feature_values, target_values, num_rows);
+            profile_step_end(STEP_SORT, sort_start);
+
+            double search_start = profile_start();
+            feature_best_split = get_best_split_num_var(feature_values, target_values, num_rows,
+                                                        ctx->num_classes, ctx->num_threads);
+            profile_step_end(STEP_SEARCH, search_start);
+        }
+        // Strict comparison in draw order, as in find_best_split_1d()
+        if (feature_best_split[0] < local_best.entropy) {
+            local_best.entropy = feature_best_split[0];
+            local_best.position = s;
+            split.threshold = feature_best_split[1];
+            split.pred_left = (int)feature_best_split[4];
+            split.pred_right = (int)feature_best_split[5];
+        }
+        free(feature_best_split);
+    }
+    free(feature_values);
+    free(target_values);
+
+    // Lowest entropy wins, ties go to the earliest feature of the draw
+    double reduce_start = profile_start();
+    MPI_Allreduce(&local_best, &global_best, 1, MPI_FLOAT_INT, MPI_MINLOC, MPI_COMM_WORLD);
+    profile_step_end(STEP_SEARCH, reduce_start);
+
+    if (global_best.position >= ctx->num_selected_features || global_best.entropy >= node->entropy) {
+        COUNTER_ADD(COUNTER_LEAVES_NO_GAIN, 1);
+        return;
+    }
+
+    int best_feature = ctx->selected_features[global_best.position];
+    int owner = ctx->feature_owner[best_feature];
+
+    // The owner sends the split and one bit per node row (1 = left)
+    double partition_start = profile_start();
+    size_t bitmap_bytes = ((size_t)num_rows + 7) / 8;
+    size_t message_bytes = sizeof(FeatureSplit) + bitmap_bytes;
+    unsigned char *message = (unsigned char *)calloc(message_bytes, 1);
+    COUNTER_ADD(COUNTER_MALLOCS, 1);
+    if (!message) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for split bitmap\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    unsigned char *bitmap = message + sizeof(FeatureSplit);
+    if (rank == owner) {
+        int local_column = best_feature - ctx->first_feature;
+        memcpy(message, &split, sizeof(FeatureSplit));
+        for (int i = 0; i < num_rows; i++) {
+            if (data[(size_t)i * num_local_columns + local_column] <= split.threshold) {
+                bitmap[i >> 3] |= (unsigned char)(1u << (i & 7));
+            }
+        }
+    }
+    MPI_Bcast(message, (int)message_bytes, MPI_BYTE, owner, MPI_COMM_WORLD);
+    memcpy(&split, message, sizeof(FeatureSplit));
+
+    // Stable partition, so that the row order stays aligned across processes
+    float *left_data = (float *)malloc((size_t)num_rows * num_local_columns * sizeof(float));
+    float *right_data = (float *)malloc((size_t)num_rows * num_local_columns * sizeof(float));
+    COUNTER_ADD(COUNTER_MALLOCS, 2);
+    COUNTER_ADD(COUNTER_BYTES_COPIED, (long long)num_rows * num_local_columns * sizeof(float));
+    if (!left_data || !right_data) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for node split\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    int left_index = 0, right_index = 0;
+    for (int i = 0; i < num_rows; i++) {
+        const float *row = data + (size_t)i * num_local_columns;
+        if (bitmap[i >> 3] & (1u << (i & 7))) {
+            memcpy(left_data + (size_t)left_index++ * num_local_columns, row, num_local_columns * sizeof(float));
+        } else {
+            memcpy(right_data + (size_t)right_index++ * num_local_columns, row, num_local_columns * sizeof(float));
+        }
+    }
+    free(message);
+    profile_step_end(STEP_PARTITION, partition_start);
+
+    node->feature = best_feature;
+    node->threshold = split.threshold;
+    node->entropy = global_best.entropy;
+    // Children sizes come from the partition: the sweep sizes miss rows tied with the threshold
+    node->left = create_node(-1, -1, NULL, NULL, split.pred_left, node->depth + 1, INFINITY, left_index);
+    node->right = create_node(-1, -1, NULL, NULL, split.pred_right, node->depth + 1, INFINITY, right_index);
+
+    grow_node_feature_parallel(ctx, node->left, left_data);
+    grow_node_feature_parallel(ctx, node->right, right_data);
+
+    free(left_data);
+    free(right_data);
+}
+
+void train_tree_feature_parallel(Tree *tree, float *local_columns, int num_rows, int first_feature,
+                                 int num_local_features, int num_columns, int num_classes,
+                                 int max_depth, int min_samples_split, char *max_features, int splitter,
+                                 float sample_proportion, int tree_seed, int num_threads) {
+    int rank, process_number;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+
+    FeatureParallelContext ctx;
+    ctx.num_local_columns = num_local_features + 1;
+    ctx.first_feature = first_feature;
+    ctx.num_local_features = num_local_features;
+    ctx.num_features = num_columns - 1;
+    ctx.num_classes = num_classes;
+    ctx.max_depth = max_depth;
+    ctx.min_samples_split = min_samples_split;
+    ctx.num_threads = num_threads;
+    ctx.splitter = splitter;
+    ctx.num_selected_features = get_num_selected_features(max_features, ctx.num_features);
+
+    int *counts = (int *)malloc(process_number * sizeof(int));
+    int *displs = (int *)malloc(process_number * sizeof(int));
+    ctx.feature_owner = (int *)malloc(ctx.num_features * sizeof(int));
+    ctx.selected_features = (int *)malloc(ctx.num_features * sizeof(int));
+    int sample_size = (int)(sample_proportion * num_rows);
+    float *sample = (float *)malloc(((size_t)sample_size * ctx.num_local_columns > 0 ? (size_t)sample_size * ctx.num_local_columns : 1) * sizeof(float));
+    if (!counts || !displs || !ctx.feature_owner || !ctx.selected_features || !sample) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for feature-parallel tree\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    distribute_trees(ctx.num_features, process_number, counts, displs);
+    for (int p = 0; p < process_number; p++) {
+        for (int f = displs[p]; f < displs[p] + counts[p]; f++) {
+            ctx.feature_owner[f] = p;
+        }
+    }
+    free(counts);
+    free(displs);
+
+    // The draw only depends on num_rows and the seed, so every process samples the same rows;
+    // the stream then continues with the feature draws, as in tree-parallel training
+    ctx.rng = (unsigned int)tree_seed;
+    double sample_start = profile_start();
+    if (sample_data_without_replacement(local_columns, num_rows, ctx.num_local_columns,
+                                        sample_proportion, sample, &ctx.rng) != sample_size) {
+        fprintf(stderr, "Process %d: Failed to sample data for tree\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    profile_phase_end(PHASE_SAMPLE, sample_start);
+
+    double grow_start = profile_start();
+    Node *root = create_node(-1, -1000, NULL, NULL, -1, 0, 1000, sample_size);
+    grow_node_feature_parallel(&ctx, root, sample);
+    profile_phase_end(PHASE_TRAIN, grow_start);
+    counters_merge();
+    if (tree_from_nodes(tree, root) != 0) {
+        fprintf(stderr, "Process %d: Failed to flatten the trained tree\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    free(sample);
+    free(ctx.feature_owner);
+    free(ctx.selected_features);
+}
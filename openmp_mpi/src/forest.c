@@ -0,0 +1,165 @@
+#define _POSIX_C_SOURCE 200809L
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../headers/tree/tree.h"
+#include "../headers/tree/utils.h"
+#include "../headers/tree/memory_ser.h"
+#include "../headers/forest.h"
+
+
+void create_forest(Forest *forest, int num_trees, int max_depth, int min_samples_split, const char* max_features) {
+    forest->num_trees = num_trees;
+    forest->max_depth = max_depth;
+    forest->min_samples_split = min_samples_split;
+    snprintf(forest->max_features, sizeof(forest->max_features), "%s", max_features);
+    forest->trees = (Tree *)malloc(num_trees * sizeof(Tree));
+    
+    for (int i = 0; i < num_trees; i++) {
+        forest->trees[i].nodes = NULL;
+        forest->trees[i].stats = NULL;
+        forest->trees[i].num_nodes = 0;
+    }
+}
+
+void free_forest(Forest *forest) {
+    for (int i = 0; i < forest->num_trees; i++) {
+        free_tree(&forest->trees[i]);
+    }
+    free(forest->trees);
+    free(forest);
+}
+
+void serialize_forest(Forest *forest, const char *dir_path) {
+    char config_path[512];
+    snprintf(config_path, sizeof(config_path), "%s/forest_config.txt", dir_path);
+
+    FILE *config_file = fopen(config_path, "w");
+    if (config_file == NULL) {
+        perror("Failed to open config file for serialization of random forest");
+        return;
+    }
+    fprintf(config_file, "num_trees: %d\n", forest->num_trees);
+    fprintf(config_file, "max_depth: %d\n", forest->max_depth);
+    fprintf(config_file, "min_samples_split: %d\n", forest->min_samples_split);
+    fprintf(config_file, "max_features: %s\n", forest->max_features);
+    fclose(config_file);
+
+    char model_path[512];
+    snprintf(model_path, sizeof(model_path), "%s/%s", dir_path, FOREST_MODEL_FILE);
+    FILE *model_file = fopen(model_path, "wb");
+    if (model_file == NULL) {
+        perror("Failed to open model file for serialization of random forest");
+        return;
+    }
+    if (write_forest_model(forest, model_file) != 0) {
+        fprintf(stderr, "Failed to write forest model file %s\n", model_path);
+    }
+    fclose(model_file);
+}
+
+int write_forest_model(const Forest *forest, FILE *model_file) {
+    int header[2] = {FOREST_MODEL_MAGIC, forest->num_trees};
+    if (fwrite(header, sizeof(int), 2, model_file) != 2) {
+        return 1;
+    }
+    for (int i = 0; i < forest->num_trees; i++) {
+        void *buffer = NULL;
+        int size = 0;
+        serialize_tree_to_buffer(&forest->trees[i], 0, &buffer, &size);
+        int failed = fwrite(&size, sizeof(int), 1, model_file) != 1 || fwrite(buffer, 1, size, model_file) != (size_t)size;
+        free(buffer);
+        if (failed) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int read_forest_model(Forest *forest, FILE *model_file) {
+    int header[2];
+    if (fread(header, sizeof(int), 2, model_file) != 2 || header[0] != FOREST_MODEL_MAGIC ||
+        header[1] != forest->num_trees) {
+        return 1;
+    }
+
+    for (int i = 0; i < forest->num_trees; i++) {
+        int size = 0;
+        void *buffer = NULL;
+        if (fread(&size, sizeof(int), 1, model_file) != 1 || size <= 0 ||
+            (buffer = malloc(size)) == NULL || fread(buffer, 1, size, model_file) != (size_t)size ||
+            deserialize_tree_from_buffer(buffer, size, &forest->trees[i]) != 0 ||
+            forest->trees[i].num_nodes == 0) {
+            // A saved model never holds an empty tree, and inference expects a root
+            free(buffer);
+            for (int j = 0; j < i; j++) {
+                free_tree(&forest->trees[j]);
+            }
+            return 1;
+        }
+        free(buffer);
+    }
+    return 0;
+}
+
+int deserialize_forest(Forest *forest, const char *dir_path) {
+    // Construct path to config file
+    char config_path[512];
+    snprintf(config_path, sizeof(config_path), "%s/forest_config.txt", dir_path);
+
+    forest->num_trees = 0;
+    forest->trees = NULL;
+
+    FILE *config_file = fopen(config_path, "r");
+    if (config_file == NULL) {
+        perror("Failed to open forest config file");
+        return -1;
+    }
+    
+    // Read forest configuration
+    int num_trees = 0, max_depth = 0, min_samples_split = 0;
+    char buffer[sizeof(forest->max_features)] = {0};
+    if (fscanf(config_file, "num_trees: %d\n", &num_trees) != 1 ||
+        fscanf(config_file, "max_depth: %d\n", &max_depth) != 1 ||
+        fscanf(config_file, "min_samples_split: %d\n", &min_samples_split) != 1 ||
+        fscanf(config_file, "max_features: %31s\n", buffer) != 1 || num_trees < 0) {
+        fprintf(stderr, "Malformed forest config file %s\n", config_path);
+        fclose(config_file);
+        return -1;
+    }
+    fclose(config_file);
+
+    create_forest(forest, num_trees, max_depth, min_samples_split, buffer);
+
+    char model_path[512];
+    snprintf(model_path, sizeof(model_path), "%s/%s", dir_path, FOREST_MODEL_FILE);
+    FILE *model_file = fopen(model_path, "rb");
+    if (model_file != NULL) {
+        if (read_forest_model(forest, model_file) != 0) {
+            fprintf(stderr, "Malformed forest model file %s\n", model_path);
+            free(forest->trees);
+            forest->trees = NULL;
+            forest->num_trees = 0;
+            fclose(model_file);
+            return -1;
+        }
+        fclose(model_file);
+        return 0;
+    }
+
+    // Deserialize each tree from its file
+    for (int i = 0; i < forest->num_trees; ++i) {
+        char tree_path[512];
+        snprintf(tree_path, sizeof(tree_path), "%s/random_tree_%d.bin", dir_path, i);
+        if (load_tree_file(tree_path, &forest->trees[i]) != 0) {
+            for (int j = 0; j < i; j++) {
+                free_tree(&forest->trees[j]);
+            }
+            free(forest->trees);
+            forest->trees = NULL;
+            forest->num_trees = 0;
+            return -1;
+        }
+    }
+    return 0;
+}
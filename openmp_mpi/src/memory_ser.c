@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <mpi.h>
+
+#include "../headers/memory_ser.h"
+#include "../headers/tree/memory_ser.h"
+#include "../headers/utils.h"
+
+// Collective part shared by the root and the receivers. On the root, tree_sizes and payload
+// hold every serialized tree back to back; elsewhere they are ignored.
+static Tree *scatter_serialized_trees(int num_trees, const int *tree_sizes, const uint8_t *payload,
+                                      int *num_trees_received) {
+    int rank, process_number;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+
+    MPI_Bcast(&num_trees, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    int *tree_counts = (int *)malloc(process_number * sizeof(int));
+    int *tree_displs = (int *)malloc(process_number * sizeof(int));
+    int *byte_counts = (int *)calloc(process_number, sizeof(int));
+    int *byte_displs = (int *)calloc(process_number, sizeof(int));
+    if (!tree_counts || !tree_displs || !byte_counts || !byte_displs) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for forest distribution\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    distribute_trees(num_trees, process_number, tree_counts, tree_displs);
+
+    if (rank == 0) {
+        for (int p = 0; p < process_number; p++) {
+            for (int t = tree_displs[p]; t < tree_displs[p] + tree_counts[p]; t++) {
+                byte_counts[p] += tree_sizes[t];
+            }
+            byte_displs[p] = (p == 0) ? 0 : byte_displs[p - 1] + byte_counts[p - 1];
+        }
+    }
+
+    // Sizes first, so that every process knows how to cut its payload
+    int my_count = tree_counts[rank];
+    int *my_sizes = (int *)malloc((my_count > 0 ? my_count : 1) * sizeof(int));
+    MPI_Scatterv(tree_sizes, tree_counts, tree_displs, MPI_INT,
+                 my_sizes, my_count, MPI_INT, 0, MPI_COMM_WORLD);
+
+    int my_bytes = 0;
+    for (int t = 0; t < my_count; t++) {
+        my_bytes += my_sizes[t];
+    }
+    uint8_t *my_payload = (uint8_t *)malloc(my_bytes > 0 ? my_bytes : 1);
+    if (!my_sizes || !my_payload) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for received trees\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Scatterv(payload, byte_counts, byte_displs, MPI_BYTE,
+                 my_payload, my_bytes, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    Tree *trees = NULL;
+    if (my_count > 0) {
+        trees = (Tree *)malloc(my_count * sizeof(Tree));
+        if (!trees) {
+            fprintf(stderr, "Process %d: Failed to allocate memory for received trees\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        int offset = 0;
+        for (int t = 0; t < my_count; t++) {
+            if (deserialize_tree_from_buffer(my_payload + offset, my_sizes[t], &trees[t]) != 0) {
+                fprintf(stderr, "Process %d: Failed to deserialize received tree\n", rank);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            offset += my_sizes[t];
+        }
+    }
+    *num_trees_received = my_count;
+
+    free(my_payload);
+    free(my_sizes);
+    free(tree_counts);
+    free(tree_displs);
+    free(byte_counts);
+    free(byte_displs);
+    return trees;
+}
+
+Tree *receive_forest(int *num_trees_received) {
+    return scatter_serialized_trees(0, NULL, NULL, num_trees_received);
+}
+
+// Serializes trees back to back, in array order. tree_sizes receives the size of every tree.
+static uint8_t *pack_trees(Tree *trees, int num_trees, int *tree_sizes, int *total_bytes) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    void **buffers = (void **)malloc((num_trees > 0 ? num_trees : 1) * sizeof(void *));
+    if (!buffers) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for forest serialization\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    *total_bytes = 0;
+    for (int t = 0; t < num_trees; t++) {
+        serialize_tree_to_buffer(&trees[t], 1, &buffers[t], &tree_sizes[t]);
+        *total_bytes += tree_sizes[t];
+    }
+
+    uint8_t *payload = (uint8_t *)malloc(*total_bytes > 0 ? *total_bytes : 1);
+    if (!payload) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for forest payload\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    int offset = 0;
+    for (int t = 0; t < num_trees; t++) {
+        memcpy(payload + offset, buffers[t], tree_sizes[t]);
+        offset += tree_sizes[t];
+        free(buffers[t]);
+    }
+    free(buffers);
+    return payload;
+}
+
+Tree *distribute_forest(Tree *forest, int num_trees, int *num_trees_received) {
+    int *tree_sizes = (int *)malloc((num_trees > 0 ? num_trees : 1) * sizeof(int));
+    if (!tree_sizes) {
+        fprintf(stderr, "Process 0: Failed to allocate memory for forest serialization\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Pack all trees back to back, in tree order
+    int total_bytes;
+    uint8_t *payload = pack_trees(forest, num_trees, tree_sizes, &total_bytes);
+
+    Tree *trees = scatter_serialized_trees(num_trees, tree_sizes, payload, num_trees_received);
+
+    free(payload);
+    free(tree_sizes);
+    return trees;
+}
+
+void gather_forest(Tree *trees, const int *tree_ids, int num_local_trees, Tree *forest_trees) {
+    int rank, process_number;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+
+    int *tree_sizes = (int *)malloc((num_local_trees > 0 ? num_local_trees : 1) * sizeof(int));
+    if (!tree_sizes) {
+        fprintf(stderr, "Process %d: Failed to allocate memory for forest serialization\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    int local_bytes;
+    uint8_t *payload = pack_trees(trees, num_local_trees, tree_sizes, &local_bytes);
+
+    // Number of trees and of bytes of every process
+    int local_counts[2] = {num_local_trees, local_bytes};
+    int *counts = NULL, *tree_counts = NULL, *tree_displs = NULL, *byte_counts = NULL, *byte_displs = NULL;
+    int *all_ids = NULL, *all_sizes = NULL;
+    uint8_t *all_payload = NULL;
+    int total_trees = 0, total_bytes = 0;
+
+    if (rank == 0) {
+        counts = (int *)malloc(2 * process_number * sizeof(int));
+        tree_counts = (int *)malloc(process_number * sizeof(int));
+        tree_displs = (int *)malloc(process_number * sizeof(int));
+        byte_counts = (int *)malloc(process_number * sizeof(int));
+        byte_displs = (int *)malloc(process_number * sizeof(int));
+        if (!counts || !tree_counts || !tree_displs || !byte_counts || !byte_displs) {
+            fprintf(stderr, "Process 0: Failed to allocate memory for forest gathering\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Gather(local_counts, 2, MPI_INT, counts, 2, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        for (int p = 0; p < process_number; p++) {
+            tree_counts[p] = counts[2 * p];
+            byte_counts[p] = counts[2 * p + 1];
+            tree_displs[p] = total_trees;
+            byte_displs[p] = total_bytes;
+            total_trees += tree_counts[p];
+            total_bytes += byte_counts[p];
+        }
+        all_ids = (int *)malloc((total_trees > 0 ? total_trees : 1) * sizeof(int));
+        all_sizes = (int *)malloc((total_trees > 0 ? total_trees : 1) * sizeof(int));
+        all_payload = (uint8_t *)malloc(total_bytes > 0 ? total_bytes : 1);
+        if (!all_ids || !all_sizes || !all_payload) {
+            fprintf(stderr, "Process 0: Failed to allocate memory for gathered trees\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    // Ids and sizes first, so that process 0 knows how to cut the payload
+    MPI_Gatherv(tree_ids, num_local_trees, MPI_INT, all_ids, tree_counts, tree_displs, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(tree_sizes, num_local_trees, MPI_INT, all_sizes, tree_counts, tree_displs, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(payload, local_bytes, MPI_BYTE, all_payload, byte_counts, byte_displs, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        int offset = 0;
+        for (int t = 0; t < total_trees; t++) {
+            if (deserialize_tree_from_buffer(all_payload + offset, all_sizes[t], &forest_trees[all_ids[t]]) != 0) {
+                fprintf(stderr, "Process 0: Failed to deserialize gathered tree %d\n", all_ids[t]);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            offset += all_sizes[t];
+        }
+        free(counts);
+        free(tree_counts);
+        free(tree_displs);
+        free(byte_counts);
+        free(byte_displs);
+        free(all_ids);
+        free(all_sizes);
+        free(all_payload);
+    }
+    free(payload);
+    free(tree_sizes);
+}
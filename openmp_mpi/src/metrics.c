@@ -96,15 +96,8 @@ void compute_metrics(int *predictions, int *targets, int size, int num_classes,
     fclose(metrics_doc);
 }
 
-void aggregate_and_save_predictions(int process_number, int test_size, int num_classes,
-                                   int **all_predictions, int *tree_counts, int *targets,
-                                   const char *store_predictions_path, const char *store_metrics_path, int rank) {
-    // Calculate total number of trees
-    int total_trees = 0;
-    for (int p = 0; p < process_number - 1; p++) {
-        total_trees += tree_counts[p];
-    }
-
+void aggregate_and_save_predictions(int test_size, int num_classes, const vote_t *votes, int *targets,
+                                    const char *store_predictions_path, const char *store_metrics_path, int rank) {
     int *aggregated_predictions = (int *)malloc(test_size * sizeof(int));
     if (!aggregated_predictions) {
         printf("Memory allocation failed for aggregated_predictions\n");
@@ -112,38 +105,17 @@ void aggregate_and_save_predictions(int process_number, int test_size, int num_c
     }
 
     for (int i = 0; i < test_size; i++) {
-        // Vote count array for each class
-        int *votes = (int *)calloc(num_classes, sizeof(int));
-        if (!votes) {
-            printf("Memory allocation failed for votes\n");
-            free(aggregated_predictions);
-            return;
-        }
-
-        // Aggregate votes from all trees (all processes)
-        for (int p = 0; p < process_number - 1; p++) {
-            int trees_p = tree_counts[p];
-            for (int t = 0; t < trees_p; t++) {
-                int pred_class = all_predictions[p][t * test_size + i];
-                if (p != process_number - 2 || t != trees_p - 1) {
-                }
-                if (pred_class >= 0 && pred_class < num_classes) {
-                    votes[pred_class]++;
-                }
-            }
-        }
-
         // Find class with maximum votes
+        const vote_t *row_votes = votes + (size_t)i * num_classes;
         int max_votes = -1;
         int max_class = 0;
         for (int c = 0; c < num_classes; c++) {
-            if (votes[c] > max_votes) {
-                max_votes = votes[c];
+            if (row_votes[c] > max_votes) {
+                max_votes = row_votes[c];
                 max_class = c;
             }
         }
         aggregated_predictions[i] = max_class;
-        free(votes);
     }
 
     // Save predictions if path is given
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "../headers/oob.h"
+#include "../headers/tree/train_utils.h"
+
+void oob_tracker_create(OobTracker *oob, const float *train_data, int train_size, int num_columns,
+                        int num_classes, float sample_proportion, int replacement, float tolerance,
+                        int num_threads) {
+    memset(oob, 0, sizeof(*oob));
+    oob->train_data = train_data;
+    oob->train_size = train_size;
+    oob->num_columns = num_columns;
+    oob->num_classes = num_classes;
+    oob->sample_proportion = sample_proportion;
+    oob->replacement = replacement;
+    oob->tolerance = tolerance;
+    oob->num_threads = num_threads > 0 ? num_threads : 1;
+    oob->best_accuracy = -1.0;
+
+    size_t vote_count = (size_t)train_size * num_classes;
+    oob->votes = (vote_t *)calloc(vote_count > 0 ? vote_count : 1, sizeof(vote_t));
+    oob->round_votes = (vote_t *)calloc(vote_count > 0 ? vote_count : 1, sizeof(vote_t));
+    oob->counts = (int *)malloc((train_size > 0 ? train_size : 1) * sizeof(int));
+    oob->rows = (int *)malloc((train_size > 0 ? train_size : 1) * sizeof(int));
+    if (!oob->votes || !oob->round_votes || !oob->counts || !oob->rows) {
+        int rank;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        fprintf(stderr, "Process %d: Failed to allocate memory for the out-of-bag votes\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+void oob_tracker_add_tree(OobTracker *oob, const Tree *tree, int tree_seed) {
+    if (tree->nodes == NULL) {
+        return;
+    }
+    // Same draws as the training loop, from the start of the tree's stream
+    unsigned int rng = (unsigned int)tree_seed;
+    if (draw_bootstrap(oob->train_size, oob->sample_proportion, oob->replacement, oob->counts, oob->rows, &rng) < 0) {
+        return;
+    }
+
+    const float *train_data = oob->train_data;
+    const int *counts = oob->counts;
+    int num_columns = oob->num_columns, num_classes = oob->num_classes;
+    vote_t *round_votes = oob->round_votes;
+    #pragma omp parallel for schedule(static) num_threads(oob->num_threads)
+    for (int i = 0; i < oob->train_size; i++) {
+        if (counts[i] == 0) {
+            int pred = tree_predict_row(tree, train_data + (size_t)i * num_columns);
+            // A root that never split keeps the pred of -1, as in tree_inference_votes_1d()
+            if (pred >= 0 && pred < num_classes) {
+                round_votes[(size_t)i * num_classes + pred]++;
+            }
+        }
+    }
+    oob->round_trees++;
+}
+
+int oob_tracker_end_round(OobTracker *oob, MPI_Comm comm) {
+    size_t vote_count = (size_t)oob->train_size * oob->num_classes;
+    int round_trees = 0;
+    MPI_Allreduce(&oob->round_trees, &round_trees, 1, MPI_INT, MPI_SUM, comm);
+    if (round_trees == 0) {
+        return 1;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, oob->round_votes, (int)vote_count, MPI_UNSIGNED_SHORT, MPI_SUM, comm);
+    for (size_t i = 0; i < vote_count; i++) {
+        oob->votes[i] += oob->round_votes[i];
+    }
+    memset(oob->round_votes, 0, vote_count * sizeof(vote_t));
+    oob->round_trees = 0;
+    oob->num_trees += round_trees;
+
+    // Majority vote of every row that some tree left out, ties to the lowest class as in
+    // aggregate_and_save_predictions()
+    int correct = 0, scored = 0;
+    for (int i = 0; i < oob->train_size; i++) {
+        const vote_t *row_votes = oob->votes + (size_t)i * oob->num_classes;
+        int max_votes = 0, max_class = -1;
+        for (int c = 0; c < oob->num_classes; c++) {
+            if (row_votes[c] > max_votes) {
+                max_votes = row_votes[c];
+                max_class = c;
+            }
+        }
+        if (max_class >= 0) {
+            scored++;
+            correct += max_class == (int)oob->train_data[(size_t)i * oob->num_columns + oob->num_columns - 1];
+        }
+    }
+    oob->num_scored_rows = scored;
+    oob->accuracy = scored > 0 ? (double)correct / scored : 0.0;
+    if (scored == 0) {
+        // Bootstraps that keep every row leave nothing to evaluate, and never stop the forest
+        return 0;
+    }
+
+    // Until most rows have been left out by some tree, the accuracy is measured on a growing
+    // set of rows and its changes say little about the forest: the patience starts afterwards
+    if (scored < OOB_MIN_COVERAGE * oob->train_size || oob->accuracy > oob->best_accuracy + oob->tolerance) {
+        oob->best_accuracy = oob->accuracy;
+        oob->best_trees = oob->num_trees;
+    }
+    int stop = oob->num_trees - oob->best_trees >= OOB_PATIENCE_TREES;
+
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if (rank == 0) {
+        printf("Process 0: Out-of-bag accuracy %.4f on %d rows after %d trees\n", oob->accuracy, scored,
+               oob->num_trees);
+        if (stop) {
+            printf("Process 0: No out-of-bag gain above %g in the last %d trees, the forest stops growing\n",
+                   oob->tolerance, oob->num_trees - oob->best_trees);
+        }
+        fflush(stdout);
+    }
+    return stop;
+}
+
+void oob_tracker_free(OobTracker *oob) {
+    free(oob->votes);
+    free(oob->round_votes);
+    free(oob->counts);
+    free(oob->rows);
+    oob->votes = oob->round_votes = NULL;
+    oob->counts = oob->rows = NULL;
+}
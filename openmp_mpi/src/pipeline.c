@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "../headers/pipeline.h"
+#include "../headers/utils.h"
+#include "../headers/tree/train_utils.h"
+#include "../headers/tree/profile.h"
+#include "../headers/tree/numa.h"
+
+/**
+ * @brief Buffers of one in-flight round.
+ */
+typedef struct PipelineSlot {
+    vote_t *votes;          /**< Votes of the tree trained by this process in the round. */
+    vote_t *reduced;        /**< Sum over all processes, process 0 only. */
+    int active;             /**< Whether this process trained a tree in the round. */
+    int any_active;         /**< Whether any process trained a tree in the round. */
+    MPI_Request requests[2];
+    int pending;
+} PipelineSlot;
+
+// Waits for the reductions of a slot and adds its votes to the global matrix on process 0
+static void complete_slot(PipelineSlot *slot, size_t vote_count, vote_t *global_votes, int rank) {
+    if (!slot->pending) {
+        return;
+    }
+    MPI_Waitall(2, slot->requests, MPI_STATUSES_IGNORE);
+    slot->pending = 0;
+    if (rank == 0) {
+        for (size_t i = 0; i < vote_count; i++) {
+            global_votes[i] += slot->reduced[i];
+        }
+    }
+}
+
+int train_and_score_pipelined(TreeScheduler *scheduler, const int *tree_ids, int num_scheduled,
+                              Tree *trees, int *local_tree_ids, int num_trees, Checkpoint *checkpoint,
+                              float *train_data, int train_size, float *test_data, int test_size,
+                              int num_columns, int num_classes, int max_depth, int min_samples_split,
+                              char *max_features, int splitter, int bootstrap, float sample_proportion,
+                              int seed, int num_threads, vote_t *global_votes, double *train_time,
+                              double *inference_time) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    size_t vote_count = (size_t)test_size * num_classes;
+    int sample_size = (int)(sample_proportion * train_size);
+    float *sample = NULL;
+    int *sample_counts = NULL, *sample_rows = NULL;
+    if (bootstrap == BOOTSTRAP_COPY) {
+        sample = (float *)numa_alloc((size_t)sample_size * num_columns * sizeof(float));
+    } else {
+        sample_counts = (int *)malloc((size_t)train_size * sizeof(int));
+        sample_rows = (int *)malloc((size_t)sample_size * sizeof(int));
+    }
+    if (bootstrap == BOOTSTRAP_COPY ? !sample : !sample_counts || !sample_rows) {
+        fprintf(stderr, "Process %d: Malloc failed for my_train_data\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    PipelineSlot slots[PIPELINE_DEPTH];
+    for (int s = 0; s < PIPELINE_DEPTH; s++) {
+        slots[s].votes = (vote_t *)malloc((vote_count > 0 ? vote_count : 1) * sizeof(vote_t));
+        slots[s].reduced = (rank == 0) ? (vote_t *)malloc((vote_count > 0 ? vote_count : 1) * sizeof(vote_t)) : NULL;
+        slots[s].pending = 0;
+        if (!slots[s].votes || (rank == 0 && !slots[s].reduced)) {
+            fprintf(stderr, "Process %d: Malloc failed for pipeline vote buffers\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    int num_local_trees = 0;
+    *train_time = 0.0;
+    *inference_time = 0.0;
+
+    for (int round = 0; ; round++) {
+        PipelineSlot *slot = &slots[round % PIPELINE_DEPTH];
+
+        // Reuse the slot of PIPELINE_DEPTH rounds ago. A round in which no process trained
+        // means the scheduler is exhausted everywhere, so every process stops here together.
+        if (slot->pending) {
+            double wait_start = MPI_Wtime();
+            double aggregation_start = profile_start();
+            complete_slot(slot, vote_count, global_votes, rank);
+            profile_phase_end(PHASE_AGGREGATION, aggregation_start);
+            *inference_time += MPI_Wtime() - wait_start;
+            if (!slot->any_active) {
+                break;
+            }
+        }
+
+        int position = tree_scheduler_next(scheduler, num_scheduled);
+        int tree_id = (position >= 0) ? tree_ids[position] : -1;
+        slot->active = (tree_id >= 0);
+        memset(slot->votes, 0, vote_count * sizeof(vote_t));
+
+        if (slot->active) {
+            printf("Process %d: Training tree %d/%d\n", rank, tree_id + 1, num_trees);
+            fflush(stdout);
+            double tree_start = MPI_Wtime();
+
+            double sample_start = profile_start();
+            unsigned int rng = (unsigned int)(seed + tree_id);
+            int my_sample_size;
+            if (bootstrap == BOOTSTRAP_COPY) {
+                my_sample_size = sample_data_without_replacement(train_data, train_size, num_columns,
+                                                                 sample_proportion, sample, &rng);
+            } else {
+                my_sample_size = draw_bootstrap(train_size, sample_proportion, bootstrap == BOOTSTRAP_REPLACEMENT,
+                                                sample_counts, sample_rows, &rng);
+            }
+            if (my_sample_size <= 0) {
+                fprintf(stderr, "Process %d: Error in sampling data (got size: %d)\n", rank, my_sample_size);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            profile_phase_end(PHASE_SAMPLE, sample_start);
+
+            double grow_start = profile_start();
+            if (bootstrap == BOOTSTRAP_COPY) {
+                train_tree_1d(&trees[num_local_trees], sample, my_sample_size, num_columns, num_classes,
+                              max_depth, min_samples_split, max_features, splitter, num_threads, &rng);
+            } else {
+                train_tree_weighted(&trees[num_local_trees], train_data, num_columns, sample_rows, sample_counts,
+                                    my_sample_size, num_classes, max_depth, min_samples_split, max_features,
+                                    splitter, num_threads, &rng);
+            }
+            profile_phase_end(PHASE_TRAIN, grow_start);
+            if (checkpoint != NULL) {
+                checkpoint_write_tree(checkpoint, &trees[num_local_trees], tree_id);
+            }
+
+            double infer_start = MPI_Wtime();
+            *train_time += infer_start - tree_start;
+
+            double scoring_start = profile_start();
+            tree_inference_votes_1d(&trees[num_local_trees], test_data, test_size, num_columns, num_classes, slot->votes);
+            profile_phase_end(PHASE_INFERENCE, scoring_start);
+            local_tree_ids[num_local_trees] = tree_id;
+            num_local_trees++;
+            *inference_time += MPI_Wtime() - infer_start;
+
+            printf("Process %d: Finished and scored tree %d/%d in %.4f seconds\n",
+                   rank, tree_id + 1, num_trees, MPI_Wtime() - tree_start);
+            fflush(stdout);
+        }
+
+        MPI_Ireduce(slot->votes, slot->reduced, (int)vote_count, MPI_UNSIGNED_SHORT, MPI_SUM, 0,
+                    MPI_COMM_WORLD, &slot->requests[0]);
+        MPI_Iallreduce(&slot->active, &slot->any_active, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD, &slot->requests[1]);
+        slot->pending = 1;
+    }
+
+    // Drain the rounds still in flight, which are empty by now
+    for (int s = 0; s < PIPELINE_DEPTH; s++) {
+        complete_slot(&slots[s], vote_count, global_votes, rank);
+        free(slots[s].votes);
+        free(slots[s].reduced);
+    }
+    free(sample);
+    free(sample_counts);
+    free(sample_rows);
+
+    return num_local_trees;
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+
+#include "../headers/profile_report.h"
+#include "../headers/tree/profile.h"
+#include "../headers/tree/counters.h"
+
+static const char *phase_names[PHASE_COUNT] = {
+    "parse", "broadcast", "split", "sample", "train", "inference", "aggregation", "save"
+};
+
+static const char *step_names[STEP_COUNT] = {"sort", "search", "partition"};
+
+static void write_phases(FILE *fp, const double *phase_time) {
+    fprintf(fp, "{");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        fprintf(fp, "%s\"%s\": %.6f", p > 0 ? ", " : "", phase_names[p], phase_time[p]);
+    }
+    fprintf(fp, "}");
+}
+
+// Non-empty buckets of a node size histogram, keyed by their lower bound
+static void write_size_hist(FILE *fp, const double *size_hist) {
+    fprintf(fp, "\"node_sizes\": {");
+    int first_bucket = 1;
+    for (int b = 0; b < PROFILE_SIZE_BUCKETS; b++) {
+        if (size_hist[b] > 0) {
+            fprintf(fp, "%s\"%d\": %.0f", first_bucket ? "" : ", ", profile_bucket_min(b), size_hist[b]);
+            first_bucket = 0;
+        }
+    }
+    fprintf(fp, "}");
+}
+
+static void write_process(FILE *fp, const Profile *process, const long long *counters, int rank, int num_threads) {
+    fprintf(fp, "    {\n      \"rank\": %d,\n      \"phases\": ", rank);
+    write_phases(fp, process->phase_time);
+
+    if (counters != NULL) {
+        fprintf(fp, ",\n      \"counters\": {");
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            fprintf(fp, "%s\"%s\": %lld", c > 0 ? ", " : "", counter_name(c), counters[c]);
+        }
+        fprintf(fp, "}");
+    }
+
+    // Only the depths that were reached
+    fprintf(fp, ",\n      \"depths\": [");
+    int first = 1;
+    for (int d = 0; d < PROFILE_MAX_DEPTH; d++) {
+        const DepthProfile *depth = &process->depths[d];
+        if (depth->nodes == 0) {
+            continue;
+        }
+        fprintf(fp, "%s\n        {\"depth\": %d, \"nodes\": %.0f", first ? "" : ",", d, depth->nodes);
+        for (int s = 0; s < STEP_COUNT; s++) {
+            fprintf(fp, ", \"%s\": %.6f", step_names[s], depth->step_time[s]);
+        }
+        fprintf(fp, ", ");
+        write_size_hist(fp, depth->size_hist);
+        fprintf(fp, "}");
+        first = 0;
+    }
+    fprintf(fp, "%s],\n      \"threads\": [", first ? "" : "\n      ");
+
+    int profiled_threads = num_threads < PROFILE_MAX_THREADS ? num_threads : PROFILE_MAX_THREADS;
+    for (int t = 0; t < profiled_threads; t++) {
+        const ThreadProfile *thread = &process->threads[t];
+        fprintf(fp, "%s\n        {\"thread\": %d, \"split_sweep\": %.6f, \"sweeps\": %.0f, \"candidates\": %.0f, ",
+                t > 0 ? "," : "", t, thread->sweep_time, thread->sweeps, thread->candidates);
+        write_size_hist(fp, thread->size_hist);
+        fprintf(fp, "}");
+    }
+    fprintf(fp, "%s]\n    }", profiled_threads > 0 ? "\n      " : "");
+}
+
+void profile_write_report(const char *path, int num_threads) {
+    int rank, process_number;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_number);
+
+    // Every process runs the same binary, so the profiles are gathered as raw bytes
+    Profile *all = NULL;
+    long long *all_counters = NULL;
+    if (rank == 0) {
+        all = (Profile *)malloc(process_number * sizeof(Profile));
+        all_counters = (long long *)malloc((size_t)process_number * COUNTER_COUNT * sizeof(long long));
+        if (!all || !all_counters) {
+            fprintf(stderr, "Process 0: Failed to allocate memory for the profiles\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Gather(&profile, (int)sizeof(Profile), MPI_BYTE, all, (int)sizeof(Profile), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+    long long counters[COUNTER_COUNT];
+    counters_get(counters);
+    MPI_Gather(counters, COUNTER_COUNT, MPI_LONG_LONG, all_counters, COUNTER_COUNT, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+
+    if (rank != 0) {
+        return;
+    }
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "Process 0: Failed to open profile file %s\n", path);
+        free(all);
+        free(all_counters);
+        return;
+    }
+
+    double max_phase_time[PHASE_COUNT] = {0};
+    for (int r = 0; r < process_number; r++) {
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            if (all[r].phase_time[p] > max_phase_time[p]) {
+                max_phase_time[p] = all[r].phase_time[p];
+            }
+        }
+    }
+
+    fprintf(fp, "{\n  \"processes\": %d,\n  \"threads\": %d,\n  \"max_phases\": ", process_number, num_threads);
+    write_phases(fp, max_phase_time);
+    fprintf(fp, ",\n  \"ranks\": [\n");
+    for (int r = 0; r < process_number; r++) {
+        write_process(fp, &all[r], counters_enabled() ? all_counters + (size_t)r * COUNTER_COUNT : NULL, r, num_threads);
+        fprintf(fp, "%s\n", r < process_number - 1 ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    free(all);
+    free(all_counters);
+
+    printf("Process 0: Profile written to %s\n", path);
+    fflush(stdout);
+}
@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <mpi.h>
+
+#include "../headers/scheduler.h"
+
+void tree_scheduler_create(TreeScheduler *scheduler, int dynamic, int first_tree, int num_trees_assigned, MPI_Comm comm) {
+    scheduler->dynamic = dynamic;
+    scheduler->next_tree = first_tree;
+    scheduler->end_tree = first_tree + num_trees_assigned;
+    scheduler->counter = NULL;
+
+    if (!dynamic) {
+        return;
+    }
+
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Aint bytes = (rank == 0) ? sizeof(int) : 0;
+    MPI_Win_allocate(bytes, sizeof(int), MPI_INFO_NULL, comm, &scheduler->counter, &scheduler->win);
+
+    // Reset the counter before anyone fetches from it
+    if (rank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, scheduler->win);
+        *scheduler->counter = 0;
+        MPI_Win_unlock(0, scheduler->win);
+    }
+    MPI_Barrier(comm);
+    MPI_Win_lock_all(0, scheduler->win);
+}
+
+int tree_scheduler_next(TreeScheduler *scheduler, int num_trees) {
+    if (!scheduler->dynamic) {
+        if (scheduler->next_tree >= scheduler->end_tree) {
+            return -1;
+        }
+        return scheduler->next_tree++;
+    }
+
+    int one = 1;
+    int tree_id;
+    MPI_Fetch_and_op(&one, &tree_id, MPI_INT, 0, 0, MPI_SUM, scheduler->win);
+    MPI_Win_flush(0, scheduler->win);
+
+    return (tree_id < num_trees) ? tree_id : -1;
+}
+
+void tree_scheduler_free(TreeScheduler *scheduler) {
+    if (!scheduler->dynamic) {
+        return;
+    }
+    MPI_Win_unlock_all(scheduler->win);
+    MPI_Win_free(&scheduler->win);
+}
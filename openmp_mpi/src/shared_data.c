@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "../headers/shared_data.h"
+#include "../headers/utils.h"
+
+// Allocates a node-shared matrix owned by the node leader and maps it on every local rank
+static float *allocate_node_matrix(SharedDataset *shared, MPI_Win *win, int rows, int num_columns) {
+    MPI_Aint bytes = 0;
+    float *base = NULL;
+
+    if (shared->node_rank == 0) {
+        bytes = (MPI_Aint)rows * num_columns * sizeof(float);
+    }
+    MPI_Win_allocate_shared(bytes, sizeof(float), MPI_INFO_NULL, shared->node_comm, &base, win);
+
+    if (shared->node_rank != 0) {
+        MPI_Aint leader_bytes;
+        int disp_unit;
+        MPI_Win_shared_query(*win, 0, &leader_bytes, &disp_unit, &base);
+    }
+    return base;
+}
+
+void shared_dataset_split(SharedDataset *shared, float *data, int num_rows, int num_columns,
+                          int num_classes, float train_proportion, int seed,
+                          float **train_data, int *train_size, float **test_data, int *test_size) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Ranks on the same node, ordered as in MPI_COMM_WORLD so rank 0 leads its node
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &shared->node_comm);
+    MPI_Comm_rank(shared->node_comm, &shared->node_rank);
+    MPI_Comm_split(MPI_COMM_WORLD, shared->node_rank == 0 ? 0 : MPI_UNDEFINED, rank, &shared->leader_comm);
+
+    float *leader_train = NULL, *leader_test = NULL;
+    int sizes[2] = {0, 0};
+
+    if (shared->node_rank == 0) {
+        if (rank != 0) {
+            data = (float *)malloc((size_t)num_rows * num_columns * sizeof(float));
+            if (data == NULL) {
+                fprintf(stderr, "Process %d: Failed to allocate memory for dataset\n", rank);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+
+        // One inter-node broadcast per node
+        MPI_Bcast(data, num_rows * num_columns, MPI_FLOAT, 0, shared->leader_comm);
+
+        stratified_split(data, num_rows, num_columns, num_classes, train_proportion,
+                         &leader_train, &sizes[0], &leader_test, &sizes[1], seed);
+        free(data);
+
+        printf("Process %d: Node leader split dataset - %d train rows, %d test rows\n", rank, sizes[0], sizes[1]);
+        fflush(stdout);
+    }
+
+    MPI_Bcast(sizes, 2, MPI_INT, 0, shared->node_comm);
+    *train_size = sizes[0];
+    *test_size = sizes[1];
+
+    *train_data = allocate_node_matrix(shared, &shared->train_win, *train_size, num_columns);
+    *test_data = allocate_node_matrix(shared, &shared->test_win, *test_size, num_columns);
+
+    MPI_Win_fence(0, shared->train_win);
+    MPI_Win_fence(0, shared->test_win);
+    if (shared->node_rank == 0) {
+        memcpy(*train_data, leader_train, (size_t)(*train_size) * num_columns * sizeof(float));
+        memcpy(*test_data, leader_test, (size_t)(*test_size) * num_columns * sizeof(float));
+        free(leader_train);
+        free(leader_test);
+    }
+    // Make the leader's stores visible to all local ranks before anyone reads
+    MPI_Win_fence(0, shared->train_win);
+    MPI_Win_fence(0, shared->test_win);
+}
+
+void shared_dataset_free_train(SharedDataset *shared) {
+    MPI_Win_free(&shared->train_win);
+}
+
+void shared_dataset_free_test(SharedDataset *shared) {
+    MPI_Win_free(&shared->test_win);
+    if (shared->leader_comm != MPI_COMM_NULL) {
+        MPI_Comm_free(&shared->leader_comm);
+    }
+    MPI_Comm_free(&shared->node_comm);
+}
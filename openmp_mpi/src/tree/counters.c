@@ -0,0 +1,46 @@
+#include <string.h>
+
+#include "../../headers/tree/counters.h"
+
+static const char *counter_names[COUNTER_COUNT] = {
+    "candidates", "entropy_evals", "bytes_copied", "nodes",
+    "leaves_min_samples", "leaves_max_depth", "leaves_no_gain", "mallocs"
+};
+
+static long long counter_totals[COUNTER_COUNT];
+
+#ifdef WORK_COUNTERS
+
+CounterSlot counter_slots[COUNTER_MAX_THREADS];
+
+void counters_merge(void) {
+    for (int t = 0; t < COUNTER_MAX_THREADS; t++) {
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            counter_totals[c] += counter_slots[t].value[c];
+        }
+        memset(&counter_slots[t], 0, sizeof(CounterSlot));
+    }
+}
+
+int counters_enabled(void) {
+    return 1;
+}
+
+#else
+
+void counters_merge(void) {
+}
+
+int counters_enabled(void) {
+    return 0;
+}
+
+#endif // WORK_COUNTERS
+
+void counters_get(long long *totals) {
+    memcpy(totals, counter_totals, sizeof(counter_totals));
+}
+
+const char *counter_name(WorkCounter counter) {
+    return counter_names[counter];
+}
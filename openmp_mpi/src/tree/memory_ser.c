@@ -5,91 +5,142 @@
 #include <time.h>
 #include <stdint.h>
 #include "../../headers/tree/tree.h" 
+#include "../../headers/tree/memory_ser.h"
+#include "../../headers/tree/utils.h"
 
-// Recursively count number of nodes
-int count_nodes(const Node* node) {
-    if (!node) return 0;
-    return 1 + count_nodes(node->left) + count_nodes(node->right);
-}
-
-// Recursively serialize a node into the buffer
-void flatten_node(const Node* node, uint8_t* buffer, int* offset) {
-    memcpy(buffer + *offset, &node->feature, sizeof(int));
-    *offset += sizeof(int);
-
-    memcpy(buffer + *offset, &node->threshold, sizeof(float));
-    *offset += sizeof(float);
-
-    memcpy(buffer + *offset, &node->pred, sizeof(int));
-    *offset += sizeof(int);
-
-    memcpy(buffer + *offset, &node->entropy, sizeof(float));
-    *offset += sizeof(float);
-
-    memcpy(buffer + *offset, &node->depth, sizeof(int));
-    *offset += sizeof(int);
-
-    memcpy(buffer + *offset, &node->num_samples, sizeof(int));
-    *offset += sizeof(int);
-
-    int has_left = (node->left != NULL);
-    int has_right = (node->right != NULL);
-    memcpy(buffer + *offset, &has_left, sizeof(int));
-    *offset += sizeof(int);
-    memcpy(buffer + *offset, &has_right, sizeof(int));
-    *offset += sizeof(int);
-
-    if (has_left) flatten_node(node->left, buffer, offset);
-    if (has_right) flatten_node(node->right, buffer, offset);
-}
-
-void serialize_tree_to_buffer(const struct Tree* tree, void** out_buffer, int* out_size) {
-    int total_nodes = count_nodes(tree->root);
-    int size_per_node = sizeof(int) * 6 + sizeof(float) * 2;  // 6 ints + 2 floats per node
-    int total_size = total_nodes * size_per_node;
+void serialize_tree_to_buffer(const struct Tree* tree, int with_stats, void** out_buffer, int* out_size) {
+    with_stats = with_stats && tree->stats != NULL;
+    int header[2] = {with_stats ? TREE_FORMAT_MAGIC : TREE_FORMAT_MAGIC_HOT, tree->num_nodes};
+    size_t hot_size = (size_t)tree->num_nodes * sizeof(HotNode);
+    size_t cold_size = with_stats ? (size_t)tree->num_nodes * sizeof(NodeStats) : 0;
+    int total_size = (int)(sizeof(header) + hot_size + cold_size);
 
     uint8_t* buffer = (uint8_t*)malloc(total_size);
-    int offset = 0;
-    flatten_node(tree->root, buffer, &offset);
+    memcpy(buffer, header, sizeof(header));
+    if (tree->num_nodes > 0) {
+        memcpy(buffer + sizeof(header), tree->nodes, hot_size);
+        if (with_stats) {
+            memcpy(buffer + sizeof(header) + hot_size, tree->stats, cold_size);
+        }
+    }
 
     *out_buffer = buffer;
-    *out_size = offset;
+    *out_size = total_size;
 }
-// Recursively rebuild node from buffer
-Node* rebuild_node(const uint8_t* buffer, int* offset) {
-    Node* node = (Node*)malloc(sizeof(Node));
-
-    memcpy(&node->feature, buffer + *offset, sizeof(int));
-    *offset += sizeof(int);
 
-    memcpy(&node->threshold, buffer + *offset, sizeof(float));
-    *offset += sizeof(float);
-
-    memcpy(&node->pred, buffer + *offset, sizeof(int));
-    *offset += sizeof(int);
-
-    memcpy(&node->entropy, buffer + *offset, sizeof(float));
-    *offset += sizeof(float);
+// Every child index must point to a pair inside the array, after its parent (so no cycles)
+static int valid_layout(const HotNode* nodes, int num_nodes) {
+    for (int i = 0; i < num_nodes; i++) {
+        if (nodes[i].feature != TREE_LEAF &&
+            (nodes[i].feature < 0 || nodes[i].child <= i || nodes[i].child > num_nodes - 2)) {
+            return 0;
+        }
+    }
+    return 1;
+}
 
-    memcpy(&node->depth, buffer + *offset, sizeof(int));
-    *offset += sizeof(int);
+// Copies the next field of the legacy format, failing past the end of the buffer
+static int read_field(const uint8_t* buffer, int size, int* offset, void* field, int field_size) {
+    if (*offset < 0 || size - *offset < field_size) {
+        return -1;
+    }
+    memcpy(field, buffer + *offset, field_size);
+    *offset += field_size;
+    return 0;
+}
 
-    memcpy(&node->num_samples, buffer + *offset, sizeof(int));
-    *offset += sizeof(int);
+// Recursively rebuild node from buffer
+Node* rebuild_node(const uint8_t* buffer, int size, int* offset) {
+    Node* node = (Node*)malloc(sizeof(Node));
+    if (!node) {
+        return NULL;
+    }
+    node->left = NULL;
+    node->right = NULL;
 
     int has_left, has_right;
-    memcpy(&has_left, buffer + *offset, sizeof(int));
-    *offset += sizeof(int);
-    memcpy(&has_right, buffer + *offset, sizeof(int));
-    *offset += sizeof(int);
-
-    node->left = has_left ? rebuild_node(buffer, offset) : NULL;
-    node->right = has_right ? rebuild_node(buffer, offset) : NULL;
-
+    if (read_field(buffer, size, offset, &node->feature, sizeof(int)) != 0 ||
+        read_field(buffer, size, offset, &node->threshold, sizeof(float)) != 0 ||
+        read_field(buffer, size, offset, &node->pred, sizeof(int)) != 0 ||
+        read_field(buffer, size, offset, &node->entropy, sizeof(float)) != 0 ||
+        read_field(buffer, size, offset, &node->depth, sizeof(int)) != 0 ||
+        read_field(buffer, size, offset, &node->num_samples, sizeof(int)) != 0 ||
+        read_field(buffer, size, offset, &has_left, sizeof(int)) != 0 ||
+        read_field(buffer, size, offset, &has_right, sizeof(int)) != 0) {
+        free(node);
+        return NULL;
+    }
+
+    if ((has_left && (node->left = rebuild_node(buffer, size, offset)) == NULL) ||
+        (has_right && (node->right = rebuild_node(buffer, size, offset)) == NULL)) {
+        destroy_node(node);
+        return NULL;
+    }
     return node;
 }
 
-void deserialize_tree_from_buffer(const void* buffer, struct Tree* tree) {
-    int offset = 0;
-    tree->root = rebuild_node((const uint8_t*)buffer, &offset);
+int deserialize_tree_from_buffer(const void* buffer, int size, struct Tree* tree) {
+    const uint8_t* bytes = (const uint8_t*)buffer;
+    int header[2] = {0, 0};
+    tree->nodes = NULL;
+    tree->stats = NULL;
+    tree->num_nodes = 0;
+
+    if (size >= (int)sizeof(int)) {
+        memcpy(header, bytes, sizeof(int));
+    }
+    if (header[0] != TREE_FORMAT_MAGIC && header[0] != TREE_FORMAT_MAGIC_HOT) {
+        // Recursive node format written before the flat layout: it holds at least the root,
+        // and nothing after the last node
+        int offset = 0;
+        Node* root = rebuild_node(bytes, size, &offset);
+        if (root == NULL) {
+            return -1;
+        }
+        if (offset != size || tree_from_nodes(tree, root) != 0) {
+            // tree_from_nodes() only releases the nodes once they are flattened
+            destroy_node(root);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (size < (int)sizeof(header)) {
+        return -1;
+    }
+    memcpy(header, bytes, sizeof(header));
+    int with_stats = header[0] == TREE_FORMAT_MAGIC;
+    int num_nodes = header[1];
+    if (num_nodes < 0 ||
+        (size_t)size != sizeof(header) + (size_t)num_nodes * (sizeof(HotNode) + (with_stats ? sizeof(NodeStats) : 0))) {
+        return -1;
+    }
+    if (num_nodes == 0) {
+        return 0;
+    }
+
+    size_t hot_size = (size_t)num_nodes * sizeof(HotNode);
+    size_t cold_size = with_stats ? (size_t)num_nodes * sizeof(NodeStats) : 0;
+    tree->nodes = (HotNode*)malloc(hot_size);
+    tree->stats = with_stats ? (NodeStats*)malloc(cold_size) : NULL;
+    if (!tree->nodes || (with_stats && !tree->stats)) {
+        free(tree->nodes);
+        free(tree->stats);
+        tree->nodes = NULL;
+        tree->stats = NULL;
+        return -1;
+    }
+    memcpy(tree->nodes, bytes + sizeof(header), hot_size);
+    if (with_stats) {
+        memcpy(tree->stats, bytes + sizeof(header) + hot_size, cold_size);
+    }
+    if (!valid_layout(tree->nodes, num_nodes)) {
+        free(tree->nodes);
+        free(tree->stats);
+        tree->nodes = NULL;
+        tree->stats = NULL;
+        return -1;
+    }
+    tree->num_nodes = num_nodes;
+    return 0;
 }
@@ -0,0 +1,211 @@
+#define _GNU_SOURCE  // sched_getcpu()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "../../headers/tree/numa.h"
+
+#define NUMA_PAGE_BYTES 4096
+
+static int first_touch_threads = 1;
+
+// CPU -> NUMA node map read once from /sys, empty if unavailable
+static struct {
+    int loaded;
+    int num_nodes;
+    int num_cpus;
+    int *cpu_node;
+} topology;
+
+// Marks the CPUs of a cpulist such as "0-15,32-47" as belonging to node
+static void parse_cpulist(const char *list, int node) {
+    const char *p = list;
+    while (*p != '\0' && *p != '\n') {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p) {
+            return;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long cpu = first; cpu <= last && cpu < topology.num_cpus; cpu++) {
+            if (cpu >= 0) {
+                topology.cpu_node[cpu] = node;
+            }
+        }
+        if (*p == ',') {
+            p++;
+        }
+    }
+}
+
+static void load_topology(void) {
+    if (topology.loaded) {
+        return;
+    }
+    #pragma omp critical(numa_topology)
+    if (!topology.loaded) {
+        topology.num_nodes = 1;
+        long num_cpus = sysconf(_SC_NPROCESSORS_CONF);
+        topology.num_cpus = num_cpus > 0 ? (int)num_cpus : 0;
+        topology.cpu_node = (int *)calloc(topology.num_cpus > 0 ? topology.num_cpus : 1, sizeof(int));
+
+        // The highest possible node id, e.g. "0-3" or "0"
+        FILE *fp = fopen("/sys/devices/system/node/possible", "r");
+        char line[4096];
+        if (fp != NULL && topology.cpu_node != NULL && fgets(line, sizeof(line), fp) != NULL) {
+            const char *last = strrchr(line, '-');
+            int max_node = atoi(last != NULL ? last + 1 : line);
+            topology.num_nodes = max_node + 1;
+            for (int node = 0; node <= max_node; node++) {
+                char path[128];
+                snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+                FILE *cpulist = fopen(path, "r");
+                if (cpulist != NULL) {
+                    if (fgets(line, sizeof(line), cpulist) != NULL) {
+                        parse_cpulist(line, node);
+                    }
+                    fclose(cpulist);
+                }
+            }
+        }
+        if (fp != NULL) {
+            fclose(fp);
+        }
+        topology.loaded = 1;
+    }
+}
+
+void numa_set_first_touch(int num_threads) {
+    first_touch_threads = num_threads > 1 ? num_threads : 1;
+}
+
+void *numa_alloc(size_t bytes) {
+    char *buffer = (char *)malloc(bytes > 0 ? bytes : 1);
+    if (buffer == NULL || first_touch_threads <= 1 || bytes < NUMA_TOUCH_MIN_BYTES) {
+        return buffer;
+    }
+    // Static schedule: thread t writes the t-th contiguous block of pages, like the static
+    // loops that later read the buffer
+    long num_pages = (long)((bytes + NUMA_PAGE_BYTES - 1) / NUMA_PAGE_BYTES);
+    #pragma omp parallel for schedule(static) num_threads(first_touch_threads)
+    for (long page = 0; page < num_pages; page++) {
+        buffer[page * NUMA_PAGE_BYTES] = 0;
+    }
+    return buffer;
+}
+
+int numa_num_nodes(void) {
+    load_topology();
+    return topology.num_nodes;
+}
+
+int numa_current_node(void) {
+    load_topology();
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && cpu < topology.num_cpus) {
+        return topology.cpu_node[cpu];
+    }
+#endif
+    return 0;
+}
+
+void numa_describe_binding(char *buffer, size_t size) {
+#ifdef _OPENMP
+    static const char *names[] = {"unbound", "true", "master", "close", "spread"};
+    int bind = (int)omp_get_proc_bind();
+    if (bind == omp_proc_bind_false) {
+        snprintf(buffer, size, "unbound");
+    } else {
+        snprintf(buffer, size, "%s over %d places", bind >= 0 && bind <= 4 ? names[bind] : "bound",
+                 omp_get_num_places());
+    }
+#else
+    snprintf(buffer, size, "unbound");
+#endif
+}
+
+int numa_replicas_create(NumaReplicas *replicas, const float *source, size_t count, int num_threads) {
+    replicas->source = source;
+    replicas->copies = NULL;
+    replicas->num_nodes = 0;
+    int num_nodes = numa_num_nodes();
+    if (num_nodes <= 1) {
+        return 0;
+    }
+
+    float **copies = (float **)calloc(num_nodes, sizeof(float *));
+    int *claimed = (int *)calloc(num_nodes, sizeof(int));
+    if (copies == NULL || claimed == NULL) {
+        free(copies);
+        free(claimed);
+        return -1;
+    }
+
+    // The first thread of every node makes that node's copy, from the node itself
+    int failed = 0;
+    #pragma omp parallel num_threads(num_threads > 0 ? num_threads : 1)
+    {
+        int node = numa_current_node();
+        int mine = 0;
+        #pragma omp critical(numa_replicas)
+        if (node >= 0 && node < num_nodes && !claimed[node]) {
+            claimed[node] = 1;
+            mine = 1;
+        }
+        if (mine) {
+            float *copy = (float *)malloc(count * sizeof(float));
+            if (copy != NULL) {
+                memcpy(copy, source, count * sizeof(float));
+            }
+            #pragma omp critical(numa_replicas)
+            {
+                copies[node] = copy;
+                failed |= copy == NULL;
+            }
+        }
+    }
+    free(claimed);
+
+    int made = 0;
+    for (int node = 0; node < num_nodes; node++) {
+        made += copies[node] != NULL;
+    }
+    replicas->copies = copies;
+    replicas->num_nodes = num_nodes;
+    if (failed) {
+        numa_replicas_free(replicas);
+        return -1;
+    }
+    return made;
+}
+
+const float *numa_replica_local(const NumaReplicas *replicas) {
+    if (replicas->num_nodes > 0) {
+        int node = numa_current_node();
+        if (node >= 0 && node < replicas->num_nodes && replicas->copies[node] != NULL) {
+            return replicas->copies[node];
+        }
+    }
+    return replicas->source;
+}
+
+void numa_replicas_free(NumaReplicas *replicas) {
+    for (int node = 0; node < replicas->num_nodes; node++) {
+        free(replicas->copies[node]);
+    }
+    free(replicas->copies);
+    replicas->copies = NULL;
+    replicas->num_nodes = 0;
+}
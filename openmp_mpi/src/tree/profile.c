@@ -0,0 +1,68 @@
+#include <string.h>
+#include <omp.h>
+
+#include "../../headers/tree/profile.h"
+
+Profile profile;
+
+void profile_init(int enabled) {
+    memset(&profile, 0, sizeof(profile));
+    profile.enabled = enabled;
+}
+
+double profile_start(void) {
+    return profile.enabled ? omp_get_wtime() : 0.0;
+}
+
+void profile_phase_end(ProfilePhase phase, double start) {
+    if (profile.enabled) {
+        profile.phase_time[phase] += omp_get_wtime() - start;
+    }
+}
+
+static int size_bucket(int num_samples) {
+    int bucket = 0;
+    while (bucket < PROFILE_SIZE_BUCKETS - 1 && (num_samples >> (bucket + 1)) > 0) {
+        bucket++;
+    }
+    return bucket;
+}
+
+void profile_node(int depth, int num_samples) {
+    if (!profile.enabled) {
+        return;
+    }
+    if (depth >= PROFILE_MAX_DEPTH) {
+        depth = PROFILE_MAX_DEPTH - 1;
+    }
+    profile.current_depth = depth;
+    profile.depths[depth].nodes++;
+    profile.depths[depth].size_hist[size_bucket(num_samples)]++;
+}
+
+void profile_step_end(ProfileStep step, double start) {
+    if (profile.enabled) {
+        profile.depths[profile.current_depth].step_time[step] += omp_get_wtime() - start;
+    }
+}
+
+void profile_thread_end(double start, int num_samples, int candidates) {
+    if (!profile.enabled) {
+        return;
+    }
+    int thread = omp_get_thread_num();
+    if (thread >= PROFILE_MAX_THREADS) {
+        return;
+    }
+    ThreadProfile *slot = &profile.threads[thread];
+    slot->sweep_time += omp_get_wtime() - start;
+    if (candidates > 0) {
+        slot->sweeps++;
+        slot->candidates += candidates;
+        slot->size_hist[size_bucket(num_samples)]++;
+    }
+}
+
+int profile_bucket_min(int bucket) {
+    return 1 << bucket;
+}
@@ -0,0 +1,213 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../headers/tree/sketch.h"
+
+/**
+ * @brief Header of a packed sketch, followed by the values of each level in order.
+ */
+typedef struct PackedSketchHeader {
+    int k;
+    int num_levels;
+    unsigned int parity;
+    int count[SKETCH_MAX_LEVELS];
+} PackedSketchHeader;
+
+typedef struct WeightedValue {
+    float value;
+    long long weight;
+} WeightedValue;
+
+static int compare_floats(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_weighted(const void *a, const void *b) {
+    return compare_floats(&((const WeightedValue *)a)->value, &((const WeightedValue *)b)->value);
+}
+
+static int grow_levels(QuantileSketch *sketch, int num_levels) {
+    if (num_levels > SKETCH_MAX_LEVELS) {
+        return -1;
+    }
+    float *items = (float *)realloc(sketch->items, (size_t)num_levels * 2 * sketch->k * sizeof(float));
+    if (items == NULL) {
+        return -1;
+    }
+    for (int h = sketch->num_levels; h < num_levels; h++) {
+        sketch->count[h] = 0;
+    }
+    sketch->items = items;
+    sketch->num_levels = num_levels;
+    return 0;
+}
+
+static int push(QuantileSketch *sketch, int level, float value);
+
+// Sorts the full level and promotes one value out of two to the next level
+static int compact(QuantileSketch *sketch, int level) {
+    int capacity = 2 * sketch->k;
+    qsort(sketch->items + (size_t)level * capacity, capacity, sizeof(float), compare_floats);
+    int offset = (sketch->parity >> level) & 1u;
+    sketch->parity ^= 1u << level;
+    // push() may compact the upper levels and move items, so the level is re-read every time
+    for (int i = offset; i < capacity; i += 2) {
+        if (push(sketch, level + 1, sketch->items[(size_t)level * capacity + i]) != 0) {
+            return -1;
+        }
+    }
+    sketch->count[level] = 0;
+    return 0;
+}
+
+static int push(QuantileSketch *sketch, int level, float value) {
+    int capacity = 2 * sketch->k;
+    if (level >= sketch->num_levels && grow_levels(sketch, level + 1) != 0) {
+        return -1;
+    }
+    if (sketch->count[level] == capacity && compact(sketch, level) != 0) {
+        return -1;
+    }
+    sketch->items[(size_t)level * capacity + sketch->count[level]++] = value;
+    return 0;
+}
+
+void sketch_init(QuantileSketch *sketch, int k) {
+    memset(sketch, 0, sizeof(*sketch));
+    sketch->k = k < 2 ? 2 : k;
+}
+
+void sketch_reset(QuantileSketch *sketch) {
+    for (int h = 0; h < sketch->num_levels; h++) {
+        sketch->count[h] = 0;
+    }
+    sketch->parity = 0;
+}
+
+void sketch_free(QuantileSketch *sketch) {
+    free(sketch->items);
+    sketch->items = NULL;
+    sketch->num_levels = 0;
+}
+
+int sketch_add(QuantileSketch *sketch, float value) {
+    if (sketch->num_levels > 0 && sketch->count[0] < 2 * sketch->k) {
+        sketch->items[sketch->count[0]++] = value;
+        return 0;
+    }
+    return push(sketch, 0, value);
+}
+
+int sketch_merge(QuantileSketch *dst, const QuantileSketch *src) {
+    int capacity = 2 * src->k;
+    for (int h = 0; h < src->num_levels; h++) {
+        for (int i = 0; i < src->count[h]; i++) {
+            if (push(dst, h, src->items[(size_t)h * capacity + i]) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+size_t sketch_packed_size(const QuantileSketch *sketch) {
+    size_t values = 0;
+    for (int h = 0; h < sketch->num_levels; h++) {
+        values += sketch->count[h];
+    }
+    return sizeof(PackedSketchHeader) + values * sizeof(float);
+}
+
+void sketch_pack(const QuantileSketch *sketch, void *buffer) {
+    PackedSketchHeader header;
+    memset(&header, 0, sizeof(header));
+    header.k = sketch->k;
+    header.num_levels = sketch->num_levels;
+    header.parity = sketch->parity;
+    memcpy(header.count, sketch->count, sketch->num_levels * sizeof(int));
+    memcpy(buffer, &header, sizeof(header));
+
+    float *values = (float *)((char *)buffer + sizeof(header));
+    for (int h = 0; h < sketch->num_levels; h++) {
+        memcpy(values, sketch->items + (size_t)h * 2 * sketch->k, sketch->count[h] * sizeof(float));
+        values += sketch->count[h];
+    }
+}
+
+size_t sketch_merge_packed(QuantileSketch *dst, const void *buffer) {
+    PackedSketchHeader header;
+    memcpy(&header, buffer, sizeof(header));
+    if (header.k != dst->k || header.num_levels < 0 || header.num_levels > SKETCH_MAX_LEVELS) {
+        return 0;
+    }
+    const char *values = (const char *)buffer + sizeof(header);
+    for (int h = 0; h < header.num_levels; h++) {
+        for (int i = 0; i < header.count[h]; i++) {
+            float value;
+            memcpy(&value, values, sizeof(float));
+            values += sizeof(float);
+            if (push(dst, h, value) != 0) {
+                return 0;
+            }
+        }
+    }
+    return (size_t)(values - (const char *)buffer);
+}
+
+int sketch_cuts(const QuantileSketch *sketch, int max_cuts, float *cuts) {
+    size_t num_values = 0;
+    for (int h = 0; h < sketch->num_levels; h++) {
+        num_values += sketch->count[h];
+    }
+    if (num_values == 0 || max_cuts <= 0) {
+        return 0;
+    }
+    WeightedValue *values = (WeightedValue *)malloc(num_values * sizeof(WeightedValue));
+    if (values == NULL) {
+        return -1;
+    }
+    size_t n = 0;
+    long long total_weight = 0;
+    for (int h = 0; h < sketch->num_levels; h++) {
+        for (int i = 0; i < sketch->count[h]; i++) {
+            values[n].value = sketch->items[(size_t)h * 2 * sketch->k + i];
+            values[n].weight = 1LL << h;
+            total_weight += values[n].weight;
+            n++;
+        }
+    }
+    qsort(values, num_values, sizeof(WeightedValue), compare_weighted);
+    float largest = values[num_values - 1].value;
+
+    int num_distinct = 1;
+    for (size_t i = 1; i < num_values && num_distinct <= max_cuts + 1; i++) {
+        num_distinct += values[i].value != values[i - 1].value;
+    }
+
+    int num_cuts = 0;
+    if (num_distinct <= max_cuts + 1) {
+        for (size_t i = 0; i < num_values; i++) {
+            if (values[i].value < largest && (num_cuts == 0 || values[i].value > cuts[num_cuts - 1])) {
+                cuts[num_cuts++] = values[i].value;
+            }
+        }
+    } else {
+        // Value at rank total_weight * (j + 1) / (max_cuts + 1) for every cut j
+        long long cumulative = 0;
+        size_t i = 0;
+        for (int j = 0; j < max_cuts; j++) {
+            long long target = total_weight * (j + 1) / (max_cuts + 1);
+            while (i < num_values - 1 && cumulative + values[i].weight < target) {
+                cumulative += values[i].weight;
+                i++;
+            }
+            float value = values[i].value;
+            if (value < largest && (num_cuts == 0 || value > cuts[num_cuts - 1])) {
+                cuts[num_cuts++] = value;
+            }
+        }
+    }
+    free(values);
+    return num_cuts;
+}
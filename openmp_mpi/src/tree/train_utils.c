@@ -6,6 +6,8 @@
 #include "../../headers/tree/train_utils.h" 
 #include "../../headers/tree/tree.h"
 #include "../../headers/tree/utils.h"
+#include "../../headers/tree/profile.h"
+#include "../../headers/tree/counters.h"
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -79,6 +81,7 @@ void merge_sort_helper(float *features, float *targets, float *temp_features, fl
 void merge_sort(float *features, float *targets, int size) {
     float *temp_features = (float *)malloc(size * sizeof(float));
     float *temp_targets = (float *)malloc(size * sizeof(float));
+    COUNTER_ADD(COUNTER_MALLOCS, 2);
     if (temp_features == NULL || temp_targets == NULL) {
         printf("Memory allocation failed\n");
         free(temp_features);
@@ -92,6 +95,40 @@ void merge_sort(float *features, float *targets, int size) {
     free(temp_targets);
 }
 
+// Stable bottom-up merge sort of values, carrying an int payload (the node position of every value)
+static void merge_sort_positions(float *values, int *positions, int size) {
+    float *temp_values = (float *)malloc((size_t)size * sizeof(float));
+    int *temp_positions = (int *)malloc((size_t)size * sizeof(int));
+    COUNTER_ADD(COUNTER_MALLOCS, 2);
+    if (temp_values == NULL || temp_positions == NULL) {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int width = 1; width < size; width *= 2) {
+        for (int left = 0; left < size - width; left += 2 * width) {
+            int mid = left + width, right = mid + width < size ? mid + width : size;
+            int i = left, j = mid, k = left;
+            while (i < mid && j < right) {
+                int take_left = values[i] <= values[j];
+                temp_values[k] = take_left ? values[i] : values[j];
+                temp_positions[k++] = take_left ? positions[i++] : positions[j++];
+            }
+            while (i < mid) {
+                temp_values[k] = values[i];
+                temp_positions[k++] = positions[i++];
+            }
+            while (j < right) {
+                temp_values[k] = values[j];
+                temp_positions[k++] = positions[j++];
+            }
+            memcpy(values + left, temp_values + left, (size_t)(right - left) * sizeof(float));
+            memcpy(positions + left, temp_positions + left, (size_t)(right - left) * sizeof(int));
+        }
+    }
+    free(temp_values);
+    free(temp_positions);
+}
+
 float compute_entropy(int *class_counts, int size, int num_classes) {
     
     float entropy = 0.0;
@@ -121,6 +158,7 @@ float* get_best_split_num_var(
 	int n_threads)
 	{
 		float* best_split = malloc(6 * sizeof(float));
+		COUNTER_ADD(COUNTER_MALLOCS, 1);
 		best_split[0] = INFINITY;  
 		best_split[1] = 0.0;
 		best_split[2] = best_split[3] = best_split[4] = best_split[5] = -1;
@@ -128,9 +166,15 @@ float* get_best_split_num_var(
 		int left_class_counts[num_classes];
 		int right_class_counts[num_classes];
 		
-		#pragma omp parallel for num_threads(n_threads) private(left_class_counts, right_class_counts)
+		#pragma omp parallel num_threads(n_threads) private(left_class_counts, right_class_counts)
+		{
+		double thread_start = profile_start();
+		int swept = 0;
+		COUNTER_LOCAL(thread_candidates);
+		#pragma omp for nowait
 		for (int i = 0; i < size - 1; i++)
 		{
+			swept++;
 
 			float avg = (sorted_array[i] + sorted_array[i + 1]) / 2;
 			int left_size = i + 1;
@@ -147,6 +191,7 @@ float* get_best_split_num_var(
 			}
 		
 			float entropy = get_entropy(left_class_counts, right_class_counts, left_size, right_size, num_classes);
+			COUNTER_LOCAL_ADD(thread_candidates, 1);
 		
 			#pragma omp critical 
 			{
@@ -164,15 +209,258 @@ float* get_best_split_num_var(
 				}
 			}
 		}
+		profile_thread_end(thread_start, size, swept);
+		COUNTER_ADD(COUNTER_CANDIDATES, thread_candidates);
+		COUNTER_ADD(COUNTER_ENTROPY_EVALS, thread_candidates);
+		}
 		
 		return best_split;
 	}
 
-void shuffle(int *array, int size) {
+float* get_best_split_weighted(const float *sorted_array, const int *target_array, const int *weight_array,
+                               int size, int num_classes) {
+	float* best_split = malloc(6 * sizeof(float));
+	COUNTER_ADD(COUNTER_MALLOCS, 1);
+	best_split[0] = INFINITY;
+	best_split[1] = 0.0;
+	best_split[2] = best_split[3] = best_split[4] = best_split[5] = -1;
+
+	int class_counts[num_classes];
+	int left_class_counts[num_classes];
+	int right_class_counts[num_classes];
+	memset(class_counts, 0, num_classes * sizeof(int));
+	memset(left_class_counts, 0, num_classes * sizeof(int));
+	int total_size = 0;
+	for (int i = 0; i < size; i++) {
+		class_counts[target_array[i]] += weight_array[i];
+		total_size += weight_array[i];
+	}
+
+	// Same candidates and tie rule as get_best_split_num_var(), with running class counts
+	int left_size = 0;
+	for (int i = 0; i < size - 1; i++) {
+		left_class_counts[target_array[i]] += weight_array[i];
+		left_size += weight_array[i];
+		int right_size = total_size - left_size;
+		float avg = (sorted_array[i] + sorted_array[i + 1]) / 2;
+		for (int k = 0; k < num_classes; k++) {
+			right_class_counts[k] = class_counts[k] - left_class_counts[k];
+		}
+
+		float entropy = get_entropy(left_class_counts, right_class_counts, left_size, right_size, num_classes);
+		if (
+			(entropy + EPSILON < best_split[0]) ||
+			(fabs(entropy - best_split[0]) < EPSILON && avg < best_split[1])
+		)
+		{
+			best_split[0] = entropy;
+			best_split[1] = avg;
+			best_split[2] = left_size;
+			best_split[3] = right_size;
+			best_split[4] = argmax(left_class_counts, num_classes);
+			best_split[5] = argmax(right_class_counts, num_classes);
+		}
+	}
+	COUNTER_ADD(COUNTER_CANDIDATES, size > 1 ? size - 1 : 0);
+	COUNTER_ADD(COUNTER_ENTROPY_EVALS, size > 1 ? size - 1 : 0);
+	return best_split;
+}
+
+// Row i of a node given either as the first rows of data or as row indices into it
+static inline const float *node_row(const float *data, const int *rows, int i, int num_columns) {
+	return data + (size_t)(rows != NULL ? rows[i] : i) * num_columns;
+}
+
+static inline int node_weight(const int *weights, int i) {
+	return weights != NULL ? weights[i] : 1;
+}
+
+float* get_random_split_num_var(const float *data, const int *rows, const int *weights, int num_rows,
+                                int num_columns, int column, int num_classes, float unit) {
+	float* split = malloc(6 * sizeof(float));
+	COUNTER_ADD(COUNTER_MALLOCS, 1);
+	split[0] = INFINITY;
+	split[1] = 0.0;
+	split[2] = split[3] = split[4] = split[5] = -1;
+	int label = num_columns - 1;
+	if (num_rows <= 0) {
+		return split;
+	}
+
+	float min = node_row(data, rows, 0, num_columns)[column], max = min;
+	for (int i = 1; i < num_rows; i++) {
+		float value = node_row(data, rows, i, num_columns)[column];
+		if (value < min) min = value;
+		if (value > max) max = value;
+	}
+	if (!(min < max)) {
+		return split;
+	}
+	// Rounding can push the threshold up to max, which would leave the right side empty
+	float threshold = min + unit * (max - min);
+	if (!(threshold < max)) {
+		threshold = min;
+	}
+
+	int left_class_counts[num_classes];
+	int right_class_counts[num_classes];
+	memset(left_class_counts, 0, num_classes * sizeof(int));
+	memset(right_class_counts, 0, num_classes * sizeof(int));
+	int left_size = 0, right_size = 0;
+	for (int i = 0; i < num_rows; i++) {
+		const float *row = node_row(data, rows, i, num_columns);
+		int weight = node_weight(weights, i);
+		if (row[column] <= threshold) {
+			left_class_counts[(int)row[label]] += weight;
+			left_size += weight;
+		} else {
+			right_class_counts[(int)row[label]] += weight;
+			right_size += weight;
+		}
+	}
+	COUNTER_ADD(COUNTER_CANDIDATES, 1);
+	COUNTER_ADD(COUNTER_ENTROPY_EVALS, 1);
+
+	split[0] = get_entropy(left_class_counts, right_class_counts, left_size, right_size, num_classes);
+	split[1] = threshold;
+	split[2] = left_size;
+	split[3] = right_size;
+	split[4] = argmax(left_class_counts, num_classes);
+	split[5] = argmax(right_class_counts, num_classes);
+	return split;
+}
+
+float* get_approx_split_num_var(const float *data, const int *rows, const int *weights, int num_rows,
+                                int num_columns, int column, int num_classes, int max_cuts, int n_threads) {
+	float* split = malloc(6 * sizeof(float));
+	COUNTER_ADD(COUNTER_MALLOCS, 1);
+	split[0] = INFINITY;
+	split[1] = 0.0;
+	split[2] = split[3] = split[4] = split[5] = -1;
+	int label = num_columns - 1;
+	if (num_rows <= 0) {
+		return split;
+	}
+
+	// One sketch per block of rows, merged in row order whatever the number of threads
+	int num_blocks = (num_rows + SKETCH_BLOCK_ROWS - 1) / SKETCH_BLOCK_ROWS;
+	QuantileSketch *sketches = malloc(num_blocks * sizeof(QuantileSketch));
+	float *cuts = malloc(max_cuts * sizeof(float));
+	int *bin_counts = calloc((size_t)(max_cuts + 1) * num_classes, sizeof(int));
+	COUNTER_ADD(COUNTER_MALLOCS, 3);
+	if (!sketches || !cuts || !bin_counts) {
+		fprintf(stderr, "Memory allocation failed!\n");
+		exit(EXIT_FAILURE);
+	}
+	int failed = 0;
+	#pragma omp parallel for num_threads(n_threads) schedule(static) reduction(|:failed)
+	for (int b = 0; b < num_blocks; b++) {
+		sketch_init(&sketches[b], max_cuts);
+		int end = (b + 1) * SKETCH_BLOCK_ROWS < num_rows ? (b + 1) * SKETCH_BLOCK_ROWS : num_rows;
+		for (int i = b * SKETCH_BLOCK_ROWS; i < end; i++) {
+			float value = node_row(data, rows, i, num_columns)[column];
+			for (int w = node_weight(weights, i); w > 0; w--) {
+				failed |= sketch_add(&sketches[b], value) != 0;
+			}
+		}
+	}
+	for (int b = 1; b < num_blocks && !failed; b++) {
+		failed |= sketch_merge(&sketches[0], &sketches[b]) != 0;
+	}
+	int num_cuts = failed ? -1 : sketch_cuts(&sketches[0], max_cuts, cuts);
+	for (int b = 0; b < num_blocks; b++) {
+		sketch_free(&sketches[b]);
+	}
+	free(sketches);
+	if (num_cuts < 0) {
+		fprintf(stderr, "Memory allocation failed!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	// Class counts of the rows falling between consecutive cuts
+	int num_bin_counts = (num_cuts + 1) * num_classes;
+	#pragma omp parallel num_threads(n_threads)
+	{
+		int thread_counts[num_bin_counts];
+		memset(thread_counts, 0, num_bin_counts * sizeof(int));
+		#pragma omp for nowait
+		for (int i = 0; i < num_rows; i++) {
+			const float *row = node_row(data, rows, i, num_columns);
+			thread_counts[sketch_cut_bin(cuts, num_cuts, row[column]) * num_classes + (int)row[label]] +=
+				node_weight(weights, i);
+		}
+		#pragma omp critical
+		for (int j = 0; j < num_bin_counts; j++) {
+			bin_counts[j] += thread_counts[j];
+		}
+	}
+
+	int class_counts[num_classes];
+	int left_class_counts[num_classes];
+	int right_class_counts[num_classes];
+	memset(class_counts, 0, num_classes * sizeof(int));
+	memset(left_class_counts, 0, num_classes * sizeof(int));
+	int total_size = 0;
+	for (int j = 0; j < num_bin_counts; j++) {
+		class_counts[j % num_classes] += bin_counts[j];
+		total_size += bin_counts[j];
+	}
+
+	// Sweep the cuts only
+	int left_size = 0;
+	for (int c = 0; c < num_cuts; c++) {
+		for (int k = 0; k < num_classes; k++) {
+			left_class_counts[k] += bin_counts[c * num_classes + k];
+			left_size += bin_counts[c * num_classes + k];
+		}
+		int right_size = total_size - left_size;
+		COUNTER_ADD(COUNTER_CANDIDATES, 1);
+		if (left_size == 0) {
+			continue;
+		}
+		if (right_size == 0) {
+			break;
+		}
+		for (int k = 0; k < num_classes; k++) {
+			right_class_counts[k] = class_counts[k] - left_class_counts[k];
+		}
+		float entropy = get_entropy(left_class_counts, right_class_counts, left_size, right_size, num_classes);
+		COUNTER_ADD(COUNTER_ENTROPY_EVALS, 1);
+		if (entropy + EPSILON < split[0]) {
+			split[0] = entropy;
+			split[1] = cuts[c];
+			split[2] = left_size;
+			split[3] = right_size;
+			split[4] = argmax(left_class_counts, num_classes);
+			split[5] = argmax(right_class_counts, num_classes);
+		}
+	}
+	free(cuts);
+	free(bin_counts);
+	return split;
+}
+
+float random_split_unit(unsigned int split_seed, int feature) {
+	unsigned int state = split_seed ^ ((unsigned int)feature * 0xC2B2AE35u);
+	// 24 random bits, so the unit is exact in a float and strictly below 1
+	return (float)(rng_next(&state) >> 7) * (1.0f / 16777216.0f);
+}
+
+int rng_next(unsigned int *state) {
+    // Counter-based generator: a Weyl sequence scrambled by the murmur3 finalizer, so
+    // that any seed (including 0) gives a good stream
+    unsigned int z = (*state += 0x9E3779B9u);
+    z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+    z ^= z >> 16;
+    return (int)(z >> 1);
+}
+
+void shuffle(int *array, int size, unsigned int *rng) {
     // Fisher-Yates shuffle algorithm
     for (int i = size - 1; i > 0; i--) {
         // Generate a random index between 0 and i (inclusive)
-        int j = rand() % (i + 1);
+        int j = rng_next(rng) % (i + 1);
         
         // Swap array[i] and array[j]
         int temp = array[i];
@@ -182,9 +470,100 @@ void shuffle(int *array, int size) {
 }
 
 
-BestSplit find_best_split_1d(float *data, int num_rows, int num_columns, 
+int sample_data_without_replacement(float *train_data, int train_size, int num_columns,
+                                    float sample_proportion, float *sampled_data, unsigned int *rng) {
+    if (train_data == NULL || sampled_data == NULL || train_size <= 0 || 
+        num_columns <= 0 || sample_proportion <= 0 || sample_proportion > 1) {
+        fprintf(stderr, "Invalid parameters for data sampling\n");
+        return -1;
+    }
+
+    int sample_size = (int)(sample_proportion * train_size);
+    if (sample_size <= 0) {
+        fprintf(stderr, "Sample size is too small\n");
+        return -1;
+    }
+
+    // Allocate and initialize index array
+    int *indices = (int *)malloc(train_size * sizeof(int));
+    if (indices == NULL) {
+        fprintf(stderr, "Failed to allocate memory for indices\n");
+        return -1;
+    }
+
+    for (int i = 0; i < train_size; i++) {
+        indices[i] = i;
+    }
+    shuffle(indices, train_size, rng);
+
+    // Copy the first sample_size rows using flat memory layout
+    for (int i = 0; i < sample_size; i++) {
+        int original_row = indices[i];
+        for (int j = 0; j < num_columns; j++) {
+            sampled_data[(size_t)i * num_columns + j] = train_data[(size_t)original_row * num_columns + j];
+        }
+    }
+
+    free(indices);
+    return sample_size;
+}
+
+int draw_bootstrap(int train_size, float sample_proportion, int replacement, int *counts, int *rows,
+                   unsigned int *rng) {
+    if (counts == NULL || rows == NULL || train_size <= 0 || sample_proportion <= 0 || sample_proportion > 1) {
+        fprintf(stderr, "Invalid parameters for data sampling\n");
+        return -1;
+    }
+
+    int sample_size = (int)(sample_proportion * train_size);
+    if (sample_size <= 0) {
+        fprintf(stderr, "Sample size is too small\n");
+        return -1;
+    }
+    memset(counts, 0, (size_t)train_size * sizeof(int));
+
+    if (replacement) {
+        int num_rows = 0;
+        for (int i = 0; i < sample_size; i++) {
+            int row = rng_next(rng) % train_size;
+            if (counts[row]++ == 0) {
+                rows[num_rows++] = row;
+            }
+        }
+        return num_rows;
+    }
+
+    // Same shuffle as sample_data_without_replacement(), keeping the indices instead of the rows
+    int *indices = (int *)malloc(train_size * sizeof(int));
+    if (indices == NULL) {
+        fprintf(stderr, "Failed to allocate memory for indices\n");
+        return -1;
+    }
+    for (int i = 0; i < train_size; i++) {
+        indices[i] = i;
+    }
+    shuffle(indices, train_size, rng);
+    for (int i = 0; i < sample_size; i++) {
+        rows[i] = indices[i];
+        counts[indices[i]] = 1;
+    }
+    free(indices);
+    return sample_size;
+}
+
+int get_num_selected_features(char *max_features, int num_features) {
+    if (strcmp(max_features, "sqrt") == 0) {
+        return (int) sqrt(num_features);
+    } else if (strcmp(max_features, "log2") == 0) {
+        return (int) (log(num_features) / log(2));
+    }
+    return atoi(max_features);
+}
+
+BestSplit find_best_split_1d(float *data, const int *rows, const int *weights, int num_rows, int num_columns,
                           int num_classes, int *class_pred_left, int *class_pred_right,
-                          int *best_size_left, int *best_size_right, char *max_features, int num_threads) 
+                          int *best_size_left, int *best_size_right, char *max_features, int splitter,
+                          int num_threads, unsigned int *rng) 
 						{
     BestSplit best_split = {INFINITY, 0.0, -1};
     int target_column = num_columns - 1;  // Assuming target column is the last one
@@ -194,13 +573,7 @@ BestSplit find_best_split_1d(float *data, int num_rows, int num_columns,
     int num_selected_features = 0;
 
     // Handle different max_features scenarios
-    if (strcmp(max_features, "sqrt") == 0) {
-        num_selected_features = (int) sqrt(features_to_consider);
-    } else if (strcmp(max_features, "log2") == 0) {
-        num_selected_features = (int) (log(features_to_consider) / log(2));
-    } else {
-        num_selected_features = atoi(max_features);
-    }
+    num_selected_features = get_num_selected_features(max_features, features_to_consider);
     
     // Create a list of feature indices to consider    
     for (int i = 0; i < features_to_consider; i++) {
@@ -208,7 +581,10 @@ BestSplit find_best_split_1d(float *data, int num_rows, int num_columns,
     }
     
     // Randomly shuffle all features 
-    shuffle(selected_features, features_to_consider);
+    shuffle(selected_features, features_to_consider, rng);
+
+    // The random thresholds of the node come from a single draw (see random_split_unit())
+    unsigned int split_seed = splitter == SPLITTER_RANDOM ? (unsigned int)rng_next(rng) : 0;
 
     // Loop over the first num_selected_features columns which were randomized
     for (int i = 0; i < num_selected_features; i++) {
@@ -217,25 +593,82 @@ BestSplit find_best_split_1d(float *data, int num_rows, int num_columns,
         if (feature_col == target_column){ 
             fprintf(stderr, "Error in function best_split you have selected the feature column\n");
             exit(EXIT_FAILURE);}
-        // Allocate arrays for sorting
-        float *feature_values = malloc(num_rows * sizeof(float));
-        float *target_values = malloc(num_rows * sizeof(float));
-        if (!feature_values || !target_values) {
-            fprintf(stderr, "Memory allocation failed!\n");
-            exit(EXIT_FAILURE);
-        }
 
-        // Extract feature column and corresponding target values from 1D array
-        for (int j = 0; j < num_rows; j++) {
-            feature_values[j] = data[j * num_columns + feature_col];
-            target_values[j] = data[j * num_columns + target_column];
-        }
+        float *feature_best_split;
+        if (splitter == SPLITTER_RANDOM) {
+            double search_start = profile_start();
+            feature_best_split = get_random_split_num_var(data, rows, weights, num_rows, num_columns, feature_col,
+                                                          num_classes, random_split_unit(split_seed, feature_col));
+            profile_step_end(STEP_SEARCH, search_start);
+        } else if (splitter == SPLITTER_APPROX && num_rows > APPROX_MIN_ROWS) {
+            double search_start = profile_start();
+            feature_best_split = get_approx_split_num_var(data, rows, weights, num_rows, num_columns, feature_col,
+                                                          num_classes, SKETCH_DEFAULT_K, num_threads);
+            profile_step_end(STEP_SEARCH, search_start);
+        } else if (weights != NULL) {
+            double sort_start = profile_start();
+
+            // Sort the values with their node positions, then gather classes and weights in that order
+            float *feature_values = (float *)malloc(num_rows * sizeof(float));
+            int *positions = (int *)malloc(num_rows * sizeof(int));
+            int *target_values = (int *)malloc(num_rows * sizeof(int));
+            int *weight_values = (int *)malloc(num_rows * sizeof(int));
+            COUNTER_ADD(COUNTER_MALLOCS, 4);
+            if (!feature_values || !positions || !target_values || !weight_values) {
+                fprintf(stderr, "Memory allocation failed!\n");
+                exit(EXIT_FAILURE);
+            }
+            for (int j = 0; j < num_rows; j++) {
+                feature_values[j] = node_row(data, rows, j, num_columns)[feature_col];
+                positions[j] = j;
+            }
+            merge_sort_positions(feature_values, positions, num_rows);
+            for (int j = 0; j < num_rows; j++) {
+                target_values[j] = (int)node_row(data, rows, positions[j], num_columns)[target_column];
+                weight_values[j] = weights[positions[j]];
+            }
+            profile_step_end(STEP_SORT, sort_start);
 
-        // Sort the feature and target values together
-        merge_sort(feature_values, target_values, num_rows);
+            double search_start = profile_start();
+            feature_best_split = get_best_split_weighted(feature_values, target_values, weight_values, num_rows,
+                                                         num_classes);
+            profile_step_end(STEP_SEARCH, search_start);
 
-        // Find best split for this feature
-        float *feature_best_split = get_best_split_num_var(feature_values, target_values, num_rows, num_classes, num_threads);
+            free(feature_values);
+            free(positions);
+            free(target_values);
+            free(weight_values);
+        } else {
+            double sort_start = profile_start();
+
+            // Allocate arrays for sorting
+            float *feature_values = (float *)malloc(num_rows * sizeof(float));
+            float *target_values = (float *)malloc(num_rows * sizeof(float));
+            COUNTER_ADD(COUNTER_MALLOCS, 2);
+            if (!feature_values || !target_values) {
+                fprintf(stderr, "Memory allocation failed!\n");
+                exit(EXIT_FAILURE);
+            }
+
+            // Extract feature column and corresponding target values from 1D array
+            for (int j = 0; j < num_rows; j++) {
+                const float *row = node_row(data, rows, j, num_columns);
+                feature_values[j] = row[feature_col];
+                target_values[j] = row[target_column];
+            }
+
+            // Sort the feature and target values together
+            merge_sort(feature_values, target_values, num_rows);
+            profile_step_end(STEP_SORT, sort_start);
+
+            // Find best split for this feature
+            double search_start = profile_start();
+            feature_best_split = get_best_split_num_var(feature_values, target_values, num_rows, num_classes, num_threads);
+            profile_step_end(STEP_SEARCH, search_start);
+
+            free(feature_values);
+            free(target_values);
+        }
         
         // Update the global best split if a lower entropy is found
         if (feature_best_split[0] < best_split.entropy) {
@@ -250,8 +683,6 @@ BestSplit find_best_split_1d(float *data, int num_rows, int num_columns,
 
         // Free allocated memory
         free(feature_best_split);
-        free(feature_values);
-        free(target_values);
     }
 
     return best_split;
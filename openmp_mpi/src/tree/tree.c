@@ -14,10 +14,15 @@
 
 #include "../../headers/tree/tree.h"
 #include "../../headers/tree/train_utils.h"
+#include "../../headers/tree/utils.h"
+#include "../../headers/tree/profile.h"
+#include "../../headers/tree/counters.h"
 
 // Node creation function (remains unchanged)
 Node *create_node(int feature, float threshold, Node *left, Node *right, int pred, int depth, float entropy, int num_samples) {
     Node *node = (Node *)malloc(sizeof(Node));
+    COUNTER_ADD(COUNTER_MALLOCS, 1);
+    COUNTER_ADD(COUNTER_NODES, 1);
     node->feature = feature;
     node->threshold = threshold;
     node->left = left;
@@ -30,8 +35,15 @@ Node *create_node(int feature, float threshold, Node *left, Node *right, int pre
 }
 
 void grow_tree_1d(Node *parent, float *data, int num_columns, int num_classes, 
-               int max_depth, int min_samples_split, char* max_features, int n_threads) {
-    if (parent->num_samples < min_samples_split || parent->depth >= max_depth) {
+               int max_depth, int min_samples_split, char* max_features, int splitter, int n_threads,
+               unsigned int *rng) {
+    profile_node(parent->depth, parent->num_samples);
+    if (parent->num_samples < min_samples_split) {
+        COUNTER_ADD(COUNTER_LEAVES_MIN_SAMPLES, 1);
+        return;
+    }
+    if (parent->depth >= max_depth) {
+        COUNTER_ADD(COUNTER_LEAVES_MAX_DEPTH, 1);
         return;
     }
     
@@ -40,24 +52,28 @@ void grow_tree_1d(Node *parent, float *data, int num_columns, int num_classes,
     int best_class_pred_left = -1;
     int best_class_pred_right = -1;
     
-    BestSplit best_split = find_best_split_1d(data, parent->num_samples, num_columns, num_classes, 
+    BestSplit best_split = find_best_split_1d(data, NULL, NULL, parent->num_samples, num_columns, num_classes, 
                                            &best_class_pred_left, &best_class_pred_right, 
-                                           &best_size_left, &best_size_right, max_features, n_threads);
+                                           &best_size_left, &best_size_right, max_features, splitter, n_threads, rng);
     
     if (best_split.entropy >= parent->entropy) {
+        COUNTER_ADD(COUNTER_LEAVES_NO_GAIN, 1);
         return;
     }
     // Allocate memory for left and right datasets
-    float *left_data = (float *)malloc(parent->num_samples * num_columns * sizeof(float));
-    float *right_data = (float *)malloc(parent->num_samples * num_columns * sizeof(float));
+    float *left_data = (float *)malloc((size_t)parent->num_samples * num_columns * sizeof(float));
+    float *right_data = (float *)malloc((size_t)parent->num_samples * num_columns * sizeof(float));
+    COUNTER_ADD(COUNTER_MALLOCS, 2);
  
 	// qua c'è da fare lo split safe in caso
     
     int actual_left_size = 0, actual_right_size = 0;
 
     // Split the data
+    double partition_start = profile_start();
     split_data_1d_safe(data, left_data, right_data, parent->num_samples, num_columns, 
                 best_split.feature_index, best_split.threshold, &actual_left_size, &actual_right_size);
+    profile_step_end(STEP_PARTITION, partition_start);
     
     // Update parent node
     parent->feature = best_split.feature_index;
@@ -72,15 +88,91 @@ void grow_tree_1d(Node *parent, float *data, int num_columns, int num_classes,
     
     // Recursively grow the tree
     grow_tree_1d(parent->left, left_data, num_columns, num_classes, 
-              max_depth, min_samples_split, max_features, n_threads);
+              max_depth, min_samples_split, max_features, splitter, n_threads, rng);
     grow_tree_1d(parent->right, right_data, num_columns, num_classes, 
-               max_depth, min_samples_split, max_features, n_threads);
+               max_depth, min_samples_split, max_features, splitter, n_threads, rng);
     
     // Free memory
     free(left_data);
     free(right_data);
 }
 
+// Same as grow_tree_1d(), on a node given as rows of the shared training matrix with their
+// bootstrap counts; children get new index slices instead of copies of their rows
+static void grow_tree_weighted(Node *parent, const float *data, const int *rows, const int *weights, int num_rows,
+                               int num_columns, int num_classes, int max_depth, int min_samples_split,
+                               char *max_features, int splitter, int n_threads, unsigned int *rng) {
+    profile_node(parent->depth, parent->num_samples);
+    if (parent->num_samples < min_samples_split) {
+        COUNTER_ADD(COUNTER_LEAVES_MIN_SAMPLES, 1);
+        return;
+    }
+    if (parent->depth >= max_depth) {
+        COUNTER_ADD(COUNTER_LEAVES_MAX_DEPTH, 1);
+        return;
+    }
+
+    int best_size_left = 0;
+    int best_size_right = 0;
+    int best_class_pred_left = -1;
+    int best_class_pred_right = -1;
+
+    BestSplit best_split = find_best_split_1d((float *)data, rows, weights, num_rows, num_columns, num_classes,
+                                              &best_class_pred_left, &best_class_pred_right,
+                                              &best_size_left, &best_size_right, max_features, splitter,
+                                              n_threads, rng);
+
+    if (best_split.entropy >= parent->entropy) {
+        COUNTER_ADD(COUNTER_LEAVES_NO_GAIN, 1);
+        return;
+    }
+    int *left_rows = (int *)malloc((size_t)num_rows * 2 * sizeof(int));
+    int *right_rows = (int *)malloc((size_t)num_rows * 2 * sizeof(int));
+    COUNTER_ADD(COUNTER_MALLOCS, 2);
+    if (left_rows == NULL || right_rows == NULL) {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+    // Weights follow the rows in the second half of each buffer
+    int *left_weights = left_rows + num_rows;
+    int *right_weights = right_rows + num_rows;
+
+    // Stable partition of the node's rows, as split_data_1d_safe() does for copies
+    double partition_start = profile_start();
+    int num_left = 0, num_right = 0;
+    for (int i = 0; i < num_rows; i++) {
+        int row = rows[i];
+        int weight = weights != NULL ? weights[i] : 1;
+        if (data[(size_t)row * num_columns + best_split.feature_index] <= best_split.threshold) {
+            left_rows[num_left] = row;
+            left_weights[num_left++] = weight;
+        } else {
+            right_rows[num_right] = row;
+            right_weights[num_right++] = weight;
+        }
+    }
+    profile_step_end(STEP_PARTITION, partition_start);
+
+    parent->feature = best_split.feature_index;
+    parent->threshold = best_split.threshold;
+    parent->entropy = best_split.entropy;
+
+    parent->left = create_node(-1, -1, NULL, NULL, best_class_pred_left,
+                               parent->depth + 1, INFINITY, best_size_left);
+    parent->right = create_node(-1, -1, NULL, NULL, best_class_pred_right,
+                                parent->depth + 1, INFINITY, best_size_right);
+
+    grow_tree_weighted(parent->left, data, left_rows, weights != NULL ? left_weights : NULL, num_left,
+                       num_columns, num_classes, max_depth, min_samples_split, max_features, splitter,
+                       n_threads, rng);
+    grow_tree_weighted(parent->right, data, right_rows, weights != NULL ? right_weights : NULL, num_right,
+                       num_columns, num_classes, max_depth, min_samples_split, max_features, splitter,
+                       n_threads, rng);
+
+    free(left_rows);
+    free(right_rows);
+}
+
 void split_data_1d(float *data, float *left_data, float *right_data, 
                   int num_rows, int num_columns, int feature_index, float threshold) {
     int actual_left_size, actual_right_size;
@@ -93,9 +185,104 @@ void split_data_1d(float *data, float *left_data, float *right_data,
 
 // Refactored train_tree function for 1D array data
 void train_tree_1d(Tree *tree, float *data, int num_rows, int num_columns, int num_classes, 
-                int max_depth, int min_samples_split, char* max_features, int num_threads) {
-    tree->root = create_node(-1, -1000, NULL, NULL, -1, 0, 1000, num_rows);
-    grow_tree_1d(tree->root, data, num_columns, num_classes, max_depth, min_samples_split, max_features, num_threads);
+                int max_depth, int min_samples_split, char* max_features, int splitter, int num_threads,
+                unsigned int *rng) {
+    Node *root = create_node(-1, -1000, NULL, NULL, -1, 0, 1000, num_rows);
+    grow_tree_1d(root, data, num_columns, num_classes, max_depth, min_samples_split, max_features, splitter, num_threads, rng);
+    counters_merge();
+    if (tree_from_nodes(tree, root) != 0) {
+        fprintf(stderr, "Failed to flatten the tree in train_tree_1d!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void train_tree_weighted(Tree *tree, const float *data, int num_columns, const int *rows, const int *counts,
+                         int num_rows, int num_classes, int max_depth, int min_samples_split, char *max_features,
+                         int splitter, int num_threads, unsigned int *rng) {
+    // Unit counts keep the unweighted search, which then matches train_tree_1d() on the copied rows
+    int *weights = NULL;
+    int num_samples = num_rows;
+    for (int i = 0; i < num_rows && weights == NULL; i++) {
+        if (counts[rows[i]] != 1) {
+            weights = (int *)malloc((size_t)num_rows * sizeof(int));
+            COUNTER_ADD(COUNTER_MALLOCS, 1);
+            if (weights == NULL) {
+                fprintf(stderr, "Memory allocation failed!\n");
+                exit(EXIT_FAILURE);
+            }
+            num_samples = 0;
+            for (int j = 0; j < num_rows; j++) {
+                weights[j] = counts[rows[j]];
+                num_samples += weights[j];
+            }
+        }
+    }
+
+    Node *root = create_node(-1, -1000, NULL, NULL, -1, 0, 1000, num_samples);
+    grow_tree_weighted(root, data, rows, weights, num_rows, num_columns, num_classes, max_depth,
+                       min_samples_split, max_features, splitter, num_threads, rng);
+    free(weights);
+    counters_merge();
+    if (tree_from_nodes(tree, root) != 0) {
+        fprintf(stderr, "Failed to flatten the tree in train_tree_weighted!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static int count_grown_nodes(const Node *node) {
+    if (node == NULL) return 0;
+    return 1 + count_grown_nodes(node->left) + count_grown_nodes(node->right);
+}
+
+// Writes node at index at; its children go to the next free pair of slots
+static int flatten_grown_node(const Node *node, Tree *tree, int at, int *next) {
+    int leaf = node->left == NULL || node->right == NULL;
+    if (!leaf && (node->feature < 0 || node->feature > TREE_MAX_FEATURE)) {
+        return -1;
+    }
+    HotNode *hot = &tree->nodes[at];
+    hot->threshold = node->threshold;
+    hot->feature = leaf ? TREE_LEAF : (int16_t)node->feature;
+    hot->reserved = 0;
+    tree->stats[at].entropy = node->entropy;
+    tree->stats[at].depth = node->depth;
+    tree->stats[at].num_samples = node->num_samples;
+    if (leaf) {
+        hot->child = node->pred;
+        return 0;
+    }
+    int pair = *next;
+    *next += 2;
+    hot->child = pair;
+    if (flatten_grown_node(node->left, tree, pair, next) != 0) {
+        return -1;
+    }
+    return flatten_grown_node(node->right, tree, pair + 1, next);
+}
+
+int tree_from_nodes(Tree *tree, Node *root) {
+    tree->nodes = NULL;
+    tree->stats = NULL;
+    tree->num_nodes = 0;
+    if (root == NULL) {
+        return 0;
+    }
+
+    int num_nodes = count_grown_nodes(root);
+    tree->nodes = (HotNode *)malloc((size_t)num_nodes * sizeof(HotNode));
+    tree->stats = (NodeStats *)malloc((size_t)num_nodes * sizeof(NodeStats));
+    int next = 1;
+    if (!tree->nodes || !tree->stats || flatten_grown_node(root, tree, 0, &next) != 0) {
+        free(tree->nodes);
+        free(tree->stats);
+        tree->nodes = NULL;
+        tree->stats = NULL;
+        return -1;
+    }
+    // Pruned leaves (a node with one child) are not stored, so next can be below num_nodes
+    tree->num_nodes = next;
+    destroy_node(root);
+    return 0;
 }
 
 // Refactored tree_inference function for 1D array data
@@ -106,27 +293,144 @@ int* tree_inference_1d(Tree *tree, float *data, int num_rows, int num_columns) {
         exit(EXIT_FAILURE);
     }
    
+    const HotNode *nodes = tree->nodes;
     for (int i = 0; i < num_rows; i++) {
-        Node *current_node = tree->root;
-        while (current_node->left != NULL && current_node->right != NULL) {
-            int feature_pos = i * num_columns + current_node->feature;
-            if (data[feature_pos] <= current_node->threshold) {
-                current_node = current_node->left;
+        const float *row = data + (size_t)i * num_columns;
+        const HotNode *node = nodes;
+        while (node->feature != TREE_LEAF) {
+            if (row[node->feature] <= node->threshold) {
+                node = nodes + node->child;
             } else {
-                current_node = current_node->right;
+                node = nodes + node->child + 1;
             }
         }
-        predictions[i] = current_node->pred;
+        predictions[i] = node->child;
     }
     
     return predictions;
 }
 
+void tree_inference_votes_1d(Tree *tree, float *data, int num_rows, int num_columns, int num_classes, vote_t *votes) {
+    const HotNode *nodes = tree->nodes;
+    for (int i = 0; i < num_rows; i++) {
+        const float *row = data + (size_t)i * num_columns;
+        const HotNode *node = nodes;
+        while (node->feature != TREE_LEAF) {
+            if (row[node->feature] <= node->threshold) {
+                node = nodes + node->child;
+            } else {
+                node = nodes + node->child + 1;
+            }
+        }
+        int pred = node->child;
+        if (pred >= 0 && pred < num_classes) {
+            votes[i * num_classes + pred]++;
+        }
+    }
+}
+
+// The leader keeps the prediction if no class can reach it (or tie it from a lower index)
+static int vote_is_decided(const int *votes, int num_classes, int leader, int remaining) {
+    for (int c = 0; c < num_classes; c++) {
+        if (c == leader) {
+            continue;
+        }
+        int best_case = votes[c] + remaining;
+        if (best_case > votes[leader] || (best_case == votes[leader] && c < leader)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+long long forest_predict_early_exit_1d(Tree *trees, const int *order, int num_trees, float *data, int num_rows,
+                                       int num_columns, int num_classes, int *predictions) {
+    int *votes = (int *)malloc(num_classes * sizeof(int));
+    if (!votes) {
+        fprintf(stderr, "Memory allocation failed in forest_predict_early_exit_1d!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    long long evaluated = 0;
+    for (int i = 0; i < num_rows; i++) {
+        const float *row = data + (size_t)i * num_columns;
+        for (int c = 0; c < num_classes; c++) {
+            votes[c] = 0;
+        }
+        int leader = 0;
+        int t = 0;
+        while (t < num_trees) {
+            int pred = tree_predict_row(&trees[order ? order[t] : t], row);
+            t++;
+            if (pred < 0 || pred >= num_classes) {
+                continue;
+            }
+            votes[pred]++;
+            if (votes[pred] > votes[leader] || (votes[pred] == votes[leader] && pred < leader)) {
+                leader = pred;
+            }
+            if (vote_is_decided(votes, num_classes, leader, num_trees - t)) {
+                break;
+            }
+        }
+        evaluated += t;
+        predictions[i] = leader;
+    }
+
+    free(votes);
+    return evaluated;
+}
+
+void order_trees_by_agreement(Tree *trees, int num_trees, float *data, int num_rows, int num_columns,
+                              int num_classes, int *order) {
+    vote_t *votes = (vote_t *)calloc((size_t)num_rows * num_classes, sizeof(vote_t));
+    int *majority = (int *)malloc((num_rows > 0 ? num_rows : 1) * sizeof(int));
+    int *agreement = (int *)calloc(num_trees, sizeof(int));
+    if (!votes || !majority || !agreement) {
+        fprintf(stderr, "Memory allocation failed in order_trees_by_agreement!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int t = 0; t < num_trees; t++) {
+        tree_inference_votes_1d(&trees[t], data, num_rows, num_columns, num_classes, votes);
+    }
+    for (int i = 0; i < num_rows; i++) {
+        const vote_t *row_votes = votes + (size_t)i * num_classes;
+        int best = 0;
+        for (int c = 1; c < num_classes; c++) {
+            if (row_votes[c] > row_votes[best]) {
+                best = c;
+            }
+        }
+        majority[i] = best;
+    }
+    for (int t = 0; t < num_trees; t++) {
+        for (int i = 0; i < num_rows; i++) {
+            agreement[t] += tree_predict_row(&trees[t], data + (size_t)i * num_columns) == majority[i];
+        }
+    }
+
+    // Stable insertion sort by decreasing agreement
+    for (int t = 0; t < num_trees; t++) {
+        int j = t;
+        while (j > 0 && agreement[order[j - 1]] < agreement[t]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = t;
+    }
+
+    free(votes);
+    free(majority);
+    free(agreement);
+}
+
 void split_data_1d_safe(float *data, float *left_data, float *right_data, 
                        int num_rows, int num_columns, int feature_index, float threshold,
                        int *actual_left_size, int *actual_right_size) {
     int left_index = 0;
     int right_index = 0;
+    COUNTER_ADD(COUNTER_BYTES_COPIED, (long long)num_rows * num_columns * sizeof(float));
     
     for (int i = 0; i < num_rows; i++) {
         // Calculate position of the feature value in the 1D array
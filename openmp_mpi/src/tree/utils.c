@@ -11,11 +11,12 @@
 #include <stdio.h>
 #include <dirent.h>    
 #include <string.h>     
+#include <limits.h>
 #include "../../headers/tree/utils.h"
 #include "../../headers/tree/tree.h"
 #include "../../headers/tree/train_utils.h"
+#include "../../headers/tree/memory_ser.h"
 
-#include <mpi.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -40,22 +41,33 @@ void get_class_pred(float** data, int num_rows, int num_columns, int num_classes
 }
 
 /**
- * @brief Recursively frees memory allocated for the nodes and the tree itself.
+ * @brief Frees the node arrays of a tree, logging the destruction.
  */
 void destroy_tree(Tree *tree) {
     if (tree == NULL) return;
-    if (tree->root == NULL) return;
+    if (tree->nodes == NULL) return;
     
-    printf("Destroying tree with root at %p\n", tree->root);
+    printf("Destroying tree with nodes at %p\n", (void *)tree->nodes);
     fflush(stdout);
     
-    destroy_node(tree->root);
-    tree->root = NULL;  // Prevent double-free
+    free_tree(tree);
     
     printf("Tree destruction completed\n");
     fflush(stdout);
 }
 
+/**
+ * @brief Frees the node arrays of a tree and marks it empty.
+ */
+void free_tree(Tree *tree) {
+    if (tree == NULL) return;
+    free(tree->nodes);
+    free(tree->stats);
+    tree->nodes = NULL;  // Prevent double-free
+    tree->stats = NULL;
+    tree->num_nodes = 0;
+}
+
 /**
  * @brief Recursively frees memory allocated for a node and its children.
  */
@@ -79,12 +91,26 @@ void destroy_node(Node *node) {
 }
 
 
+static void print_flat_node(const Tree *tree, int index) {
+    const HotNode *node = &tree->nodes[index];
+    int leaf = node->feature == TREE_LEAF;
+    // Trees loaded from a model file or compacted have no statistics
+    printf("Feature: %d, Threshold: %.6f, Value: %d, Num samples: %d\n", node->feature, node->threshold,
+           leaf ? node->child : -1, tree->stats ? tree->stats[index].num_samples : -1);
+    if (!leaf) {
+        print_flat_node(tree, node->child);
+        print_flat_node(tree, node->child + 1);
+    }
+}
+
 /**
  * @brief Prints the structure and contents of a tree.
  */
 void print_tree(Tree *tree) {
     printf("Printing tree\n");
-    print_node(tree->root);
+    if (tree->num_nodes > 0) {
+        print_flat_node(tree, 0);
+    }
 };
 
 /**
@@ -97,6 +123,90 @@ void print_node(Node *node) {
     print_node(node->right);
 };
 
+// Turns into leaves, in place, the nodes whose two children are leaves with the same class.
+// The subtrees below them become unreachable; compact_tree() drops them. Returns 1 for a leaf.
+static int collapse_node(HotNode *nodes, int index) {
+    HotNode *node = &nodes[index];
+    if (node->feature == TREE_LEAF) {
+        return 1;
+    }
+    int left_leaf = collapse_node(nodes, node->child);
+    int right_leaf = collapse_node(nodes, node->child + 1);
+    if (left_leaf && right_leaf && nodes[node->child].child == nodes[node->child + 1].child) {
+        node->feature = TREE_LEAF;
+        node->threshold = -1;
+        node->child = nodes[node->child].child;
+        return 1;
+    }
+    return 0;
+}
+
+// Copies the reachable subtree of src at src_index to dst at dst_index, children in the next free pair
+static void copy_reachable(const Tree *src, int src_index, Tree *dst, int dst_index, int *next) {
+    HotNode node = src->nodes[src_index];
+    if (node.feature != TREE_LEAF) {
+        int pair = *next;
+        *next += 2;
+        copy_reachable(src, node.child, dst, pair, next);
+        copy_reachable(src, node.child + 1, dst, pair + 1, next);
+        node.child = pair;
+    }
+    dst->nodes[dst_index] = node;
+}
+
+static int depth_below(const HotNode *nodes, int index) {
+    if (nodes[index].feature == TREE_LEAF) return 0;
+    int left = depth_below(nodes, nodes[index].child);
+    int right = depth_below(nodes, nodes[index].child + 1);
+    return 1 + (left > right ? left : right);
+}
+
+long long tree_memory_bytes(const Tree *tree) {
+    if (tree == NULL) return 0;
+    return (long long)tree->num_nodes * (long long)(sizeof(HotNode) + (tree->stats ? sizeof(NodeStats) : 0));
+}
+
+int tree_depth(const Tree *tree) {
+    if (tree == NULL || tree->num_nodes == 0) return 0;
+    return depth_below(tree->nodes, 0);
+}
+
+void compact_tree(Tree *tree, CompactionStats *stats) {
+    if (tree == NULL || tree->num_nodes == 0) return;
+    long long nodes_before = tree->num_nodes;
+    long long bytes_before = tree_memory_bytes(tree);
+    int depth_before = stats ? tree_depth(tree) : 0;
+
+    collapse_node(tree->nodes, 0);
+
+    // Same layout as tree_from_nodes(), without the collapsed subtrees and without the
+    // training statistics, which described the nodes before the collapse
+    Tree compacted;
+    compacted.nodes = (HotNode *)malloc((size_t)tree->num_nodes * sizeof(HotNode));
+    compacted.stats = NULL;
+    if (compacted.nodes != NULL) {
+        int next = 1;
+        copy_reachable(tree, 0, &compacted, 0, &next);
+        compacted.num_nodes = next;
+        free_tree(tree);
+        *tree = compacted;
+    } else {
+        // The collapsed tree is still valid, only its dead nodes stay allocated
+        free(tree->stats);
+        tree->stats = NULL;
+    }
+
+    if (stats) {
+        int depth_after = tree_depth(tree);
+        stats->nodes_before += nodes_before;
+        stats->nodes_after += tree->num_nodes;
+        stats->bytes_before += bytes_before;
+        stats->bytes_after += tree_memory_bytes(tree);
+        if (depth_before > stats->depth_before) stats->depth_before = depth_before;
+        if (depth_after > stats->depth_after) stats->depth_after = depth_after;
+    }
+}
+
 /**
  * @brief Saves an array of predictions to a file, one per line.
  *
@@ -144,7 +254,8 @@ void serialize_node(Node *node, FILE *fp) {
 }
 
 /**
- * @brief Serializes a decision tree to a binary file.
+ * @brief Serializes a decision tree to a binary file, in the serialize_tree_to_buffer() format
+ * without the training statistics.
  */
 void serialize_tree(Tree *tree, const char *filename) {
     FILE *fp = fopen(filename, "wb");
@@ -153,7 +264,14 @@ void serialize_tree(Tree *tree, const char *filename) {
         exit(EXIT_FAILURE);
     }
 
-    serialize_node(tree->root, fp);
+    void *buffer = NULL;
+    int size = 0;
+    serialize_tree_to_buffer(tree, 0, &buffer, &size);
+    if (fwrite(buffer, 1, size, fp) != (size_t)size) {
+        perror("Error writing tree");
+        exit(EXIT_FAILURE);
+    }
+    free(buffer);
     fclose(fp);
 }
 
@@ -189,28 +307,103 @@ Node *deserialize_node(FILE *fp) {
     return node;
 }
 
+// Marker format of serialize_node(). Returns 0 with *out set (NULL for a missing child), or -1
+// if the file ends early or memory runs out, with nothing left allocated.
+static int read_marked_node(FILE *fp, Node **out) {
+    *out = NULL;
+    int marker;
+    if (fread(&marker, sizeof(int), 1, fp) != 1) {
+        return -1;
+    }
+    if (marker == -1) {
+        return 0;
+    }
+
+    Node *node = malloc(sizeof(Node));
+    if (!node) {
+        return -1;
+    }
+    node->left = NULL;
+    node->right = NULL;
+    if (fread(&node->feature, sizeof(int), 1, fp) != 1 || fread(&node->threshold, sizeof(float), 1, fp) != 1 ||
+        fread(&node->pred, sizeof(int), 1, fp) != 1 || fread(&node->entropy, sizeof(float), 1, fp) != 1 ||
+        fread(&node->depth, sizeof(int), 1, fp) != 1 || fread(&node->num_samples, sizeof(int), 1, fp) != 1) {
+        free(node);
+        return -1;
+    }
+    if (read_marked_node(fp, &node->left) != 0 || read_marked_node(fp, &node->right) != 0) {
+        destroy_node(node);
+        return -1;
+    }
+    *out = node;
+    return 0;
+}
+
 /**
- * @brief Deserializes a tree structure from a binary file.
- *
- * @param filename  Path to the binary file.
- * @return Pointer to the reconstructed Tree structure.
+ * @brief Loads a tree from a binary file without exiting on errors.
  */
-Tree *deserialize_tree(const char *filename) {
+int load_tree_file(const char *filename, Tree *tree) {
+    tree->nodes = NULL;
+    tree->stats = NULL;
+    tree->num_nodes = 0;
+
     FILE *fp = fopen(filename, "rb");
     if (!fp) {
         perror("Error opening file to load tree");
-        exit(EXIT_FAILURE);
+        return -1;
     }
 
+    // Files written by serialize_tree() start with a tree format magic; the ones of the
+    // other builds hold the marker format of serialize_node()
+    int status = -1;
+    int magic = 0;
+    if (fread(&magic, sizeof(int), 1, fp) == 1 && (magic == TREE_FORMAT_MAGIC || magic == TREE_FORMAT_MAGIC_HOT)) {
+        long size = 0;
+        void *buffer = NULL;
+        if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) > 0 && size <= INT_MAX && fseek(fp, 0, SEEK_SET) == 0 &&
+            (buffer = malloc(size)) != NULL && fread(buffer, 1, size, fp) == (size_t)size) {
+            status = deserialize_tree_from_buffer(buffer, (int)size, tree);
+        }
+        free(buffer);
+    } else {
+        Node *root = NULL;
+        rewind(fp);
+        if (read_marked_node(fp, &root) == 0) {
+            status = tree_from_nodes(tree, root);
+            if (status != 0) {
+                destroy_node(root);
+            }
+        }
+    }
+    fclose(fp);
+
+    // A saved model never holds an empty tree, and inference expects a root
+    if (status == 0 && tree->num_nodes == 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        fprintf(stderr, "Malformed tree file %s\n", filename);
+        free_tree(tree);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Deserializes a tree structure from a binary file.
+ *
+ * @param filename  Path to the binary file.
+ * @return Pointer to the reconstructed Tree structure.
+ */
+Tree *deserialize_tree(const char *filename) {
     Tree *tree = malloc(sizeof(Tree));
     if (!tree) {
         perror("Error allocating memory for tree");
-        fclose(fp);
         exit(EXIT_FAILURE);
     }
-
-    tree->root = deserialize_node(fp);
-    fclose(fp);
+    if (load_tree_file(filename, tree) != 0) {
+        exit(EXIT_FAILURE);
+    }
     return tree;
 }
 
@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include "../headers/utils.h"
+#include "../headers/tree/numa.h"
+#include "../headers/tree/train_utils.h"
 #include <sys/stat.h>
 
 int parse_arguments(int argc, char *argv[], int *max_matrix_rows_print, int *num_classes, int *num_trees,
@@ -62,6 +64,141 @@ int parse_arguments(int argc, char *argv[], int *max_matrix_rows_print, int *num
     return 0;  // Return 0 if everything is parsed successfully
 }
 
+int parse_run_options(int argc, char *argv[], RunOptions *options) {
+    options->shared_memory = 0;
+    options->dynamic_schedule = 0;
+    options->parallelism = PARALLELISM_TREE;
+    options->num_bins = 64;
+    options->pipeline = 0;
+    options->checkpoint_path = NULL;
+    options->resume = 0;
+    options->profile_path = NULL;
+    options->early_exit = 0;
+    options->confidence_order = 0;
+    options->compact_trees = 0;
+    options->numa = NUMA_PLACEMENT_OFF;
+    options->splitter = SPLITTER_BEST;
+    options->bootstrap = BOOTSTRAP_COPY;
+    options->oob_tolerance = -1.0f;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shared_memory") == 0) {
+            options->shared_memory = 1;
+        }
+        else if (strcmp(argv[i], "--pipeline") == 0) {
+            options->pipeline = 1;
+        }
+        else if (strcmp(argv[i], "--checkpoint_path") == 0 && i + 1 < argc) {
+            options->checkpoint_path = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--resume") == 0) {
+            options->resume = 1;
+        }
+        else if (strcmp(argv[i], "--profile_path") == 0 && i + 1 < argc) {
+            options->profile_path = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--compact_trees") == 0) {
+            options->compact_trees = 1;
+        }
+        else if (strcmp(argv[i], "--early_exit") == 0) {
+            options->early_exit = 1;
+        }
+        else if (strcmp(argv[i], "--tree_order") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "index") == 0) {
+                options->confidence_order = 0;
+            } else if (strcmp(argv[i + 1], "confidence") == 0) {
+                options->confidence_order = 1;
+            } else {
+                printf("Tree order must be index or confidence, instead %s was provided.\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--schedule") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "static") == 0) {
+                options->dynamic_schedule = 0;
+            } else if (strcmp(argv[i + 1], "dynamic") == 0) {
+                options->dynamic_schedule = 1;
+            } else {
+                printf("Schedule must be static or dynamic, instead %s was provided.\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--parallelism") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "tree") == 0) {
+                options->parallelism = PARALLELISM_TREE;
+            } else if (strcmp(argv[i + 1], "data") == 0) {
+                options->parallelism = PARALLELISM_DATA;
+            } else if (strcmp(argv[i + 1], "feature") == 0) {
+                options->parallelism = PARALLELISM_FEATURE;
+            } else {
+                printf("Parallelism must be tree, data or feature, instead %s was provided.\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--numa") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "off") == 0) {
+                options->numa = NUMA_PLACEMENT_OFF;
+            } else if (strcmp(argv[i + 1], "touch") == 0) {
+                options->numa = NUMA_PLACEMENT_TOUCH;
+            } else if (strcmp(argv[i + 1], "replicate") == 0) {
+                options->numa = NUMA_PLACEMENT_REPLICATE;
+            } else {
+                printf("NUMA placement must be off, touch or replicate, instead %s was provided.\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--splitter") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "best") == 0) {
+                options->splitter = SPLITTER_BEST;
+            } else if (strcmp(argv[i + 1], "random") == 0) {
+                options->splitter = SPLITTER_RANDOM;
+            } else if (strcmp(argv[i + 1], "approx") == 0) {
+                options->splitter = SPLITTER_APPROX;
+            } else {
+                printf("Splitter must be best, random or approx, instead %s was provided.\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--bootstrap") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "copy") == 0) {
+                options->bootstrap = BOOTSTRAP_COPY;
+            } else if (strcmp(argv[i + 1], "weights") == 0) {
+                options->bootstrap = BOOTSTRAP_WEIGHTS;
+            } else if (strcmp(argv[i + 1], "replacement") == 0) {
+                options->bootstrap = BOOTSTRAP_REPLACEMENT;
+            } else {
+                printf("Bootstrap must be copy, weights or replacement, instead %s was provided.\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--oob_tolerance") == 0 && i + 1 < argc) {
+            options->oob_tolerance = atof(argv[i + 1]);
+            if (options->oob_tolerance < 0) {
+                printf("Out-of-bag tolerance must be non-negative, instead %f was provided.\n", options->oob_tolerance);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--num_bins") == 0 && i + 1 < argc) {
+            options->num_bins = atoi(argv[i + 1]);
+            if (options->num_bins < 2) {
+                printf("Number of bins must be at least 2, instead %d was provided.\n", options->num_bins);
+                return 1;
+            }
+        }
+    }
+
+    if (options->resume && options->checkpoint_path == NULL) {
+        printf("--resume requires --checkpoint_path.\n");
+        return 1;
+    }
+    if (options->confidence_order && !options->early_exit) {
+        printf("--tree_order requires --early_exit.\n");
+        return 1;
+    }
+
+    return 0;
+}
+
 // Function to read CSV and return the data array. Access with the formula: index = row * num_columns + column
 
 float* read_csv(const char *filename, int *num_rows, int *num_columns) {
@@ -134,6 +271,48 @@ float* read_csv(const char *filename, int *num_rows, int *num_columns) {
     return data;
 }
 
+float* read_binary_dataset(const char *filename, int *num_rows, int *num_columns) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        perror("Error opening file");
+        return NULL;
+    }
+
+    int header[3];
+    if (fread(header, sizeof(int), 3, file) != 3 || header[0] != DATASET_MAGIC || header[1] <= 0 || header[2] <= 1) {
+        fprintf(stderr, "%s is not a binary dataset\n", filename);
+        fclose(file);
+        return NULL;
+    }
+    *num_rows = header[1];
+    *num_columns = header[2];
+
+    size_t count = (size_t)*num_rows * *num_columns;
+    float *data = (float *)malloc(count * sizeof(float));
+    if (!data) {
+        perror("Memory allocation failed");
+        fclose(file);
+        return NULL;
+    }
+    if (fread(data, sizeof(float), count, file) != count) {
+        fprintf(stderr, "%s is truncated\n", filename);
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    return data;
+}
+
+float* read_dataset(const char *filename, int *num_rows, int *num_columns) {
+    size_t length = strlen(filename);
+    if (length >= 4 && strcmp(filename + length - 4, ".bin") == 0) {
+        return read_binary_dataset(filename, num_rows, num_columns);
+    }
+    return read_csv(filename, num_rows, num_columns);
+}
+
 void stratified_split(float *data, int num_rows, int num_columns, int num_classes, float train_proportion,
                       float **train_data, int *train_size, float **test_data, int *test_size, int seed) {
 
@@ -173,8 +352,8 @@ void stratified_split(float *data, int num_rows, int num_columns, int num_classe
     }
 
     // Allocate memory for train and test sets (flat arrays)
-    *train_data = (float *)malloc((*train_size) * num_columns * sizeof(float));
-    *test_data = (float *)malloc((*test_size) * num_columns * sizeof(float));
+    *train_data = (float *)numa_alloc((size_t)(*train_size) * num_columns * sizeof(float));
+    *test_data = (float *)numa_alloc((size_t)(*test_size) * num_columns * sizeof(float));
 
     if (!*train_data || !*test_data) {
         perror("Memory allocation failed for train/test data");
@@ -246,63 +425,6 @@ void summary(char* dataset_path, float train_proportion, float train_tree_propor
         printf(" - Seed: %d\n", seed);
         printf("--------------\n");
     };
-/**
- * Samples data without replacement from the training dataset
- *
- * @param train_data The full training dataset
- * @param train_size Number of samples in the training dataset
- * @param num_columns Number of features per sample
- * @param sample_proportion Proportion of data to sample (e.g., 0.75 for 75%)
- * @param sampled_data Output buffer for the sampled data (must be pre-allocated)
- * @return Returns 0 on success, non-zero on failure
- */
-
-int sample_data_without_replacement(float *train_data, int train_size, int num_columns, 
-                                    float sample_proportion, float *sampled_data, int seed) {
-    if (train_data == NULL || sampled_data == NULL || train_size <= 0 || 
-        num_columns <= 0 || sample_proportion <= 0 || sample_proportion > 1) {
-        fprintf(stderr, "Invalid parameters for data sampling\n");
-        return 1;
-    }
-
-    int sample_size = (int)(sample_proportion * train_size);
-    if (sample_size <= 0) {
-        fprintf(stderr, "Sample size is too small\n");
-        return 1;
-    }
-
-    // Allocate and initialize index array
-    int *indices = (int *)malloc(train_size * sizeof(int));
-    if (indices == NULL) {
-        fprintf(stderr, "Failed to allocate memory for indices\n");
-        return 1;
-    }
-
-    for (int i = 0; i < train_size; i++) {
-        indices[i] = i;
-    }
-
-    // Fisher-Yates shuffle
-    srand(seed);
-    for (int i = train_size - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-        int temp = indices[i];
-        indices[i] = indices[j];
-        indices[j] = temp;
-    }
-
-    // Copy the first sample_size rows using flat memory layout
-    for (int i = 0; i < sample_size; i++) {
-        int original_row = indices[i];
-        for (int j = 0; j < num_columns; j++) {
-            sampled_data[i * num_columns + j] = train_data[original_row * num_columns + j];
-        }
-    }
-
-    free(indices);
-    return sample_size;
-}
-
 void distribute_trees(int num_trees, int size, int *counts, int *displs) {
     int base = num_trees / size;
     int rem = num_trees % size;